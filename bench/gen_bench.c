@@ -0,0 +1,374 @@
+/* gen_bench.c - generator throughput and world-shape checks
+ *
+ * Generates cities at several scales and seeds and reports, per run:
+ * servers and links per second, peak RSS, the time spent in each
+ * generator stage, a digest of the world, and whether the world matches
+ * its GeneratorParams: every link has its reverse, each layer has a child
+ * count inside the configured range, and the mesh link counts are within
+ * a few standard deviations of what the densities predict. A per-type
+ * degree histogram is printed for eyeballing.
+ *
+ * Every world is also generated a second time on one thread and must give
+ * the same digest. Exits non-zero if any check fails.
+ *
+ *   bench/gen_bench [--isps N,N,...] [--seeds S,S,...] [--threads N] [--compact] [--quiet]
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#include "game.h"
+#include "generator.h"
+
+#define MAX_LIST 16
+#define DEGREE_BUCKETS 8
+#define TYPE_COUNT (SERVER_TYPE_HOST + 1)
+
+/* Allowed distance from the expected mesh link count, in standard deviations. */
+#define MESH_SIGMAS 5.0
+
+typedef struct {
+    int values[MAX_LIST];
+    int count;
+} IntList;
+
+typedef struct {
+    IntList isps;
+    IntList seeds;
+    int threads;
+    int compact;
+    int quiet;
+} BenchOptions;
+
+static int failures;
+
+static void fail(const char* fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    printf("  FAIL: ");
+    vprintf(fmt, ap);
+    printf("\n");
+    va_end(ap);
+    failures++;
+}
+
+static int parse_list(const char* s, IntList* out) {
+    out->count = 0;
+    while (*s && out->count < MAX_LIST) {
+	char* end;
+	long v = strtol(s, &end, 10);
+	if (end == s) return 0;
+	out->values[out->count++] = (int)v;
+	s = *end == ',' ? end + 1 : end;
+    }
+    return out->count > 0 && *s == '\0';
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static long peak_rss_kb(void) {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_maxrss;
+}
+
+/* Builds a world the way game_init() does: home first, then the city. */
+static GameState* build(const GeneratorParams* p, unsigned int seed, GeneratorTimings* t) {
+    GameState* g = calloc(1, sizeof(*g));
+    if (!g) return NULL;
+    g->home_server = server_store_add(&g->servers, "home");
+    g->current_server = g->home_server;
+    generator_generate_timed(g, p, seed, t);
+    return g;
+}
+
+static void destroy(GameState* g) {
+    server_store_free(&g->servers);
+    link_graph_free(&g->links);
+    free(g);
+}
+
+/* FNV-1a over everything a save would hold. */
+static uint64_t fnv(uint64_t h, const void* data, size_t len) {
+    const unsigned char* p = data;
+    for (size_t i = 0; i < len; i++) {
+	h ^= p[i];
+	h *= 1099511628211ull;
+    }
+    return h;
+}
+
+static uint64_t world_digest(const GameState* g) {
+    const ServerStore* st = &g->servers;
+    uint64_t h = 14695981039346656037ull;
+    for (ServerId i = 0; i < st->count; i++) {
+	const char* name = server_name(st, i);
+	h = fnv(h, name, strlen(name) + 1);
+	int32_t cols[4] = { server_type(st, i), server_security(st, i), server_money(st, i),
+	                    server_subnet(st, i) };
+	h = fnv(h, cols, sizeof(cols));
+	int n = 0;
+	const ServerId* links = link_graph_neighbors(&g->links, i, &n);
+	h = fnv(h, &n, sizeof(n));
+	if (n > 0) h = fnv(h, links, (size_t)n * sizeof(*links));
+	const Service* svcs = server_services(st, i, &n);
+	for (int s = 0; s < n; s++) {
+	    h = fnv(h, svcs[s].name, strlen(svcs[s].name));
+	    h = fnv(h, &svcs[s].port, sizeof(svcs[s].port));
+	    h = fnv(h, &svcs[s].vuln_level, sizeof(svcs[s].vuln_level));
+	}
+    }
+    return h;
+}
+
+static int degree_bucket(int d) {
+    /* 0, 1, 2, 3-4, 5-8, 9-16, 17-32, 33+ */
+    int b = 0;
+    while (b < DEGREE_BUCKETS - 1 && d > (b == 0 ? 0 : 1 << (b - 1))) b++;
+    return b;
+}
+
+static void print_degrees(const GameState* g) {
+    static const char* labels[DEGREE_BUCKETS] = { "0", "1", "2", "3-4", "5-8", "9-16", "17-32", "33+" };
+    long hist[TYPE_COUNT][DEGREE_BUCKETS] = { { 0 } };
+    long count[TYPE_COUNT] = { 0 }, sum[TYPE_COUNT] = { 0 };
+    int max[TYPE_COUNT] = { 0 };
+    for (ServerId i = 0; i < g->servers.count; i++) {
+	int t = server_type(&g->servers, i), d = 0;
+	link_graph_neighbors(&g->links, i, &d);
+	count[t]++;
+	sum[t] += d;
+	if (d > max[t]) max[t] = d;
+	hist[t][degree_bucket(d)]++;
+    }
+    printf("  %-20s %9s %6s %4s |", "degree by type", "servers", "mean", "max");
+    for (int b = 0; b < DEGREE_BUCKETS; b++) printf(" %7s", labels[b]);
+    printf("\n");
+    for (int t = 0; t < TYPE_COUNT; t++) {
+	if (!count[t]) continue;
+	printf("  %-20s %9ld %6.2f %4d |", server_type_to_string((ServerType)t), count[t],
+	       (double)sum[t] / (double)count[t], max[t]);
+	for (int b = 0; b < DEGREE_BUCKETS; b++) printf(" %7ld", hist[t][b]);
+	printf("\n");
+    }
+}
+
+/* Every link u -> v has v -> u. */
+static void check_symmetry(const GameState* g) {
+    long missing = 0;
+    for (ServerId u = 0; u < g->servers.count; u++) {
+	int n = 0;
+	const ServerId* links = link_graph_neighbors(&g->links, u, &n);
+	for (int k = 0; k < n; k++) {
+	    if (!link_graph_has_link(&g->links, links[k], u)) missing++;
+	}
+    }
+    if (missing) fail("%ld links have no reverse link", missing);
+}
+
+static void check_range(const char* what, const long* counts, const ServerStore* st, ServerType parent,
+                        int lo, int hi) {
+    long below = 0, above = 0;
+    for (ServerId i = 0; i < st->count; i++) {
+	if (server_type(st, i) != parent) continue;
+	if (counts[i] < lo) below++;
+	if (counts[i] > hi) above++;
+    }
+    if (below || above) fail("%s outside [%d, %d]: %ld below, %ld above", what, lo, hi, below, above);
+}
+
+/* A generated server's first link is its parent; every child count must
+ * lie in the range its GeneratorParams field allows. */
+static void check_layers(const GameState* g, const GeneratorParams* p) {
+    const ServerStore* st = &g->servers;
+    long* children = calloc((size_t)st->count, sizeof(*children));
+    long* floors = calloc((size_t)st->count, sizeof(*floors));
+    if (!children || !floors) {
+	free(children);
+	free(floors);
+	fail("out of memory");
+	return;
+    }
+    for (ServerId i = 0; i < st->count; i++) {
+	ServerType t = server_type(st, i);
+	if (t == SERVER_TYPE_ISP || i == g->home_server) continue;
+	int n = 0;
+	const ServerId* links = link_graph_neighbors(&g->links, i, &n);
+	if (n == 0) continue;
+	if (t == SERVER_TYPE_FLOOR) floors[links[0]]++; else children[links[0]]++;
+    }
+
+    check_range("areas per ISP", children, st, SERVER_TYPE_ISP, p->areas_min, p->areas_max);
+    check_range("neighbourhoods per area", children, st, SERVER_TYPE_AREA, p->neigh_min, p->neigh_max);
+    check_range("buildings per neighbourhood", children, st, SERVER_TYPE_NEIGHBORHOOD, p->buildings_min,
+                p->buildings_max);
+    check_range("users per router", children, st, SERVER_TYPE_ROUTER, p->users_per_router_min,
+                p->users_per_router_max);
+    check_range("routers per floor", children, st, SERVER_TYPE_FLOOR, p->routers_per_building_min,
+                p->routers_per_building_max);
+
+    /* a building has floors, or (with one floor) routers hanging off it */
+    long bad_floors = 0, bad_routers = 0;
+    for (ServerId i = 0; i < st->count; i++) {
+	if (server_type(st, i) != SERVER_TYPE_BUILDING) continue;
+	if (floors[i] == 0) {
+	    if (children[i] < p->routers_per_building_min || children[i] > p->routers_per_building_max) {
+		bad_routers++;
+	    }
+	} else if (floors[i] < 2 || floors[i] > p->floors_per_building_max || children[i] != 0) {
+	    bad_floors++;
+	}
+    }
+    if (bad_floors) fail("%ld buildings with a bad floor count", bad_floors);
+    if (bad_routers) fail("%ld single-floor buildings with a bad router count", bad_routers);
+    free(children);
+    free(floors);
+}
+
+/* Mesh links are the router-to-router links that are not parent links
+ * (routers hang off buildings and floors). Each pass links every
+ * candidate pair independently, so its count is binomial. */
+static void check_mesh_pass(const char* what, long observed, double pairs, double p) {
+    double expected = pairs * p;
+    double sigma = sqrt(pairs * p * (1.0 - p));
+    double off = fabs((double)observed - expected);
+    printf("  %-20s %9ld links, expected %.1f (%.2f sigma)\n", what, observed, expected,
+           sigma > 0 ? off / sigma : 0.0);
+    if (off > MESH_SIGMAS * sigma + 0.5) fail("%s count is off by more than %.0f sigma", what, MESH_SIGMAS);
+}
+
+static void check_mesh(const GameState* g, const GeneratorParams* p) {
+    const ServerStore* st = &g->servers;
+    long intra = 0, inter = 0, routers = 0;
+    /* routers per subnet, to count the candidate pairs */
+    long* per_subnet = calloc((size_t)st->count + 1, sizeof(*per_subnet));
+    if (!per_subnet) {
+	fail("out of memory");
+	return;
+    }
+    for (ServerId u = 0; u < st->count; u++) {
+	if (server_type(st, u) != SERVER_TYPE_ROUTER) continue;
+	routers++;
+	int sub = server_subnet(st, u);
+	per_subnet[sub >= 0 && sub < st->count ? sub : st->count]++;
+	int n = 0;
+	const ServerId* links = link_graph_neighbors(&g->links, u, &n);
+	for (int k = 1; k < n; k++) {
+	    ServerId v = links[k];
+	    if (v <= u || server_type(st, v) != SERVER_TYPE_ROUTER) continue;
+	    if (server_subnet(st, u) == server_subnet(st, v)) intra++; else inter++;
+	}
+    }
+    double same = 0.0;
+    for (ServerId s = 0; s < st->count; s++) same += (double)per_subnet[s] * (double)(per_subnet[s] - 1) / 2.0;
+    double all = (double)routers * (double)(routers - 1) / 2.0;
+    free(per_subnet);
+
+    check_mesh_pass("same-subnet mesh", intra, same, p->intra_subnet_link_density);
+    check_mesh_pass("cross-subnet mesh", inter, all - same, p->inter_router_link_density);
+}
+
+static void run(const BenchOptions* opt, int isps, int seed) {
+    GeneratorParams p;
+    generator_city_params(&p);
+    p.isp_count = isps;
+    p.threads = opt->threads;
+    p.compact_names = opt->compact;
+
+    long rss_before = peak_rss_kb();
+    GeneratorTimings t;
+    double start = now_seconds();
+    GameState* g = build(&p, (unsigned int)seed, &t);
+    double secs = now_seconds() - start;
+    if (!g) {
+	fail("out of memory");
+	return;
+    }
+    long servers = g->servers.count;
+    long links = (long)g->links.edge_count / 2;
+
+    printf("isps=%d seed=%d: %ld servers, %ld links in %.3f s (%.0f servers/s, %.0f links/s)\n", isps, seed,
+           servers, links, secs, (double)servers / secs, (double)links / secs);
+    printf("  stages: plan %.3f  isps %.3f  neighbourhoods %.3f  splice %.3f  mesh %.3f  freeze %.3f s\n",
+           t.plan, t.isps, t.neighbourhoods, t.splice, t.mesh, t.freeze);
+    printf("  peak RSS %ld KB (was %ld KB before this run)\n", peak_rss_kb(), rss_before);
+
+    uint64_t digest = world_digest(g);
+    printf("  digest %016llx\n", (unsigned long long)digest);
+
+    check_symmetry(g);
+    check_layers(g, &p);
+    check_mesh(g, &p);
+    if (!opt->quiet) print_degrees(g);
+    destroy(g);
+
+    /* the thread count must never change the world */
+    if (p.threads != 1) {
+	p.threads = 1;
+	g = build(&p, (unsigned int)seed, NULL);
+	if (!g) {
+	    fail("out of memory");
+	    return;
+	}
+	if (world_digest(g) != digest) fail("world differs when built on one thread");
+	destroy(g);
+    }
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+            "usage: %s [--isps N,N,...] [--seeds S,S,...] [--threads N] [--compact] [--quiet]\n"
+            "  --isps      city sizes to generate (default 1,10,100)\n"
+            "  --seeds     seeds to generate each size with (default 1,2,3)\n"
+            "  --threads   generator threads (default: one per CPU)\n"
+            "  --compact   keep generated names as coordinates\n"
+            "  --quiet     skip the degree histograms\n",
+            prog);
+}
+
+int main(int argc, char** argv) {
+    BenchOptions opt = { { { 1, 10, 100 }, 3 }, { { 1, 2, 3 }, 3 }, 0, 0, 0 };
+    for (int i = 1; i < argc; i++) {
+	if (strcmp(argv[i], "--isps") == 0 && i + 1 < argc) {
+	    if (!parse_list(argv[++i], &opt.isps)) {
+		usage(argv[0]);
+		return 2;
+	    }
+	} else if (strcmp(argv[i], "--seeds") == 0 && i + 1 < argc) {
+	    if (!parse_list(argv[++i], &opt.seeds)) {
+		usage(argv[0]);
+		return 2;
+	    }
+	} else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+	    opt.threads = atoi(argv[++i]);
+	} else if (strcmp(argv[i], "--compact") == 0) {
+	    opt.compact = 1;
+	} else if (strcmp(argv[i], "--quiet") == 0) {
+	    opt.quiet = 1;
+	} else {
+	    usage(argv[0]);
+	    return 2;
+	}
+    }
+
+    for (int i = 0; i < opt.isps.count; i++) {
+	for (int s = 0; s < opt.seeds.count; s++) run(&opt, opt.isps.values[i], opt.seeds.values[s]);
+    }
+    if (failures) {
+	printf("%d check%s failed\n", failures, failures == 1 ? "" : "s");
+	return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,48 @@
+/**
+ * @file batch.h
+ * @brief Headless batch runner: executes commands without the terminal UI.
+ *
+ * Batch mode reads one command per line, runs it through commands_run()
+ * exactly like the interactive terminal, and writes command output to
+ * stdout. Between commands the simulation is stepped either as fast as
+ * possible or paced to a fixed tick rate. When the input ends, a summary
+ * with per-command latency and overall throughput is written to stderr.
+ */
+#ifndef INCLUDE_BATCH_H_
+#define INCLUDE_BATCH_H_
+
+#include <stdio.h>
+
+#include "game.h"
+
+/**
+ * @brief Options controlling a batch run.
+ */
+typedef struct {
+    int tps;               /**< Tick rate to pace to; 0 runs ticks back to back. */
+    int ticks_per_command; /**< Ticks stepped after each command when tps is 0. */
+    int drain;             /**< Non-zero: after the last command, tick until no actions are pending. */
+    int quiet;             /**< Non-zero: do not print the summary. */
+} BatchOptions;
+
+/**
+ * @brief Fill @p opts with the default batch options.
+ *
+ * Defaults: unpaced, one tick per command, drain enabled, summary printed.
+ */
+void batch_default_options(BatchOptions* opts);
+
+/**
+ * @brief Run every command read from @p in.
+ *
+ * Empty lines and lines starting with '#' are skipped. The run stops early
+ * if a command requests quit.
+ *
+ * @param g Initialized game state.
+ * @param in Stream to read commands from.
+ * @param opts Options; NULL uses the defaults.
+ * @return Number of commands executed.
+ */
+int batch_run(GameState* g, FILE* in, const BatchOptions* opts);
+
+#endif  // INCLUDE_BATCH_H_
@@ -0,0 +1,66 @@
+/**
+ * @file bgsave.h
+ * @brief Saves written by a forked child from a copy-on-write snapshot.
+ *
+ * bgsave_start() forks. The child sees the world exactly as it was at the
+ * fork, whatever the game does next, writes it with game_save_progress()
+ * and exits; the parent only pays for copying its page tables. The child
+ * reports progress through a pipe and its exit status says whether the
+ * save succeeded. The parent polls both without blocking.
+ *
+ * The child only writes the file: it does not touch the UI, the
+ * simulation thread or the Lua state it inherited.
+ */
+#ifndef INCLUDE_BGSAVE_H_
+#define INCLUDE_BGSAVE_H_
+
+#include <stdbool.h>
+
+#include "game.h"
+
+/**
+ * @brief State of a background save.
+ */
+typedef enum {
+    BGSAVE_RUNNING, /**< The child is still writing. */
+    BGSAVE_DONE,    /**< The file was written and renamed into place. */
+    BGSAVE_FAILED   /**< The child failed or could not be reaped. */
+} BgSaveStatus;
+
+/** @brief A background save in progress. */
+typedef struct BgSave BgSave;
+
+/**
+ * @brief Starts writing @p g to @p filename in a child process.
+ *
+ * @return The save, or NULL if the child could not be started.
+ */
+BgSave* bgsave_start(const GameState* g, const char* filename);
+
+/**
+ * @brief Collects progress and, once the child exits, its result.
+ *
+ * Never blocks. After BGSAVE_DONE or BGSAVE_FAILED the status does not
+ * change.
+ */
+BgSaveStatus bgsave_poll(BgSave* s);
+
+/**
+ * @brief Waits for the child to exit.
+ *
+ * @return BGSAVE_DONE or BGSAVE_FAILED.
+ */
+BgSaveStatus bgsave_wait(BgSave* s);
+
+/** @brief Returns the last progress the child reported, 0..100. */
+int bgsave_percent(const BgSave* s);
+
+/** @brief Returns the file being written. */
+const char* bgsave_filename(const BgSave* s);
+
+/**
+ * @brief Frees @p s, waiting for the child if it is still running.
+ */
+void bgsave_free(BgSave* s);
+
+#endif  // INCLUDE_BGSAVE_H_
@@ -23,6 +23,29 @@ typedef enum {
  */
 CommandResult commands_run(GameState* g, const char* input);
 
+/**
+ * @brief Print the outcome of a scheduled action to the terminal.
+ *
+ * Matches GameActionHook; install it as GameState::on_action with the
+ * GameState itself as context.
+ *
+ * @param ctx Pointer to the GameState.
+ * @param a The action that fired.
+ * @param result Outcome of the action.
+ */
+void commands_report_action(void* ctx, const Action* a, CoreResult result);
+
+/**
+ * @brief Print the outcome of a background save.
+ *
+ * Matches GameSaveHook; install it as GameState::on_save.
+ *
+ * @param ctx Unused.
+ * @param filename File that was written.
+ * @param ok true if the save succeeded.
+ */
+void commands_report_save(void* ctx, const char* filename, bool ok);
+
 /**
  * @brief Return the number of built-in commands.
  *
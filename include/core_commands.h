@@ -24,15 +24,57 @@
  */
 CoreResult core_connect(GameState* g, const char* server_name, ServerId* out_target);
 
+/**
+ * @brief Connect to a server by name along a shortest path of links.
+ *
+ * @param g Pointer to GameState.
+ * @param server_name Name of the server to reach.
+ * @param out_target If non-NULL, receives the target's ID (-1 if unknown).
+ * @param out_hops If non-NULL, receives the number of hops taken.
+ * @return CORE_OK on success, CORE_ERR_NOT_FOUND for an unknown name,
+ *         CORE_ERR_NOT_LINKED if the target cannot be reached.
+ */
+CoreResult core_connect_route(GameState* g, const char* server_name, ServerId* out_target, int* out_hops);
+
+/* --- Route --- */
+/**
+ * @brief Find a shortest path between two servers given by name.
+ *
+ * @param g Pointer to GameState.
+ * @param from_name Name of the source server.
+ * @param to_name Name of the target server.
+ * @param out_path Receives the path (source first), valid until the next
+ *        route query. Do not free.
+ * @param out_len Receives the number of servers on the path.
+ * @return CORE_OK on success, CORE_ERR_NOT_FOUND for an unknown name,
+ *         CORE_ERR_NOT_LINKED if there is no path.
+ */
+CoreResult core_route(GameState* g, const char* from_name, const char* to_name,
+                      const ServerId** out_path, int* out_len);
+
+/* --- Distance --- */
+/**
+ * @brief Get the shortest hop count between two servers given by name.
+ *
+ * @param g Pointer to GameState.
+ * @param from_name Name of the first server.
+ * @param to_name Name of the second server.
+ * @param out_hops Receives the number of hops.
+ * @return CORE_OK on success, CORE_ERR_NOT_FOUND for an unknown name,
+ *         CORE_ERR_NOT_LINKED if the servers are not connected.
+ */
+CoreResult core_distance(GameState* g, const char* from_name, const char* to_name, int* out_hops);
+
 /* --- Scan --- */
 /**
  * @brief Get a list of directly connected servers from the current server.
  *
  * @param g Pointer to GameState.
  * @param out_count Number of servers returned.
- * @return Pointer to a static array of ServerIds (max 16). Do not free.
+ * @return Pointer into the world's link graph, valid until links change.
+ *         Do not free.
  */
-ServerId* core_scan(GameState* g, int* out_count);
+const ServerId* core_scan(GameState* g, int* out_count);
 
 /* --- Echo --- */
 /**
@@ -48,11 +90,54 @@ char* core_echo(int argc, char** argv);
 /**
  * @brief Save the current game state to a file.
  *
+ * If a journal is open for @p file only the journal is flushed; otherwise
+ * the whole world is written and any stale journal for @p file deleted.
+ * A background save to @p file is waited for first.
+ *
  * @param g Pointer to GameState.
  * @param file Filename to save to.
  * @return CORE_OK on success, otherwise a CoreResult error code.
  */
 CoreResult core_save(GameState* g, const char* file);
 
+/* --- Journal --- */
+/**
+ * @brief Start journaling changes against save file @p file, or stop.
+ *
+ * Replaces any journal already open. A snapshot of the world is written
+ * to @p file in the background (see journal.h).
+ *
+ * @param g Pointer to GameState.
+ * @param file Save file to journal against, or NULL to stop journaling.
+ * @return CORE_OK on success, CORE_ERR_FILE if the journal could not be
+ *         created.
+ */
+CoreResult core_journal(GameState* g, const char* file);
+
+/* --- Background save --- */
+/**
+ * @brief Save to a file without blocking; see game_save_background().
+ *
+ * @param g Pointer to GameState.
+ * @param file Filename to save to.
+ * @param out_started Receives true if the save continues in the
+ *        background and will be reported through GameState::on_save.
+ * @return CORE_OK on success, CORE_ERR_BUSY while another background save
+ *         runs, otherwise a CoreResult error code.
+ */
+CoreResult core_save_background(GameState* g, const char* file, bool* out_started);
+
+/* --- Autosave --- */
+/**
+ * @brief Save to @p file in the background every @p ticks ticks.
+ *
+ * @param g Pointer to GameState.
+ * @param ticks Interval in ticks; 0 turns autosave off.
+ * @param file File to save to.
+ * @return CORE_OK on success, CORE_ERR_INVALID_ARG for a bad interval or
+ *         file name.
+ */
+CoreResult core_autosave(GameState* g, int ticks, const char* file);
+
 /* --- Additional commands can follow the same pattern --- */
 #endif  // INCLUDE_CORE_COMMANDS_H_
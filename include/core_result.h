@@ -10,7 +10,8 @@ typedef enum {
     CORE_ERR_NOT_LINKED,  /**< Server not directly linked */
     CORE_ERR_FILE,        /**< File error */
     CORE_ERR_INVALID_ARG, /**< Invalid argument */
-    CORE_ERR_UNKNOWN      /**< Generic failure */
+    CORE_ERR_UNKNOWN,     /**< Generic failure */
+    CORE_ERR_BUSY         /**< The same kind of operation is already running */
 } CoreResult;
 
 #endif  // INCLUDE_CORE_RESULT_H_
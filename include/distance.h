@@ -0,0 +1,108 @@
+/**
+ * @file distance.h
+ * @brief Hop distances from a spanning-tree LCA index plus overlay labels.
+ *
+ * The generated city is a strict hierarchy (ISP -> area -> neighbourhood
+ * -> building -> floor -> router -> user) plus a few extra mesh links.
+ * The index takes a BFS spanning forest of the link graph and records,
+ * for every node, its depth and its position in a DFS order of the
+ * forest. The lowest common ancestor depth of two nodes is then a range
+ * minimum over that order, answered by a block-decomposed sparse table
+ * in O(1). Tree distance is depth(u) + depth(v) - 2 * depth(lca).
+ *
+ * Links that are not part of the forest form an overlay. Every node on a
+ * tree path from a root to an overlay endpoint is an anchor, and each
+ * anchor is labelled with its true distance to every endpoint. A path
+ * that uses the overlay climbs from each end to the nearest anchor above
+ * it, so a query compares the tree answer with the climbs plus the best
+ * meeting endpoint of the two anchors' labels: one pass over two rows,
+ * exact shortest hop counts. Building fails when there are more than
+ * @ref DISTANCE_OVERLAY_MAX endpoints or the labels would exceed
+ * @ref DISTANCE_LABEL_MAX cells; callers then fall back to a search,
+ * and the failure is remembered until the links change.
+ *
+ * Links are treated as undirected.
+ */
+#ifndef INCLUDE_DISTANCE_H_
+#define INCLUDE_DISTANCE_H_
+
+#include <stdint.h>
+
+#include "core_result.h"
+#include "link_graph.h"
+#include "server.h"
+
+#define DISTANCE_OVERLAY_MAX 2048     /**< Most overlay endpoints an index accepts. */
+#define DISTANCE_LABEL_MAX (1u << 23) /**< Most anchor-to-endpoint labels an index holds. */
+#define DISTANCE_BLOCK 32        /**< Range-minimum block size. */
+
+/**
+ * @brief Hop-distance index over one frozen link graph.
+ *
+ * A zero-initialized DistanceIndex is valid and empty.
+ */
+typedef struct {
+    uint64_t generation; /**< LinkGraph::generation the index was built from; 0 if none. */
+    int node_count;      /**< Number of nodes covered. */
+
+    int32_t* depth;      /**< Depth of each node in its tree. */
+    int32_t* comp;       /**< Root of each node's tree. */
+    int32_t* pos;        /**< Position of each node in the DFS order. */
+
+    /* range minimum over depth-in-DFS-order */
+    int32_t* order_depth; /**< Depth of the node at each DFS position. */
+    int32_t* prefix_min;  /**< Minimum from the block start up to each position. */
+    int32_t* suffix_min;  /**< Minimum from each position to the block end. */
+    int32_t* sparse;      /**< Sparse table over block minima, @ref levels rows. */
+    int blocks;           /**< Number of blocks. */
+    int levels;           /**< Rows in @ref sparse. */
+
+    /* overlay of non-tree links */
+    int endpoint_count;   /**< Nodes touching a non-tree link; anchors 0..endpoint_count-1. */
+    int anchor_count;     /**< Endpoints plus every tree ancestor of one. */
+    int32_t* anchor;      /**< Nearest anchor at or above each node; -1 if none. */
+    ServerId* anchor_node; /**< Node of each anchor. */
+    int32_t* labels;      /**< anchor_count rows of true distances to each endpoint. */
+
+    uint64_t failed_generation; /**< Generation the last build failed for; 0 if none. */
+} DistanceIndex;
+
+/**
+ * @brief Initializes an empty index.
+ */
+void distance_index_init(DistanceIndex* di);
+
+/**
+ * @brief Releases all memory and leaves the index empty.
+ */
+void distance_index_free(DistanceIndex* di);
+
+/**
+ * @brief (Re)builds the index for the frozen links of @p lg.
+ *
+ * @return CORE_OK on success; CORE_ERR_UNKNOWN if memory runs out or the
+ *         overlay is too large, in which case the index is left empty
+ *         and the failure recorded for distance_index_failed().
+ */
+CoreResult distance_index_build(DistanceIndex* di, const LinkGraph* lg);
+
+/**
+ * @brief Returns non-zero if the index was built from the current links.
+ */
+int distance_index_is_current(const DistanceIndex* di, const LinkGraph* lg);
+
+/**
+ * @brief Returns non-zero if building the index failed for the current
+ *        links, so another attempt would fail too.
+ */
+int distance_index_failed(const DistanceIndex* di, const LinkGraph* lg);
+
+/**
+ * @brief Returns the shortest hop count between two servers.
+ *
+ * @return Number of hops (0 when @p a == @p b), or -1 if @p b cannot be
+ *         reached from @p a or either ID is not covered by the index.
+ */
+int distance_index_query(const DistanceIndex* di, ServerId a, ServerId b);
+
+#endif  // INCLUDE_DISTANCE_H_
@@ -4,60 +4,75 @@
 #include <stdbool.h>
 
 #include "server.h"
+#include "link_graph.h"
+#include "scheduler.h"
+#include "route.h"
+#include "distance.h"
 #include "core_result.h"
 
-#define MAX_SERVERS 512
-#define MAX_ACTIONS 256
-
 /**
- * @brief An enum for Action types.
+ * @brief Callback reporting the outcome of a scheduled action.
  *
- * Contains all the different types of actions.
+ * @param ctx User pointer stored in GameState::on_action_ctx.
+ * @param a The action that fired. For ACTION_DOWNLOAD, @p a->value holds
+ *          the amount actually transferred.
+ * @param result CORE_OK on success, otherwise a CoreResult error code.
  */
-typedef enum {
-    ACTION_CONNECT,
-    ACTION_SCAN,
-    ACTION_DOWNLOAD,
-    ACTION_NOP,
-} ActionType;
+struct GenLazy;
+
+typedef void (*GameActionHook)(void* ctx, const Action* a, CoreResult result);
 
 /**
- * @brief Represents an action.
+ * @brief Callback reporting the end of a background save.
  *
- * Contains all the queued up actions and their count.
+ * @param ctx User pointer stored in GameState::on_save_ctx.
+ * @param filename File that was written.
+ * @param ok true if the file was written and renamed into place.
  */
-typedef struct {
-    ActionType type;   /**< Type of action. */
-    int target_server; /**< The server the action should run on. */
-    int value;         /**< Optional: The value/argument for the action. */
-} Action;
+typedef void (*GameSaveHook)(void* ctx, const char* filename, bool ok);
 
 /**
- * @brief An array of all queued actions.
+ * @brief Callback reporting save progress.
  *
- * Contains all the queued up actions and their count.
+ * @param ctx User pointer passed to game_save_progress().
+ * @param done Servers written so far.
+ * @param total Servers to write.
  */
-typedef struct {
-    Action actions[MAX_ACTIONS]; /**< Array of all queued up actions. */
-    int count;                   /**< The number of queued up actions. */
-} ActionQueue;
+typedef void (*GameSaveProgressFn)(void* ctx, int done, int total);
+
+#define GAME_FILENAME_MAX 256 /**< Longest autosave file name, including NUL. */
 
 /**
  * @brief Represents the overall state of the game.
  *
- * Contains all servers in the game, the total number of servers,
- * and information about the player's current and home server.
+ * Contains all servers in the game and information about the player's
+ * current and home server. The server store lives on the heap, so a
+ * GameState is small; it must be zero-initialized before first use.
  */
 typedef struct {
-    Server servers[MAX_SERVERS]; /**< Array of all servers in the game. */
-    int server_count;            /**< Number of servers currently in use. */
+    ServerStore servers; /**< Growable store of all servers in the game. */
+    LinkGraph links;     /**< Links between servers (CSR adjacency). */
 
     ServerId current_server; /**< ID of the server the player is currently connected to. */
     ServerId home_server;    /**< ID of the player's home server. */
 
     int tick; /**< Current tick number. */
 
-    ActionQueue queue; /**< Queued actions. */
+    Scheduler sched; /**< Actions waiting for a future tick. */
+    RouteFinder route; /**< Reusable workspace for path queries. */
+    DistanceIndex dist; /**< Hop-distance index; rebuilt when the links change. */
+    struct GenLazy* lazy; /**< Unexplored parts of a lazily generated world, or NULL. */
+    struct Journal* journal; /**< Change log for incremental saves, or NULL. */
+    struct BgSave* bgsave;   /**< Save being written in the background, or NULL. */
+
+    int autosave_ticks;                   /**< Ticks between autosaves; 0 disables them. */
+    int autosave_next;                    /**< Tick the next autosave is due on. */
+    char autosave_file[GAME_FILENAME_MAX]; /**< File autosaves go to. */
+
+    GameActionHook on_action; /**< Optional: notified when an action fires. */
+    void* on_action_ctx;      /**< User pointer passed to @ref on_action. */
+    GameSaveHook on_save;     /**< Optional: notified when a background save ends. */
+    void* on_save_ctx;        /**< User pointer passed to @ref on_save. */
 } GameState;
 
 /* ---------------- LIFECYCLE ---------------- */
@@ -74,7 +89,8 @@ void game_init(GameState* g);
 /**
  * @brief Shuts down the game in a controlled manner.
  *
- * Frees resources and performs any necessary cleanup.
+ * Frees resources and performs any necessary cleanup. The GameState is
+ * left empty and may be re-initialized with game_init() or game_load().
  *
  * @param g Pointer to the GameState to shut down.
  */
@@ -82,34 +98,68 @@ void game_shutdown(GameState* g);
 
 /* ---------------- HELPERS ---------------- */
 
+/*
+ * Per-server fields are read and written through the server_* accessors
+ * on g->servers (see server.h); the helpers below cover the common
+ * lookups done by commands and scripts.
+ */
+
 /**
- * @brief Returns the server the player is currently connected to.
+ * @brief Returns the name of the server with the specified ID.
  *
  * @param g Pointer to the GameState.
- * @return Pointer to the current Server, or NULL if not connected.
+ * @param id ID of the server.
+ * @return Name of the server, or NULL if @p id is not a valid server.
  */
-Server* game_get_current_server(GameState* g);
+const char* game_server_name(const GameState* g, ServerId id);
 
 /**
- * @brief Returns the server with the specified ID.
+ * @brief Returns the number of servers in the world.
  *
  * @param g Pointer to the GameState.
- * @param id ID of the server to retrieve.
- * @return Pointer to the Server with the given ID, or NULL if not found.
+ * @return Number of servers; valid IDs are 0..count-1.
  */
-Server* game_get_server(GameState* g, ServerId id);
+int game_server_count(const GameState* g);
+
+/**
+ * @brief Returns the servers directly linked to @p id.
+ *
+ * Only frozen links are visible (see link_graph_freeze()). The returned
+ * pointer stays valid until the link graph is next frozen.
+ *
+ * @param g Pointer to the GameState.
+ * @param id Server to query.
+ * @param out_count Receives the number of linked servers.
+ * @return Pointer to the linked server IDs, or NULL if there are none.
+ */
+const ServerId* game_get_links(const GameState* g, ServerId id, int* out_count);
+
+/**
+ * @brief Generates the servers below @p id if it is still unexplored.
+ *
+ * Only does something in a lazily generated world (HACKTERM_LAZY set when
+ * game_init() ran); there, neighbourhoods are filled in on first visit.
+ *
+ * @param g Pointer to the GameState.
+ * @param id Server about to be looked at.
+ * @return Number of servers added, 0 if there was nothing to do, or -1
+ *         on failure.
+ */
+int game_expand(GameState* g, ServerId id);
 
 /* ---------------- COMMANDS ---------------- */
 
 /**
  * @brief Scans for servers connected to the current server.
  *
+ * The current server is expanded first (see game_expand()).
+ *
  * @param g Pointer to the GameState.
  * @param out Array to store the found server IDs.
  * @param max Maximum number of entries that can be written to @p out.
  * @return Number of servers written to @p out.
  */
-int game_scan(const GameState* g, ServerId* out, int max);
+int game_scan(GameState* g, ServerId* out, int max);
 
 /**
  * @brief Connects the player to a server.
@@ -120,25 +170,156 @@ int game_scan(const GameState* g, ServerId* out, int max);
  */
 CoreResult game_connect(GameState* g, ServerId to);
 
+/**
+ * @brief Finds a shortest hop path between two servers.
+ *
+ * @param g Pointer to the GameState.
+ * @param from Source server.
+ * @param to Target server.
+ * @param out_len Receives the number of servers on the path, both ends
+ *        included (0 when there is none).
+ * @return The path, @p from first, valid until the next route query; NULL
+ *         if there is no path or an ID is invalid.
+ */
+const ServerId* game_route(GameState* g, ServerId from, ServerId to, int* out_len);
+
+/**
+ * @brief Connects the player to a server along a shortest path.
+ *
+ * Each hop is taken with game_connect(); if one fails the player stays on
+ * the last server reached.
+ *
+ * @param g Pointer to the GameState.
+ * @param to ID of the server to reach.
+ * @param out_hops If non-NULL, receives the number of hops taken.
+ * @return CORE_OK on success, CORE_ERR_NOT_LINKED if @p to is unreachable
+ *         or a hop failed, CORE_ERR_INVALID_ARG for a bad ID.
+ */
+CoreResult game_connect_route(GameState* g, ServerId to, int* out_hops);
+
+/**
+ * @brief Returns the shortest hop count between two servers.
+ *
+ * Answered from the distance index, which is rebuilt on the first query
+ * after the links change. Falls back to a path search when the index
+ * cannot be built, without retrying the build until the links change.
+ *
+ * @param g Pointer to the GameState.
+ * @param a First server.
+ * @param b Second server.
+ * @return Number of hops, or -1 if @p b is unreachable or an ID is invalid.
+ */
+int game_distance(GameState* g, ServerId a, ServerId b);
+
 /**
  * @brief Saves the current game state to a file.
  *
+ * Files ending in WORLD_FILE_EXT are written in the binary world format
+ * (see world_file.h), anything else as JSON. A lazily generated world
+ * keeps its plan in the save and goes on growing once loaded.
+ *
  * @param g Pointer to the GameState.
  * @param filename Path to the file where the state should be saved.
  * @returns
  */
 bool game_save(const GameState* g, const char* filename);
+
+/**
+ * @brief game_save(), reporting progress to @p progress as it goes.
+ *
+ * @param progress Called every few thousand servers and once at the end;
+ *        may be NULL.
+ * @param ctx Passed to @p progress.
+ */
+bool game_save_progress(const GameState* g, const char* filename, GameSaveProgressFn progress, void* ctx);
+
+/**
+ * @brief Saves the world to @p filename without blocking the caller.
+ *
+ * A child process writes a copy-on-write snapshot of the world as it is
+ * now (see bgsave.h); the game goes on meanwhile and the end of the save
+ * is reported through GameState::on_save from game_tick(). If a journal
+ * is open for @p filename the journal is flushed instead, at once.
+ *
+ * @param out_started Receives true if a background save was started,
+ *        false if the save already completed; may be NULL.
+ * @return CORE_OK on success, CORE_ERR_BUSY while another background save
+ *         runs, CORE_ERR_FILE if the save could not be started.
+ */
+CoreResult game_save_background(GameState* g, const char* filename, bool* out_started);
+
+/**
+ * @brief Waits for a running background save to @p filename and reports
+ *        its end through GameState::on_save.
+ *
+ * @param filename Save file, or NULL to wait for any background save.
+ */
+void game_wait_save(GameState* g, const char* filename);
+
+/**
+ * @brief Returns the progress of the running background save in percent,
+ *        or -1 if none is running.
+ */
+int game_save_percent(const GameState* g);
+
+/**
+ * @brief Starts journaling changes against @p filename, or stops.
+ *
+ * Replaces any open journal (see journal.h). A background save to the
+ * same file is waited for first.
+ *
+ * @param filename Save file, or NULL to stop journaling.
+ * @return CORE_OK, or CORE_ERR_FILE if the journal could not be created.
+ */
+CoreResult game_journal(GameState* g, const char* filename);
+
+/**
+ * @brief Saves to @p filename in the background every @p ticks ticks.
+ *
+ * @param ticks Interval in ticks; 0 turns autosave off.
+ * @param filename File to save to; ignored when turning autosave off.
+ * @return CORE_OK, or CORE_ERR_INVALID_ARG for a negative interval or a
+ *         missing or too long file name.
+ */
+CoreResult game_set_autosave(GameState* g, int ticks, const char* filename);
 /**
  * @brief Load game state from a JSON save file.
  *
+ * The file is read as a stream, filling the world server by server, so
+ * memory use is the world itself plus a fixed read buffer. The current
+ * world is only replaced once the whole file has loaded; on failure it is
+ * kept. Binary world files are recognised by their header and mapped
+ * instead. Change logs left next to @p filename by a journal (see
+ * journal.h) are replayed on top. An open journal is closed.
+ *
  * @param g Pointer to GameState to populate.
  * @param filename Path to JSON save file.
  * @return true on success, false on failure.
  */
 bool game_load(GameState* g, const char* filename);
+/**
+ * @brief Schedules an action to take effect @p delay ticks from now.
+ *
+ * ACTION_CONNECT moves the player to the target if it is linked to the
+ * current server at that time. ACTION_SCAN has no effect on the world and
+ * only reports back. ACTION_DOWNLOAD moves up to @p a.value money from the
+ * target to the home server.
+ *
+ * @param g Pointer to the GameState.
+ * @param a Action to schedule.
+ * @param delay Ticks to wait; 0 fires on the next tick.
+ * @return CORE_OK on success, otherwise a CoreResult error code.
+ */
+CoreResult game_schedule(GameState* g, Action a, int delay);
+
 /**
  * @brief Simulates one tick.
  *
+ * Advances the tick counter and applies every scheduled action that is due
+ * on the new tick, reporting each through GameState::on_action. Also
+ * reaps a finished background save, starts a due autosave and lets an
+ * open journal compact.
+ *
  * @param g Pointer to the GameState
  */
 void game_tick(GameState* g);
@@ -22,20 +22,136 @@ typedef struct {
     int users_per_router_max;
     int floors_per_building_min; /* floors within a building (optional) */
     int floors_per_building_max;
-    double inter_router_link_density;
+    double inter_router_link_density; /* chance of a link between two routers in different subnets */
+    double intra_subnet_link_density; /* chance of a link between two routers in the same subnet */
     double public_dmz_fraction;
+    int threads; /* worker threads; 0 or less means one per online CPU */
+    int compact_names; /* keep generated names as coordinates (see ServerCoord) instead of strings */
 } GeneratorParams;
 
-/* Generate a network using explicit parameters and an optional seed.
- * If seed == 0 the global RNG is used; otherwise the seed will be applied
- * for deterministic generation.
+/* Upper bound on generator worker threads. */
+#define GENERATOR_MAX_THREADS 64
+
+/* Seed used when the caller passes 0. */
+#define GENERATOR_DEFAULT_SEED 12345u
+
+/* Generate a network using explicit parameters and a seed. The same seed
+ * and parameters always give the same world; seed == 0 means
+ * GENERATOR_DEFAULT_SEED. No global RNG state is used or modified.
+ *
+ * Neighbourhoods are sized up front, built on worker threads into private
+ * blocks that already know their final ids, and spliced into the world in
+ * order, so the thread count never changes the result.
  */
 void generator_generate_with_params(GameState* g, const GeneratorParams* params, unsigned int seed);
 
+/* Wall-clock seconds spent in each stage of generator_generate_timed(). */
+typedef struct {
+    double plan;           /* sizing every neighbourhood from the shape streams */
+    double isps;
+    double neighbourhoods; /* building neighbourhood blocks on worker threads */
+    double splice;         /* areas, and copying the blocks into the world */
+    double mesh;
+    double freeze;         /* packing the links */
+} GeneratorTimings;
+
+/* generator_generate_with_params() that also reports where the time went.
+ * `timings` may be NULL. */
+void generator_generate_timed(GameState* g, const GeneratorParams* params, unsigned int seed,
+                              GeneratorTimings* timings);
+
+/* Fill `params` with the defaults used by generator_generate_city(). */
+void generator_city_params(GeneratorParams* params);
+
+/* Checks parameters read back from a save: every min <= max, every range
+ * fits the packed server names, and the ISP, area and neighbourhood
+ * counts don't exceed `server_count`, the servers the save holds. */
+bool generator_params_valid(const GeneratorParams* params, int server_count);
+
 /* Convenience: generate a city-like network with sensible defaults. Use
- * seed==0 to rely on the program RNG or provide a seed for reproducible
- * output.
+ * seed==0 for the default world or provide another seed.
  */
 void generator_generate_city(GameState* g, unsigned int seed);
 
+/* The parts of a lazily generated world that are still to be built. */
+typedef struct GenLazy GenLazy;
+
+/* Generate a world lazily: ISPs, areas and neighbourhood servers are
+ * created now, everything below a neighbourhood only when
+ * generator_lazy_expand() is called for it. Returns the handle that
+ * expansion needs (free with generator_lazy_free()), or NULL on failure.
+ *
+ * An expanded neighbourhood holds the same servers as in the eagerly
+ * generated world, only under different ids. Mesh links never leave a
+ * neighbourhood and are drawn from per-neighbourhood streams.
+ */
+GenLazy* generator_generate_lazy(GameState* g, const GeneratorParams* params, unsigned int seed);
+
+/* Builds the subtree under neighbourhood `id` if it has not been built
+ * yet. Returns the number of servers added (0 if there was nothing to do)
+ * or -1 on failure, which leaves the world unchanged so the expansion can
+ * be tried again. */
+int generator_lazy_expand(GenLazy* lz, GameState* g, ServerId id);
+
+void generator_lazy_free(GenLazy* lz);
+
+/* What a save keeps of a lazily generated world so it can go on growing
+ * once loaded: how it was generated and which neighbourhoods were built.
+ * expanded_count is -1 for a world with nothing left to generate. */
+typedef struct {
+    GeneratorParams params;
+    unsigned int seed;
+    ServerId first_isp;
+    ServerId* expanded; /* neighbourhood servers already expanded, ascending */
+    int expanded_count;
+} GenLazyState;
+
+/* Fills `out` with the state of `lz` (NULL for a complete world). Free
+ * with generator_lazy_state_free(). Returns false if memory ran out. */
+bool generator_lazy_save_state(const GenLazy* lz, GenLazyState* out);
+
+/* Rebuilds the GenLazy of a loaded world from its saved state. The ISP,
+ * area and neighbourhood servers are checked against `st`; returns NULL
+ * if they don't match or `state` holds no lazy world. */
+GenLazy* generator_lazy_resume(const GenLazyState* state, const ServerStore* st);
+
+/* Marks neighbourhood `id` as expanded without building it, for servers
+ * that came back from a save or a journal. Returns its job index, or -1
+ * if `id` is not a neighbourhood of `lz`. */
+int generator_lazy_mark_expanded(GenLazy* lz, ServerId id);
+
+void generator_lazy_state_free(GenLazyState* state);
+
+/* Receives a generated world one server at a time, in id order, without a
+ * GameState ever holding it. Every callback returns false to abort.
+ *
+ * server() gets the server's data as entry `local` of a scratch store
+ * (read it with the server_* accessors) plus its complete, final list of
+ * links. Both are only valid during the call.
+ */
+typedef struct {
+    void* ctx;
+    bool (*begin)(void* ctx, int server_count, ServerId home_server);
+    bool (*server)(void* ctx, ServerId id, const ServerStore* st, ServerId local,
+                   const ServerId* links, int link_count);
+    bool (*end)(void* ctx);
+} GenSink;
+
+/* Streams the world that game_init() followed by
+ * generator_generate_with_params() would build (a "home" server at id 0,
+ * then the generated network) into `sink`.
+ *
+ * Only the plan of ISPs, areas and neighbourhoods, a batch of
+ * neighbourhood blocks being built on worker threads and the mesh links
+ * are held in memory, so the cost grows with the number of neighbourhoods
+ * rather than with the number of servers.
+ */
+bool generator_stream(const GeneratorParams* params, unsigned int seed, const GenSink* sink);
+
+/* Streams a generated world straight into a JSON save file that
+ * game_load() reads, byte-identical to what game_save() writes for the
+ * same world.
+ */
+bool generator_write_save(const GeneratorParams* params, unsigned int seed, const char* filename);
+
 #endif // INCLUDE_GENERATOR_H_
@@ -0,0 +1,108 @@
+/**
+ * @file journal.h
+ * @brief Incremental saves: a snapshot plus an append-only change log.
+ *
+ * While a journal is open for a save file F, every change to the world
+ * (the player moving, money changing hands, servers and links appearing
+ * as a lazy world is explored) is appended to F.journal as a small
+ * checksummed record. Saving F then only has to flush the log.
+ *
+ * Once the log passes its size threshold it is compacted: the log is set
+ * aside as F.journal.1, a new one is started, and a forked child writes a
+ * fresh snapshot of the world to F with game_save() while the game goes
+ * on. When the child succeeds F.journal.1 is deleted.
+ *
+ * game_load() replays F.journal.1 and then F.journal on top of F, after
+ * a lazy world's plan has been rebuilt from F, so replayed expansions are
+ * not generated a second time. Records hold absolute values and replaying
+ * one twice is harmless, so a crash at any point leaves a snapshot and
+ * logs that load into the last recorded state. A torn record at the end
+ * of a log ends its replay.
+ */
+#ifndef INCLUDE_JOURNAL_H_
+#define INCLUDE_JOURNAL_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "game.h"
+
+#define JOURNAL_EXT ".journal"              /**< Appended to the save name. */
+#define JOURNAL_COMPACT_BYTES (4u << 20) /**< Default compaction threshold. */
+
+/** @brief An open journal. */
+typedef struct Journal Journal;
+
+/**
+ * @brief Starts journaling the world of @p g against save file @p filename.
+ *
+ * Any log already next to @p filename is kept for replay, and a
+ * compaction is started at once, so @p filename gets a snapshot of the
+ * current world in the background.
+ *
+ * @param compact_bytes Log size that triggers a compaction; 0 for
+ *        JOURNAL_COMPACT_BYTES.
+ * @return The journal, or NULL if the log could not be created.
+ */
+Journal* journal_open(const GameState* g, const char* filename, size_t compact_bytes);
+
+/**
+ * @brief Flushes and closes @p j, waiting for a running compaction.
+ */
+void journal_close(Journal* j);
+
+/** @brief Returns the save file @p j belongs to. */
+const char* journal_filename(const Journal* j);
+
+/** @brief Returns true while a compaction child is running. */
+bool journal_compacting(const Journal* j);
+
+/** @brief Returns the size of the live log in bytes. */
+size_t journal_size(const Journal* j);
+
+/** @brief Records that the player is now on @p id. */
+void journal_record_current(Journal* j, ServerId id);
+
+/** @brief Records the new balance of server @p id. */
+void journal_record_money(Journal* j, ServerId id, int money);
+
+/** @brief Records a link from @p from to @p to. */
+void journal_record_link(Journal* j, ServerId from, ServerId to);
+
+/**
+ * @brief Records that lazy neighbourhood @p id was expanded; its servers
+ *        and links are recorded after it.
+ */
+void journal_record_expand(Journal* j, ServerId id);
+
+/** @brief Records server @p id of @p st in full, services included. */
+void journal_record_server(Journal* j, const ServerStore* st, ServerId id);
+
+/**
+ * @brief Makes every record so far durable (fflush and fsync).
+ *
+ * @return true on success.
+ */
+bool journal_sync(Journal* j);
+
+/**
+ * @brief Reaps a finished compaction and starts one if the log is over
+ *        its threshold. Called once per tick.
+ */
+void journal_poll(Journal* j, const GameState* g);
+
+/**
+ * @brief Replays the logs of save file @p filename onto @p g.
+ *
+ * @return true if the logs were missing or read up to their end; false if
+ *         replay stopped at a damaged record.
+ */
+bool journal_replay(GameState* g, const char* filename);
+
+/**
+ * @brief Deletes the logs of save file @p filename, for when a complete
+ *        save replaces it.
+ */
+void journal_discard(const char* filename);
+
+#endif  // INCLUDE_JOURNAL_H_
@@ -0,0 +1,110 @@
+/**
+ * @file json_reader.h
+ * @brief Streaming pull parser for JSON, the reading side of json_writer.h.
+ *
+ * The document is read from a FILE in fixed-size chunks and handed out
+ * one value at a time, so memory use does not depend on the size of the
+ * document. The caller walks the structure it expects: open a container,
+ * ask for the next key or element until the container reports that it
+ * closed, and read or skip each value. Commas, colons and whitespace are
+ * handled by the reader.
+ *
+ * Strings are unescaped into caller buffers and truncated to fit; the
+ * rest of a long string is consumed and dropped.
+ *
+ * Errors are sticky: once the input is malformed or a read fails every
+ * later call returns 0 and json_reader_ok() reports the failure.
+ */
+#ifndef INCLUDE_JSON_READER_H_
+#define INCLUDE_JSON_READER_H_
+
+#include <stddef.h>
+#include <stdio.h>
+
+#define JSON_READER_MAX_DEPTH 32      /**< Deepest supported nesting. */
+#define JSON_READER_BUF_SIZE (1 << 16) /**< Bytes read from the file at a time. */
+
+/**
+ * @brief Kind of the next value in the input.
+ */
+typedef enum {
+    JSON_VALUE_INVALID = 0, /**< Malformed input or end of file. */
+    JSON_VALUE_OBJECT,
+    JSON_VALUE_ARRAY,
+    JSON_VALUE_STRING,
+    JSON_VALUE_NUMBER,
+    JSON_VALUE_BOOL,
+    JSON_VALUE_NULL
+} JsonValueType;
+
+/**
+ * @brief Reader state. Initialize with json_reader_init().
+ */
+typedef struct {
+    FILE* f;                                       /**< Source. */
+    size_t pos;                                    /**< Next unread byte in @ref buf. */
+    size_t len;                                    /**< Bytes held in @ref buf. */
+    int depth;                                     /**< Number of open containers. */
+    unsigned char has_items[JSON_READER_MAX_DEPTH]; /**< Per level: an item was read. */
+    int failed;                                    /**< Malformed input or a read error. */
+    char buf[JSON_READER_BUF_SIZE];                /**< Current chunk of the file. */
+} JsonReader;
+
+/**
+ * @brief Starts a reader on @p f. The file is not closed by the reader.
+ *
+ * A leading UTF-8 byte order mark is skipped.
+ */
+void json_reader_init(JsonReader* r, FILE* f);
+
+/**
+ * @brief Returns the kind of the next value without consuming it.
+ */
+JsonValueType json_peek(JsonReader* r);
+
+/** @brief Consumes the opening `{` of an object. @return non-zero on success. */
+int json_read_object(JsonReader* r);
+
+/**
+ * @brief Reads the next key of the innermost object and its `:`.
+ *
+ * @param key Buffer for the key.
+ * @param size Size of @p key in bytes.
+ * @return 1 if a key was read and its value is next, 0 if the object
+ *         closed (or on error; see json_reader_ok()).
+ */
+int json_read_key(JsonReader* r, char* key, size_t size);
+
+/** @brief Consumes the opening `[` of an array. @return non-zero on success. */
+int json_read_array(JsonReader* r);
+
+/**
+ * @brief Moves to the next element of the innermost array.
+ *
+ * @return 1 if an element is next, 0 if the array closed (or on error).
+ */
+int json_read_next(JsonReader* r);
+
+/**
+ * @brief Reads a string value into @p out, truncated to @p size - 1 bytes.
+ *
+ * @return non-zero on success.
+ */
+int json_read_string(JsonReader* r, char* out, size_t size);
+
+/** @brief Reads a number value. @return non-zero on success. */
+int json_read_number(JsonReader* r, double* out);
+
+/**
+ * @brief Consumes the next value, whatever its kind.
+ *
+ * @return non-zero on success.
+ */
+int json_skip(JsonReader* r);
+
+/**
+ * @brief Returns non-zero if the input read so far was well-formed.
+ */
+int json_reader_ok(const JsonReader* r);
+
+#endif  // INCLUDE_JSON_READER_H_
@@ -0,0 +1,66 @@
+/**
+ * @file json_writer.h
+ * @brief Streaming JSON output without building a document tree.
+ *
+ * Values are written to a FILE as they are produced, so memory use does
+ * not depend on the size of the document. Commas and key separators are
+ * inserted automatically. The output matches cJSON_PrintUnformatted()
+ * byte for byte for the value kinds supported here (objects, arrays,
+ * strings and integers), so files stay interchangeable with ones written
+ * through cJSON.
+ *
+ * Write errors are sticky: once a write fails every later call is a
+ * no-op and json_writer_ok() reports the failure.
+ */
+#ifndef INCLUDE_JSON_WRITER_H_
+#define INCLUDE_JSON_WRITER_H_
+
+#include <stdio.h>
+
+#define JSON_WRITER_MAX_DEPTH 32 /**< Deepest supported nesting. */
+
+/**
+ * @brief Writer state. Initialize with json_writer_init().
+ */
+typedef struct {
+    FILE* f;                                /**< Destination. */
+    int depth;                              /**< Number of open containers. */
+    unsigned char has_items[JSON_WRITER_MAX_DEPTH]; /**< Per level: a value was written. */
+    int after_key;                          /**< A key was written; its value is next. */
+    int failed;                             /**< A write or nesting error happened. */
+} JsonWriter;
+
+/**
+ * @brief Starts a writer on @p f. The file is not closed by the writer.
+ */
+void json_writer_init(JsonWriter* w, FILE* f);
+
+/** @brief Opens an object (`{`). */
+void json_begin_object(JsonWriter* w);
+/** @brief Closes the innermost object (`}`). */
+void json_end_object(JsonWriter* w);
+/** @brief Opens an array (`[`). */
+void json_begin_array(JsonWriter* w);
+/** @brief Closes the innermost array (`]`). */
+void json_end_array(JsonWriter* w);
+
+/**
+ * @brief Writes an object key; the next call must write its value.
+ */
+void json_key(JsonWriter* w, const char* key);
+
+/** @brief Writes an integer value. */
+void json_int(JsonWriter* w, long long v);
+
+/** @brief Writes a finite floating-point value that reads back exactly. */
+void json_double(JsonWriter* w, double v);
+
+/** @brief Writes a string value (NULL writes an empty string). */
+void json_string(JsonWriter* w, const char* s);
+
+/**
+ * @brief Returns non-zero if every write so far succeeded.
+ */
+int json_writer_ok(const JsonWriter* w);
+
+#endif  // INCLUDE_JSON_WRITER_H_
@@ -0,0 +1,161 @@
+/**
+ * @file link_graph.h
+ * @brief Compressed-sparse-row adjacency store for the server network.
+ *
+ * Links go through two phases. While the world is being built, links are
+ * appended to a staging list, which is cheap and has no per-node limit.
+ * link_graph_freeze() then packs every link into CSR form: one offsets
+ * array indexed by ServerId and one packed array of neighbour IDs, so a
+ * node's links are a single contiguous run of memory.
+ *
+ * Queries only see frozen links. Links added after a freeze stay staged
+ * until the next link_graph_freeze(), which merges them in.
+ */
+#ifndef INCLUDE_LINK_GRAPH_H_
+#define INCLUDE_LINK_GRAPH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "core_result.h"
+#include "server.h"
+
+/**
+ * @brief A single staged, unidirectional link.
+ */
+typedef struct {
+    ServerId from; /**< Source server. */
+    ServerId to;   /**< Target server. */
+} LinkEdge;
+
+/**
+ * @brief Adjacency store for all server links.
+ *
+ * A zero-initialized LinkGraph is a valid empty graph.
+ */
+typedef struct {
+    /* frozen phase (CSR) */
+    uint32_t* offsets;   /**< node_count + 1 offsets into @ref neighbors. */
+    ServerId* neighbors; /**< Packed neighbour IDs, grouped by source. */
+    int node_count;      /**< Number of nodes covered by @ref offsets. */
+    uint32_t edge_count; /**< Number of frozen links. */
+    uint64_t generation; /**< Changes on every freeze; 0 if never frozen. */
+
+    /* staging phase */
+    LinkEdge* staged;    /**< Links added since the last freeze. */
+    size_t staged_count; /**< Number of staged links. */
+    size_t staged_cap;   /**< Capacity of @ref staged. */
+
+    void* map;      /**< File mapping the CSR arrays live in, or NULL. */
+    size_t map_len; /**< Length of @ref map in bytes. */
+} LinkGraph;
+
+/**
+ * @brief Initializes an empty link graph.
+ *
+ * @param lg Pointer to the graph.
+ */
+void link_graph_init(LinkGraph* lg);
+
+/**
+ * @brief Releases all memory owned by the graph and leaves it empty.
+ *
+ * @param lg Pointer to the graph.
+ */
+void link_graph_free(LinkGraph* lg);
+
+/**
+ * @brief Stages a unidirectional link from @p from to @p to.
+ *
+ * @param lg Pointer to the graph.
+ * @param from Source server.
+ * @param to Target server.
+ * @return CORE_OK on success, otherwise a CoreResult error code.
+ */
+CoreResult link_graph_add(LinkGraph* lg, ServerId from, ServerId to);
+
+/**
+ * @brief Stages a link in both directions between @p a and @p b.
+ *
+ * @param lg Pointer to the graph.
+ * @param a First server.
+ * @param b Second server.
+ * @return CORE_OK on success, CORE_ERR_INVALID_ARG for self-links.
+ */
+CoreResult link_graph_add_bidirectional(LinkGraph* lg, ServerId a, ServerId b);
+
+/**
+ * @brief Stages a copy of every link staged in @p src, in order.
+ *
+ * Frozen links of @p src are ignored. Lets independently built blocks of
+ * links be merged before one freeze.
+ *
+ * @param dst Graph to stage the links in.
+ * @param src Graph whose staged links are copied; left unchanged.
+ * @return CORE_OK on success, otherwise a CoreResult error code.
+ */
+CoreResult link_graph_append_staged(LinkGraph* dst, const LinkGraph* src);
+
+/**
+ * @brief Packs all staged links into the CSR arrays.
+ *
+ * Existing frozen links are kept; staged links are appended after them in
+ * insertion order. Duplicate links are dropped, as are links whose
+ * endpoints fall outside 0..node_count-1. The graph gets a new
+ * @ref LinkGraph::generation, unique across all graphs, so indexes
+ * derived from the links can tell they are stale.
+ *
+ * @param lg Pointer to the graph.
+ * @param node_count Number of servers in the world.
+ * @return CORE_OK on success, otherwise a CoreResult error code.
+ */
+CoreResult link_graph_freeze(LinkGraph* lg, int node_count);
+
+/**
+ * @brief Makes @p lg use CSR arrays that live in a file mapping.
+ *
+ * The arrays are checked first (offsets start at 0, never decrease and
+ * end at @p edge_count; every neighbour is below @p node_count). On
+ * success the graph is freed and replaced, owns the mapping, and unmaps
+ * it on the next freeze or link_graph_free(). On failure nothing changes.
+ *
+ * @param lg Graph to replace.
+ * @param offsets @p node_count + 1 offsets, inside @p map.
+ * @param neighbors @p edge_count neighbour IDs, inside @p map.
+ * @param node_count Number of nodes.
+ * @param edge_count Number of links.
+ * @param map Start of the mapping (from mmap()).
+ * @param map_len Length of the mapping.
+ * @return CORE_OK, or CORE_ERR_INVALID_ARG if the arrays are inconsistent.
+ */
+CoreResult link_graph_adopt_mapping(LinkGraph* lg, uint32_t* offsets, ServerId* neighbors, int node_count,
+                                    uint32_t edge_count, void* map, size_t map_len);
+
+/**
+ * @brief Returns true if there are no staged links left to freeze.
+ */
+int link_graph_is_frozen(const LinkGraph* lg);
+
+/**
+ * @brief Returns the frozen neighbours of a server.
+ *
+ * The returned pointer stays valid until the next freeze or free.
+ *
+ * @param lg Pointer to the graph.
+ * @param id Server to query.
+ * @param out_count Receives the number of neighbours.
+ * @return Pointer to @p *out_count neighbour IDs (NULL when there are none).
+ */
+const ServerId* link_graph_neighbors(const LinkGraph* lg, ServerId id, int* out_count);
+
+/**
+ * @brief Returns the number of frozen links leaving @p id.
+ */
+int link_graph_degree(const LinkGraph* lg, ServerId id);
+
+/**
+ * @brief Returns non-zero if there is a frozen link from @p from to @p to.
+ */
+int link_graph_has_link(const LinkGraph* lg, ServerId from, ServerId to);
+
+#endif  // INCLUDE_LINK_GRAPH_H_
@@ -0,0 +1,79 @@
+/**
+ * @file rng.h
+ * @brief Small, explicitly seeded random number streams.
+ *
+ * Each Rng is an independent xoshiro256** generator whose state is filled
+ * from a 64-bit key with splitmix64. Keys for substreams are derived with
+ * rng_key() from a parent key and an index, so e.g. every building can
+ * own a stream keyed by (seed, isp, area, neighbourhood, building). The
+ * numbers a subtree sees then depend only on its own path, not on how
+ * much randomness was consumed elsewhere or in which order (or on which
+ * thread) subtrees are generated.
+ *
+ * There is no global state; nothing here touches rand().
+ */
+#ifndef INCLUDE_RNG_H_
+#define INCLUDE_RNG_H_
+
+#include <stdint.h>
+
+/**
+ * @brief One random stream.
+ */
+typedef struct {
+    uint64_t s[4]; /**< xoshiro256** state; never all zero. */
+} Rng;
+
+/**
+ * @brief Derives the key of substream @p index of @p parent.
+ *
+ * Distinct (parent, index) pairs give unrelated keys.
+ */
+uint64_t rng_key(uint64_t parent, uint64_t index);
+
+/**
+ * @brief Initializes @p r as the stream identified by @p key.
+ */
+void rng_init(Rng* r, uint64_t key);
+
+/**
+ * @brief Returns the next 64 random bits.
+ */
+static inline uint64_t rng_next(Rng* r) {
+    uint64_t* s = r->s;
+    uint64_t x = s[1] * 5;
+    uint64_t result = ((x << 7) | (x >> 57)) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = (s[3] << 45) | (s[3] >> 19);
+    return result;
+}
+
+/**
+ * @brief Returns a uniform integer in [0, @p n); 0 when @p n is 0.
+ */
+static inline uint32_t rng_below(Rng* r, uint32_t n) {
+    /* multiply-shift; the bias is below 2^-32 and irrelevant here */
+    return (uint32_t)(((rng_next(r) >> 32) * (uint64_t)n) >> 32);
+}
+
+/**
+ * @brief Returns a uniform integer in [@p min, @p max]; @p min if max <= min.
+ */
+static inline int rng_range(Rng* r, int min, int max) {
+    if (max <= min) return min;
+    return min + (int)rng_below(r, (uint32_t)(max - min) + 1);
+}
+
+/**
+ * @brief Returns a uniform double in [0, 1).
+ */
+static inline double rng_unit(Rng* r) {
+    return (double)(rng_next(r) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+#endif  // INCLUDE_RNG_H_
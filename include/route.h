@@ -0,0 +1,76 @@
+/**
+ * @file route.h
+ * @brief Shortest hop paths over the link graph.
+ *
+ * Paths are found with a bidirectional breadth-first search that grows
+ * whichever side has the smaller frontier, one whole level at a time. All
+ * working memory (visited bitsets, parent and depth arrays, frontier
+ * queues and the result path) belongs to the RouteFinder and is reused
+ * across queries; it only grows when the graph gains nodes. Visited bits
+ * are reset through a list of touched words, so a query costs time in
+ * proportion to the nodes it visits rather than to the size of the world.
+ *
+ * Links are treated as undirected, as the generator always creates them
+ * in both directions.
+ */
+#ifndef INCLUDE_ROUTE_H_
+#define INCLUDE_ROUTE_H_
+
+#include <stdint.h>
+
+#include "link_graph.h"
+#include "server.h"
+
+/**
+ * @brief Per-direction search state.
+ */
+typedef struct {
+    uint64_t* seen;     /**< Visited bitset, one bit per node. */
+    uint32_t* touched;  /**< Indices of non-zero words in @ref seen. */
+    int touched_count;  /**< Number of entries in @ref touched. */
+    ServerId* parent;   /**< BFS parent; valid only for visited nodes. */
+    int32_t* depth;     /**< Hops from the root; valid only for visited nodes. */
+    ServerId* queue;    /**< Visited nodes in BFS order. */
+} RouteSide;
+
+/**
+ * @brief Reusable routing workspace.
+ *
+ * A zero-initialized RouteFinder is valid; buffers are allocated by the
+ * first query.
+ */
+typedef struct {
+    RouteSide fwd;   /**< Search from the source. */
+    RouteSide bwd;   /**< Search from the target. */
+    ServerId* path;  /**< Last result, source first. */
+    int capacity;    /**< Number of nodes the buffers are sized for. */
+} RouteFinder;
+
+/**
+ * @brief Initializes an empty routing workspace.
+ */
+void route_init(RouteFinder* rf);
+
+/**
+ * @brief Releases all buffers and leaves the workspace empty.
+ */
+void route_free(RouteFinder* rf);
+
+/**
+ * @brief Finds a shortest path between two servers.
+ *
+ * Only frozen links are followed.
+ *
+ * @param rf Workspace.
+ * @param lg Link graph to search.
+ * @param from Source server.
+ * @param to Target server.
+ * @param out_len Receives the number of servers on the path, including
+ *        both ends (1 when @p from == @p to, 0 when there is no path).
+ * @return The path, source first, valid until the next query; NULL if
+ *         either endpoint is out of range, @p to is unreachable or the
+ *         buffers could not be allocated.
+ */
+const ServerId* route_find(RouteFinder* rf, const LinkGraph* lg, ServerId from, ServerId to, int* out_len);
+
+#endif  // INCLUDE_ROUTE_H_
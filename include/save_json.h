@@ -0,0 +1,84 @@
+/**
+ * @file save_json.h
+ * @brief Layout of JSON save files, written through a JsonWriter.
+ *
+ * A save is one object:
+ *
+ *     {"version":1,"game":{"server_count":N,"home_server":H,
+ *      "current_server":C,"servers":[<server>, ...]}}
+ *
+ * followed by a newline. A lazily generated world adds a "lazy" object
+ * after "servers" with its seed, first ISP id, generator parameters and
+ * the neighbourhoods already expanded, so it can keep growing once loaded. game_save() and generator_write_save() both
+ * write it through these calls, one server at a time, so neither holds
+ * more than the server being written. save_json_read() loads it back the
+ * same way.
+ */
+#ifndef INCLUDE_SAVE_JSON_H_
+#define INCLUDE_SAVE_JSON_H_
+
+#include <stdbool.h>
+
+#include "generator.h"
+#include "json_reader.h"
+#include "json_writer.h"
+#include "link_graph.h"
+#include "server.h"
+
+#define SAVE_JSON_ID_SLACK 4096 /**< Ids allowed ahead of the records read. */
+
+/**
+ * @brief Writes everything before the first server.
+ */
+void save_json_begin(JsonWriter* w, int server_count, ServerId home_server, ServerId current_server);
+
+/**
+ * @brief Writes one element of the "servers" array.
+ *
+ * @param id Id the server is saved under.
+ * @param st Store holding the server.
+ * @param local Id of the server inside @p st; differs from @p id when
+ *        @p st only holds part of the world.
+ * @param links Neighbour ids to save for it.
+ * @param link_count Number of entries in @p links.
+ */
+void save_json_server(JsonWriter* w, ServerId id, const ServerStore* st, ServerId local,
+                      const ServerId* links, int link_count);
+
+/**
+ * @brief Closes the document and writes the trailing newline.
+ *
+ * @param lazy State of a lazily generated world, written as the "lazy"
+ *        object after the servers; NULL or an expanded_count of -1 for a
+ *        complete world, which leaves the file as before.
+ * @return non-zero if every write of the save succeeded.
+ */
+int save_json_end(JsonWriter* w, const GenLazyState* lazy);
+
+/**
+ * @brief Reads a save into an empty store and link graph.
+ *
+ * Servers are added to @p st as their objects are read, with their names
+ * indexed and their links staged; the links are frozen at the end. Keys
+ * may come in any order and unknown keys are skipped. Missing server
+ * fields take the defaults of server_store_add().
+ *
+ * Server ids must be below the declared server_count, or, for servers
+ * listed before it, below twice the records read plus
+ * SAVE_JSON_ID_SLACK; the home and current servers must exist. A damaged
+ * file can't grow the store without bound or leave the player nowhere.
+ *
+ * @param r Reader positioned at the start of the document.
+ * @param st Empty store to fill.
+ * @param lg Empty link graph to fill.
+ * @param home_server Receives the saved home server.
+ * @param current_server Receives the saved current server.
+ * @param lazy Receives the lazy generation state, with an expanded_count
+ *        of -1 if the save has none; free with generator_lazy_state_free().
+ *        May be NULL.
+ * @return true if the document was well-formed and held a world.
+ */
+bool save_json_read(JsonReader* r, ServerStore* st, LinkGraph* lg, ServerId* home_server,
+                    ServerId* current_server, GenLazyState* lazy);
+
+#endif  // INCLUDE_SAVE_JSON_H_
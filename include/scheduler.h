@@ -0,0 +1,125 @@
+/**
+ * @file scheduler.h
+ * @brief Hierarchical timing wheel for actions that fire on a future tick.
+ *
+ * The wheel has SCHED_LEVELS levels of SCHED_SLOTS slots each. Level 0
+ * holds events due within the next SCHED_SLOTS ticks, one slot per tick;
+ * each higher level covers SCHED_SLOTS times the range of the one below.
+ * When the lower level wraps, the due slot of the next level is cascaded
+ * down. Scheduling and firing are O(1) per event, and a tick only touches
+ * the events due in that tick.
+ *
+ * Events live in a growable pool linked by index, so there is no fixed cap
+ * on the number of pending actions.
+ */
+#ifndef INCLUDE_SCHEDULER_H_
+#define INCLUDE_SCHEDULER_H_
+
+#include <stdint.h>
+
+#include "core_result.h"
+
+#define SCHED_SLOT_BITS 6                    /**< log2 of slots per level. */
+#define SCHED_SLOTS (1 << SCHED_SLOT_BITS)   /**< Slots per level. */
+#define SCHED_LEVELS 4                       /**< Number of wheel levels. */
+
+/**
+ * @brief An enum for Action types.
+ *
+ * Contains all the different types of actions.
+ */
+typedef enum {
+    ACTION_CONNECT,
+    ACTION_SCAN,
+    ACTION_DOWNLOAD,
+    ACTION_NOP,
+} ActionType;
+
+/**
+ * @brief Represents an action.
+ */
+typedef struct {
+    ActionType type;   /**< Type of action. */
+    int target_server; /**< The server the action should run on. */
+    int value;         /**< Optional: The value/argument for the action. */
+} Action;
+
+/**
+ * @brief A pending action in the wheel.
+ */
+typedef struct {
+    Action action; /**< The scheduled action. */
+    uint64_t due;  /**< Tick on which the action fires. */
+    int32_t next;  /**< Next event in the same slot (or free list), -1 ends. */
+} SchedEvent;
+
+/**
+ * @brief Doubly-ended list of events in one wheel slot.
+ */
+typedef struct {
+    int32_t head; /**< First event, -1 if empty. */
+    int32_t tail; /**< Last event, -1 if empty. */
+} SchedSlot;
+
+/**
+ * @brief The timing wheel.
+ */
+typedef struct {
+    SchedSlot wheel[SCHED_LEVELS][SCHED_SLOTS]; /**< Slot lists per level. */
+    SchedSlot overflow; /**< Events beyond the range of the top level. */
+    SchedEvent* events; /**< Event pool. */
+    int32_t cap;        /**< Capacity of @ref events. */
+    int32_t free_head;  /**< First free pool entry, -1 if none. */
+    int32_t pending;    /**< Number of scheduled, not yet fired events. */
+    uint64_t now;       /**< Last processed tick. */
+} Scheduler;
+
+/**
+ * @brief Callback invoked for every action that becomes due.
+ *
+ * @param ctx User pointer passed to scheduler_advance().
+ * @param a The action that fired.
+ */
+typedef void (*SchedFireFn)(void* ctx, const Action* a);
+
+/**
+ * @brief Initializes an empty scheduler positioned at tick @p now.
+ *
+ * @param s Scheduler to initialize.
+ * @param now Current tick.
+ */
+void scheduler_init(Scheduler* s, uint64_t now);
+
+/**
+ * @brief Drops all pending events and releases the event pool.
+ *
+ * @param s Scheduler to free.
+ */
+void scheduler_free(Scheduler* s);
+
+/**
+ * @brief Schedules @p a to fire @p delay ticks from now.
+ *
+ * A delay of 0 fires on the next processed tick.
+ *
+ * @param s Scheduler.
+ * @param a Action to schedule.
+ * @param delay Number of ticks to wait.
+ * @return CORE_OK on success, otherwise a CoreResult error code.
+ */
+CoreResult scheduler_schedule(Scheduler* s, Action a, uint32_t delay);
+
+/**
+ * @brief Advances the wheel by one tick and fires every event due on it.
+ *
+ * Events fire in the order they were scheduled. The callback may schedule
+ * new events.
+ *
+ * @param s Scheduler.
+ * @param fire Callback for each due action.
+ * @param ctx User pointer handed to @p fire.
+ * @return Number of actions fired.
+ */
+int scheduler_advance(Scheduler* s, SchedFireFn fire, void* ctx);
+
+#endif  // INCLUDE_SCHEDULER_H_
@@ -35,7 +35,7 @@ int script_api_init(GameState* g);
  * The `ht` shape (subject to extension) will look like:
  *
  * ht = {
- *   net = { scan, connect, get_current, list_servers, save },
+ *   net = { scan, connect, get_current, list_servers, route, distance, save },
  *   log = { info },
  * }
  *
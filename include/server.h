@@ -1,11 +1,12 @@
 #ifndef INCLUDE_SERVER_H_
 #define INCLUDE_SERVER_H_
 
+#include <stddef.h>
 #include <stdint.h>
 #include "core_result.h"
+#include "rng.h"
 
 #define SERVER_NAME_LEN 32  /**< Maximum length of a server name. */
-#define SERVER_MAX_LINKS 16 /**< Maximum number of links a server can have. */
 #define MAX_SERVICES_PER_SERVER 4 /**< Maximum number of services per server. */
 #define SERVICE_NAME_LEN 16 /**< Max length for a service name. */
 
@@ -16,13 +17,6 @@ typedef int ServerId;
 
 #define SERVER_INVALID_ID (-1) /**< Represents an invalid server ID. */
 
-/**
- * @brief Represents a single connection from one server to another.
- */
-typedef struct {
-    ServerId to; /**< ID of the linked server. */
-} ServerLink;
-
 /* ServerType: broad classification for servers and network devices.
  * Numeric values preserve the original ROLE_* assignments for
  * compatibility with existing saves.
@@ -45,58 +39,283 @@ typedef enum {
 } ServerType;
 
 /**
- * @brief Represents a server in the game network.
+ * @brief A network service exposed by a server.
+ */
+typedef struct {
+    int port;                    /**< TCP port number. */
+    char name[SERVICE_NAME_LEN]; /**< Service name (e.g. "ssh", "http"). */
+    int vuln_level;              /**< Simple vulnerability rating (0=no vuln..10=very vulnerable). */
+} Service;
+
+/**
+ * @brief Shape of a generated name that can be kept as coordinates.
+ *
+ * Each kind is one fixed name pattern of the city generator, e.g.
+ * SERVER_NAME_ROUTER is "rtr_b<building>_n<neigh>_a<area>_p<isp>_r<router>".
+ */
+typedef enum {
+    SERVER_NAME_STORED = 0,   /**< Not a coordinate name; kept as a string. */
+    SERVER_NAME_ISP,          /**< isp<isp> */
+    SERVER_NAME_AREA,         /**< area<area>_i<isp> */
+    SERVER_NAME_NEIGH,        /**< neigh<neigh>_a<area>_p<isp> */
+    SERVER_NAME_BUILDING,     /**< bld<building>_n<neigh>_a<area>_p<isp> */
+    SERVER_NAME_FLOOR,        /**< floor<floor>_b<building>_n<neigh>_a<area>_p<isp> */
+    SERVER_NAME_ROUTER,       /**< rtr_b<building>_n<neigh>_a<area>_p<isp>_r<router> */
+    SERVER_NAME_FLOOR_ROUTER, /**< rtr_floor<floor>_b<building>_..._r<router> */
+    SERVER_NAME_USER          /**< usr<user> */
+} ServerNameKind;
+
+/**
+ * @brief Position of a generated server in the city hierarchy.
+ *
+ * Fields hold the numbers exactly as they appear in the name (1-based);
+ * fields the kind does not use are ignored.
+ */
+typedef struct {
+    ServerNameKind kind;
+    int isp, area, neigh, building, floor, router;
+    int user;
+} ServerCoord;
+
+/**
+ * @brief One slot of the server name index.
+ */
+typedef struct {
+    uint32_t hash; /**< Hash of the indexed name. */
+    ServerId id;   /**< Server owning the name, or SERVER_INVALID_ID. */
+} NameSlot;
+
+/**
+ * @brief Struct-of-arrays store holding every server in the world.
  *
- * Stores identity, gameplay stats, network connections, and other info.
+ * Each server is a ServerId index into a set of parallel columns. The hot
+ * scalar columns (type, security, money, subnet) are dense arrays, so
+ * whole-world passes are linear scans. Names and services are cold and
+ * live in side tables: names in a shared string pool, services in a
+ * shared pool where each server owns one contiguous run. Network links
+ * are kept in the world's LinkGraph (see link_graph.h).
+ *
+ * Generated servers may instead carry an implicit name: only their
+ * packed ServerCoord is kept, and the name is formatted when asked for
+ * and parsed back by server_find_by_name().
+ *
+ * Every non-empty name is also kept in a hash index, updated on insert and
+ * rename, so server_find_by_name() does not scan the world. When several
+ * servers share a name the index keeps the lowest ID, and the extra
+ * servers are counted in @ref name_dups.
+ *
+ * IDs are assigned in order and never reused, so a ServerId stays valid
+ * while the store grows. Columns are reallocated on growth, so do not keep
+ * pointers into them across insertions. A zero-initialized ServerStore is
+ * a valid empty store.
  */
 typedef struct {
-    ServerId id;                /**< Unique identifier for the server. */
-    char name[SERVER_NAME_LEN]; /**< Human-readable name of the server. */
+    int count; /**< Number of servers currently in use. */
+    int cap;   /**< Allocated capacity of every column. */
+
+    /* hot columns */
+    uint8_t* type;      /**< ServerType per server. */
+    int32_t* security;  /**< Security level per server. */
+    int32_t* money;     /**< Resource amount per server. */
+    int32_t* subnet_id; /**< Subnet (building) per server, -1 if none. */
+
+    /* cold side tables */
+    uint32_t* name_off; /**< Offset of each server's name in @ref names. */
+    uint64_t* coord;    /**< Packed coordinates of an implicit name, 0 for a stored one. */
+    char* names;        /**< String pool of NUL-terminated names. */
+    size_t names_len;   /**< Bytes used in @ref names. */
+    size_t names_cap;   /**< Bytes allocated for @ref names. */
+
+    uint32_t* svc_first;  /**< First service index per server. */
+    uint8_t* svc_count;   /**< Number of services per server. */
+    Service* services;    /**< Service pool. */
+    size_t services_len;  /**< Entries used in @ref services. */
+    size_t services_cap;  /**< Entries allocated for @ref services. */
+
+    /* name -> id index (open addressing, linear probing) */
+    NameSlot* name_slots; /**< Hash slots; id == SERVER_INVALID_ID marks empty. */
+    uint32_t name_mask;   /**< Slot count - 1 (slot count is a power of two). */
+    uint32_t name_used;   /**< Number of occupied slots. */
+    int name_dups;        /**< Servers whose name was already taken when indexed. */
+
+    /* file mapping the columns may point into (see server_store_adopt_mapping()) */
+    void* map;      /**< Start of the mapping, or NULL when every column is malloc'd. */
+    size_t map_len; /**< Length of @ref map in bytes. */
+} ServerStore;
+
+/* ---------------- STORE ---------------- */
+
+/**
+ * @brief Initializes an empty server store.
+ *
+ * @param store Pointer to the store to initialize.
+ */
+void server_store_init(ServerStore* store);
+
+/**
+ * @brief Releases every column and side table and leaves the store empty.
+ *
+ * @param store Pointer to the store to free.
+ */
+void server_store_free(ServerStore* store);
+
+/**
+ * @brief Appends a new server with default values.
+ *
+ * Defaults: security 1, money 0, subnet -1, type SERVER_TYPE_UNKNOWN and
+ * no services.
+ *
+ * @param store Pointer to the store.
+ * @param name Name of the new server (truncated to SERVER_NAME_LEN - 1).
+ * @return ID of the new server, or SERVER_INVALID_ID on allocation failure.
+ */
+ServerId server_store_add(ServerStore* store, const char* name);
 
-    /* Gameplay stats */
-    int security; /**< Security level of the server. */
-    int money;    /**< Resource amount associated with the server. */
+/**
+ * @brief Appends a new server with an implicit name and default values.
+ *
+ * Falls back to storing the formatted name when a coordinate is too large
+ * to pack. Implicit names are never truncated.
+ *
+ * @param store Pointer to the store.
+ * @param coord Coordinates the name is made from.
+ * @return ID of the new server, or SERVER_INVALID_ID on failure.
+ */
+ServerId server_store_add_coord(ServerStore* store, const ServerCoord* coord);
+
+/**
+ * @brief Grows the store so that IDs 0..count-1 are valid.
+ *
+ * Newly exposed servers get default values and an empty name. Used by
+ * loaders that place servers at explicit IDs.
+ *
+ * @param store Pointer to the store.
+ * @param count Required number of servers.
+ * @return CORE_OK on success, otherwise a CoreResult error code.
+ */
+CoreResult server_store_resize(ServerStore* store, int count);
+
+/**
+ * @brief Appends every server of @p src to @p dst, in order.
+ *
+ * Server i of @p src becomes server dst->count + i. Columns and pools are
+ * copied in bulk and the names are added to @p dst's index. Values that
+ * hold IDs (such as the subnet) are copied as they are, so @p src must
+ * already use the IDs its servers will have in @p dst. Used to splice
+ * blocks built independently, e.g. on worker threads.
+ *
+ * @param dst Store to append to.
+ * @param src Servers to append; left unchanged.
+ * @return CORE_OK on success, otherwise a CoreResult error code.
+ */
+CoreResult server_store_append(ServerStore* dst, const ServerStore* src);
+
+/**
+ * @brief Makes @p store use columns that live in a file mapping.
+ *
+ * @p view holds the column and side-table pointers (into @p map), the
+ * counts and the name index; capacities are ignored. Every table is
+ * checked first, so a corrupt file is rejected instead of read out of
+ * bounds. On success the store owns the mapping: it is written
+ * copy-on-write, copied to the heap on the first change that needs more
+ * room, and unmapped by server_store_free(). On failure nothing changes
+ * and the caller keeps the mapping.
+ *
+ * @param store Store to replace; freed first on success.
+ * @param view Columns to adopt.
+ * @param map Start of the mapping (from mmap()).
+ * @param map_len Length of the mapping.
+ * @return CORE_OK, or CORE_ERR_INVALID_ARG if a table is inconsistent.
+ */
+CoreResult server_store_adopt_mapping(ServerStore* store, const ServerStore* view, void* map, size_t map_len);
+
+/**
+ * @brief Returns non-zero if @p id refers to a server in the store.
+ */
+int server_valid(const ServerStore* store, ServerId id);
 
-    /* Network topology */
-    ServerLink links[SERVER_MAX_LINKS]; /**< Array of links to other servers. */
-    int link_count;                     /**< Number of active links. */
+/**
+ * @brief Looks up a server by exact name.
+ *
+ * @param store Pointer to the store.
+ * @param name Name to look up.
+ * @return ID of the lowest-numbered server with that name, or
+ *         SERVER_INVALID_ID if there is none.
+ */
+ServerId server_find_by_name(const ServerStore* store, const char* name);
 
-    /* Future-proofing */
-    int subnet_id; /**< Reserved for future use (currently unused). */
-    
-    /* Broad type/category of this server. Use `ServerType` for values. */
-    ServerType type; /**< Broad type/category of this server. */
+/**
+ * @brief Returns how many servers carry a name already used by a
+ * lower-numbered server.
+ *
+ * Such servers cannot be reached by name. Long generated names are
+ * truncated to SERVER_NAME_LEN - 1 and are the usual cause.
+ */
+int server_name_duplicates(const ServerStore* store);
 
-    struct {
-        int port;                       /**< TCP port number. */
-        char name[SERVICE_NAME_LEN];    /**< Service name (e.g. "ssh", "http"). */
-        int vuln_level;                 /**< Simple vulnerability rating (0=no vuln..10=very vulnerable). */
-    } services[MAX_SERVICES_PER_SERVER];
-    int service_count; /**< Number of active services on this server. */
-} Server;
+/* ---------------- ACCESSORS ----------------
+ * Getters expect a valid ID; check with server_valid() first when the ID
+ * comes from outside the store.
+ */
 
-/* ---------------- HELPERS ---------------- */
+/**
+ * @brief Returns the name of server @p id.
+ *
+ * Implicit names are formatted into a small per-thread ring of buffers,
+ * so the result stays valid for the next few calls only; copy it to keep
+ * it longer.
+ */
+const char* server_name(const ServerStore* store, ServerId id);
+/** @brief Returns the type of server @p id. */
+ServerType server_type(const ServerStore* store, ServerId id);
+/** @brief Returns the security level of server @p id. */
+int server_security(const ServerStore* store, ServerId id);
+/** @brief Returns the money held by server @p id. */
+int server_money(const ServerStore* store, ServerId id);
+/** @brief Returns the subnet of server @p id (-1 if none). */
+int server_subnet(const ServerStore* store, ServerId id);
 
 /**
- * @brief Returns a pointer to a linked server.
+ * @brief Returns the services of server @p id.
  *
- * @param s Pointer to the source server.
- * @param all Array of all servers.
- * @param index Index of the link in @p s->links to follow.
- * @return Pointer to the linked Server, or NULL if invalid.
+ * @param store Pointer to the store.
+ * @param id Server to query.
+ * @param out_count Receives the number of services.
+ * @return Pointer to @p *out_count services, valid until the store changes.
  */
-const Server* server_get_linked(const Server* s, const Server* all, int index);
+const Service* server_services(const ServerStore* store, ServerId id, int* out_count);
 
-/* ---------------- LIFECYCLE ---------------- */
+/** @brief Renames server @p id. */
+CoreResult server_set_name(ServerStore* store, ServerId id, const char* name);
+/** @brief Sets the type of server @p id. */
+void server_set_type(ServerStore* store, ServerId id, ServerType type);
+/** @brief Sets the security level of server @p id. */
+void server_set_security(ServerStore* store, ServerId id, int security);
+/** @brief Sets the money held by server @p id. */
+void server_set_money(ServerStore* store, ServerId id, int money);
+/** @brief Sets the subnet of server @p id. */
+void server_set_subnet(ServerStore* store, ServerId id, int subnet_id);
 
 /**
- * @brief Initializes a server with an ID and name.
+ * @brief Adds a service to server @p id.
  *
- * @param s Pointer to the Server to initialize.
- * @param id ID to assign.
- * @param name Name of the server.
+ * @param store Pointer to the store.
+ * @param id Server to modify.
+ * @param port TCP port.
+ * @param name Service name (truncated to SERVICE_NAME_LEN - 1).
+ * @param vuln_level Vulnerability rating.
+ * @return CORE_OK on success, CORE_ERR_INVALID_ARG if the server already has
+ *         MAX_SERVICES_PER_SERVER services, or another CoreResult on failure.
+ */
+CoreResult server_add_service(ServerStore* store, ServerId id, int port, const char* name,
+                              int vuln_level);
+
+/**
+ * @brief Removes every service from server @p id.
  */
-void server_init(Server* s, ServerId id, const char* name);
+void server_clear_services(ServerStore* store, ServerId id);
+
+/* ---------------- TYPES ---------------- */
 
 /* Convert ServerType to a short lowercase string for JSON export (e.g. "isp", "tor", "user").
  * String names are stable across versions and easier to read in exports.
@@ -108,36 +327,40 @@ const char* server_type_to_string(ServerType t);
  */
 ServerType server_type_from_string(const char* s);
 
-/* ---------------- NETWORK ---------------- */
+/* ---------------- NAMES ---------------- */
 
 /**
- * @brief Adds a unidirectional link from this server to another.
+ * @brief Writes the name for @p coord into @p buf (snprintf semantics).
  *
- * @param s Pointer to the Server.
- * @param to ID of the server to link to.
- * @return CORE_OK on success, otherwise a CoreResult error code.
+ * @return Length of the full name, or -1 for SERVER_NAME_STORED.
  */
-CoreResult server_add_link(Server* s, ServerId to);
+int server_coord_format(const ServerCoord* coord, char* buf, size_t len);
 
 /**
- * @brief Adds a bidirectional link between two servers.
+ * @brief Parses a coordinate name.
  *
- * @param a Pointer to the first server.
- * @param b Pointer to the second server.
- * @return CORE_OK on success, otherwise a CoreResult error code.
+ * Only names server_coord_format() would produce are accepted (no leading
+ * zeros, signs or spaces).
+ *
+ * @return Non-zero if @p name is a coordinate name.
  */
-CoreResult server_link_bidirectional(Server* a, Server* b);
+int server_coord_parse(const char* name, ServerCoord* out);
 
 /* ---------------- RANDOM ---------------- */
 
 /**
- * @brief Generates a new server with a random ID.
+ * @brief Generates a new server with random stats and services.
  *
- * @param servers Array of existing servers.
- * @param server_count Pointer to the number of servers (updated on success).
+ * @param store Store to append the server to.
  * @param name Name of the new server.
- * @return ID of the generated server.
+ * @param rng Stream the stats and services are drawn from.
+ * @return ID of the generated server, or SERVER_INVALID_ID on failure.
+ */
+ServerId server_generate_random(ServerStore* store, const char* name, Rng* rng);
+
+/**
+ * @brief Like server_generate_random() with an implicit name.
  */
-ServerId server_generate_random(Server* servers, int* server_count, const char* name);
+ServerId server_generate_random_coord(ServerStore* store, const ServerCoord* coord, Rng* rng);
 
 #endif  // INCLUDE_SERVER_H_
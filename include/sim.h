@@ -0,0 +1,93 @@
+/**
+ * @file sim.h
+ * @brief Simulation thread: runs commands and ticks apart from the UI.
+ *
+ * Once started, the simulation thread owns the GameState (and the Lua
+ * state reached through commands). The UI thread talks to it only through
+ * two lock-free SPSC rings: command lines go in, and output lines, state
+ * snapshots and the quit notice come back. Ticking at the fixed tick rate
+ * and rendering at the frame rate therefore never wait on each other.
+ *
+ * Neither side polls. The simulation sleeps in poll() on a timerfd that
+ * fires once per tick and an eventfd that sim_post_command() signals. The
+ * UI can add sim_notify_fd() to its own poll set to wake only when output
+ * or a snapshot is waiting.
+ */
+#ifndef INCLUDE_SIM_H_
+#define INCLUDE_SIM_H_
+
+#include <stdbool.h>
+
+#include "game.h"
+
+#define SIM_TEXT_MAX 1024 /**< Longest command or output line, including NUL. */
+
+/**
+ * @brief Kinds of message sent from the simulation to the UI.
+ */
+typedef enum {
+    SIM_EVENT_PRINT,    /**< A line of command output in @ref SimEvent::text. */
+    SIM_EVENT_SNAPSHOT, /**< State summary; @ref SimEvent::text holds the current server name. */
+    SIM_EVENT_QUIT      /**< A command requested quit; the thread has stopped. */
+} SimEventType;
+
+/**
+ * @brief One message from the simulation thread to the UI thread.
+ */
+typedef struct {
+    SimEventType type;
+    int tick;               /**< Snapshot: current tick. */
+    int pending;            /**< Snapshot: scheduled actions not yet fired. */
+    int saving;             /**< Snapshot: background save progress in percent, or -1. */
+    char text[SIM_TEXT_MAX];
+} SimEvent;
+
+/** Opaque simulation thread handle. */
+typedef struct Sim Sim;
+
+/**
+ * @brief Starts the simulation thread.
+ *
+ * From this point on only the simulation thread may touch @p g until
+ * sim_stop() returns.
+ *
+ * @param g Initialized game state.
+ * @param tps Ticks per second.
+ * @return Handle, or NULL if the rings or thread could not be created.
+ */
+Sim* sim_start(GameState* g, int tps);
+
+/**
+ * @brief Stops the thread (if still running), joins it and frees the handle.
+ */
+void sim_stop(Sim* s);
+
+/**
+ * @brief Queues a command line for the simulation (UI thread only).
+ *
+ * @return false if the command queue is full; the line is not queued.
+ */
+bool sim_post_command(Sim* s, const char* line);
+
+/**
+ * @brief Takes the next message from the simulation (UI thread only).
+ *
+ * @return true if @p out was filled, false if nothing is waiting.
+ */
+bool sim_poll_event(Sim* s, SimEvent* out);
+
+/**
+ * @brief File descriptor that becomes readable when events are queued.
+ *
+ * Intended for poll(). After it polls readable, call sim_ack_notify()
+ * and then drain sim_poll_event() until it returns false; events queued
+ * after the acknowledgement signal the descriptor again.
+ */
+int sim_notify_fd(const Sim* s);
+
+/**
+ * @brief Resets the descriptor returned by sim_notify_fd() (UI thread only).
+ */
+void sim_ack_notify(Sim* s);
+
+#endif  // INCLUDE_SIM_H_
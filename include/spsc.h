@@ -0,0 +1,60 @@
+/**
+ * @file spsc.h
+ * @brief Lock-free single-producer/single-consumer ring of fixed-size slots.
+ *
+ * Exactly one thread may push and exactly one (other) thread may pop.
+ * Head and tail are C11 atomics on separate cache lines; a push publishes
+ * the slot with a release store and a pop observes it with an acquire
+ * load, so no locks are needed. The ring never blocks: push fails when
+ * full and pop fails when empty.
+ */
+#ifndef INCLUDE_SPSC_H_
+#define INCLUDE_SPSC_H_
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define SPSC_CACHE_LINE 64 /**< Assumed cache line size for padding. */
+
+/**
+ * @brief The ring. Initialize with spsc_init() before use.
+ */
+typedef struct {
+    _Alignas(SPSC_CACHE_LINE) atomic_size_t head; /**< Next slot to pop (consumer-owned). */
+    _Alignas(SPSC_CACHE_LINE) atomic_size_t tail; /**< Next slot to push (producer-owned). */
+    _Alignas(SPSC_CACHE_LINE) unsigned char* slots; /**< Slot storage. */
+    size_t elem_size; /**< Bytes per slot. */
+    size_t mask;      /**< Capacity - 1 (capacity is a power of two). */
+} SpscRing;
+
+/**
+ * @brief Allocates a ring.
+ *
+ * @param r Ring to initialize.
+ * @param elem_size Size of one element in bytes.
+ * @param capacity Number of slots; rounded up to a power of two.
+ * @return 0 on success, -1 on allocation failure.
+ */
+int spsc_init(SpscRing* r, size_t elem_size, size_t capacity);
+
+/**
+ * @brief Releases the ring's storage. No thread may be using it.
+ */
+void spsc_free(SpscRing* r);
+
+/**
+ * @brief Copies @p elem into the ring (producer thread only).
+ *
+ * @return true on success, false if the ring is full.
+ */
+bool spsc_push(SpscRing* r, const void* elem);
+
+/**
+ * @brief Copies the oldest element into @p out (consumer thread only).
+ *
+ * @return true on success, false if the ring is empty.
+ */
+bool spsc_pop(SpscRing* r, void* out);
+
+#endif  // INCLUDE_SPSC_H_
@@ -2,6 +2,7 @@
 #define INCLUDE_UI_H_
 
 #include <stdarg.h>
+#include <stddef.h>
 
 /* ---------------- LIFECYCLE ---------------- */
 
@@ -12,6 +13,14 @@
  */
 void ui_init(void);
 
+/**
+ * @brief Initializes the UI in headless mode.
+ *
+ * No terminal is taken over: ui_print() writes each line to stdout and
+ * rendering and status calls do nothing. Used by batch mode.
+ */
+void ui_init_headless(void);
+
 /**
  * @brief Shuts down the user interface subsystem.
  *
@@ -19,6 +28,19 @@ void ui_init(void);
  */
 void ui_shutdown(void);
 
+/**
+ * @brief Sets how much output history the terminal view keeps.
+ *
+ * The budget covers the text itself (the store grows toward it on demand
+ * and is rounded down to a power of two); once it is reached the oldest
+ * lines are dropped. Lowering the budget discards the current history.
+ * The default is 8 MiB; the HACKTERM_SCROLLBACK_KB environment variable
+ * overrides it at ui_init().
+ *
+ * @param bytes Byte budget for scrollback text.
+ */
+void ui_set_scrollback_budget(size_t bytes);
+
 /* ---------------- INPUT/OUTPUT ---------------- */
 
 /**
@@ -31,6 +53,23 @@ void ui_shutdown(void);
  */
 void ui_print(const char* fmt, ...);
 
+/**
+ * @brief Receives formatted ui_print() lines instead of the output window.
+ */
+typedef void (*UiPrintSink)(const char* line, void* ctx);
+
+/**
+ * @brief Redirects ui_print() on the calling thread only.
+ *
+ * Curses may only be driven from the UI thread, so other threads that run
+ * commands install a sink that forwards lines to the UI thread, which then
+ * prints them itself. Pass NULL to restore normal output.
+ *
+ * @param sink Function receiving each formatted line, or NULL.
+ * @param ctx User pointer passed to @p sink.
+ */
+void ui_set_print_sink(UiPrintSink sink, void* ctx);
+
 /**
  * @brief Set status bar text shown at the top of the UI.
  *
@@ -42,6 +81,10 @@ void ui_set_status(const char* fmt, ...);
 /**
  * @brief Reads a line of input from the user.
  *
+ * Handles every key event already available (including a bracketed paste,
+ * delivered to the active view as one block) and returns as soon as one
+ * completes a line. Call again until it returns 0 to drain the input.
+ *
  * @param buf Buffer to store the input line.
  * @param max Maximum number of characters to read (including null terminator).
  * @return Number of characters read, not including the null terminator.
@@ -57,4 +100,22 @@ int ui_readline_nonblocking(char* buf, int max);
  */
 void ui_render(void);
 
+/**
+ * @brief Reports whether ui_render() has anything to draw.
+ *
+ * Lets an event loop sleep while nothing on screen has changed.
+ *
+ * @return Non-zero if some part of the screen is marked dirty.
+ */
+int ui_render_pending(void);
+
+/**
+ * @brief Adopts the terminal's current size.
+ *
+ * Call after a SIGWINCH when curses' own handler is not in use (e.g. the
+ * signal is blocked and read from a signalfd). Queries the size, resizes
+ * curses and rebuilds the layout; the next ui_render() redraws everything.
+ */
+void ui_resize(void);
+
 #endif  // INCLUDE_UI_H_
@@ -23,8 +23,9 @@ typedef struct UIView UIView;
  * @brief View render callback.
  *
  * Called by the UI rendering loop to draw the view into the provided
- * content window. The view should not call `wrefresh()` for the whole
- * screen; normal drawing conventions apply.
+ * content window, only on frames where the view area was marked dirty.
+ * The view should stage its window with `wnoutrefresh()` rather than
+ * `wrefresh()`; the renderer flushes all windows with one `doupdate()`.
  *
  * @param win Window allocated for the view's main content area.
  */
@@ -72,6 +73,12 @@ struct UIView {
      * bytes written into `buf`, or 0 if none is available.
      */
     int (*fetch_line)(char* buf, int max);
+    /**
+     * Optional: receive a bracketed paste as one block of raw bytes (not
+     * NUL-terminated). Views without it get the bytes one at a time
+     * through `handle_input`.
+     */
+    void (*handle_paste)(const char* text, int len);
 };
 
 /**
@@ -112,4 +119,12 @@ int ui_view_handle_input(int ch);
  */
 int ui_view_fetch_line(char* buf, int max);
 
+/**
+ * @brief Deliver a pasted block to the active view.
+ *
+ * Uses the view's `handle_paste` callback when present, otherwise feeds
+ * the bytes to `handle_input` one by one.
+ */
+void ui_view_handle_paste(const char* text, int len);
+
 #endif // INCLUDE_UI_VIEW_H_
@@ -0,0 +1,59 @@
+/**
+ * @file world_file.h
+ * @brief Binary world saves that load with mmap().
+ *
+ * A world file holds the server columns, the name pool and index, the
+ * service pool and the CSR link arrays exactly as they sit in memory, each
+ * in its own 8-byte aligned section behind a fixed header:
+ *
+ *     header | type | security | money | subnet | coord | name_off | names
+ *            | svc_first | svc_count | services | name_slots
+ *            | link_offsets | links | lazy | lazy_expanded
+ *
+ * All values are little-endian. The header records the format version
+ * and the offset and size of every section. Loading maps the file
+ * copy-on-write and points the ServerStore and LinkGraph at the sections,
+ * so the only work is one bounds check over each table; nothing is parsed
+ * or copied until the world grows. The two lazy sections are empty
+ * unless the world was generated lazily, in which case they hold what it
+ * needs to keep growing (see GenLazyState).
+ *
+ * JSON saves (game_save()/game_load()) stay the interchange format; the
+ * two hold the same world.
+ */
+#ifndef INCLUDE_WORLD_FILE_H_
+#define INCLUDE_WORLD_FILE_H_
+
+#include <stdbool.h>
+
+#include "game.h"
+
+#define WORLD_FILE_VERSION 2   /**< Format written by world_file_save(). */
+#define WORLD_FILE_EXT ".htw"  /**< Extension game_save() writes binary for. */
+
+/**
+ * @brief Writes the world of @p g to @p filename in the binary format.
+ *
+ * Only frozen links are written, as with JSON saves. The file is written
+ * next to its destination and renamed into place.
+ *
+ * @return true on success.
+ */
+bool world_file_save(const GameState* g, const char* filename);
+
+/**
+ * @brief Replaces the world of @p g with the one in @p filename.
+ *
+ * The file is validated before anything in @p g changes; on failure the
+ * current world is kept.
+ *
+ * @return true on success.
+ */
+bool world_file_load(GameState* g, const char* filename);
+
+/**
+ * @brief Returns true if @p filename starts with the world file magic.
+ */
+bool world_file_detect(const char* filename);
+
+#endif  // INCLUDE_WORLD_FILE_H_
@@ -0,0 +1,136 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "batch.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "commands.h"
+
+/* Drain stops after this many ticks even if actions remain (e.g. far
+ * future events), so a batch always terminates. */
+#define BATCH_DRAIN_MAX_TICKS 1000000
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void sleep_ns(uint64_t ns) {
+    struct timespec ts;
+    ts.tv_sec = (time_t)(ns / 1000000000ull);
+    ts.tv_nsec = (long)(ns % 1000000000ull);
+    nanosleep(&ts, NULL);
+}
+
+static int cmp_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentile over a sorted sample. */
+static uint64_t percentile(const uint64_t* sorted, int n, int pct) {
+    if (n == 0) return 0;
+    int idx = (int)(((int64_t)n * pct + 99) / 100) - 1;
+    if (idx < 0) idx = 0;
+    if (idx >= n) idx = n - 1;
+    return sorted[idx];
+}
+
+static void print_summary(uint64_t* lat, int n, int ticks, uint64_t wall_ns, uint64_t cmd_ns) {
+    qsort(lat, (size_t)n, sizeof(*lat), cmp_u64);
+    double wall_s = (double)wall_ns / 1e9;
+    double cmd_s = (double)cmd_ns / 1e9;
+
+    fprintf(stderr, "--- batch summary ---\n");
+    fprintf(stderr, "commands:     %d\n", n);
+    fprintf(stderr, "ticks:        %d\n", ticks);
+    fprintf(stderr, "wall time:    %.3f s\n", wall_s);
+    if (n > 0) {
+	fprintf(stderr, "latency (us): min %.1f  avg %.1f  p50 %.1f  p99 %.1f  max %.1f\n",
+	        lat[0] / 1e3, (double)cmd_ns / n / 1e3, percentile(lat, n, 50) / 1e3,
+	        percentile(lat, n, 99) / 1e3, lat[n - 1] / 1e3);
+    }
+    if (cmd_s > 0) fprintf(stderr, "throughput:   %.0f commands/s (command time only)\n", n / cmd_s);
+    if (wall_s > 0) fprintf(stderr, "tick rate:    %.0f ticks/s\n", ticks / wall_s);
+}
+
+void batch_default_options(BatchOptions* opts) {
+    if (!opts) return;
+    opts->tps = 0;
+    opts->ticks_per_command = 1;
+    opts->drain = 1;
+    opts->quiet = 0;
+}
+
+int batch_run(GameState* g, FILE* in, const BatchOptions* opts) {
+    if (!g || !in) return 0;
+    BatchOptions o;
+    if (opts) o = *opts; else batch_default_options(&o);
+
+    uint64_t tick_ns = o.tps > 0 ? 1000000000ull / (uint64_t)o.tps : 0;
+    uint64_t start = now_ns();
+    uint64_t next_tick = start + tick_ns;
+    uint64_t cmd_total = 0;
+    int ticks = 0;
+
+    int n = 0;
+    int cap = 1024;
+    uint64_t* lat = malloc((size_t)cap * sizeof(*lat));
+    if (!lat) return 0;
+
+    char line[1024];
+    while (fgets(line, sizeof(line), in)) {
+	line[strcspn(line, "\r\n")] = '\0';
+	const char* p = line;
+	while (*p == ' ' || *p == '\t') p++;
+	if (*p == '\0' || *p == '#') continue;
+
+	uint64_t t0 = now_ns();
+	CommandResult r = commands_run(g, p);
+	uint64_t dt = now_ns() - t0;
+	cmd_total += dt;
+
+	if (n == cap) {
+	    uint64_t* grown = realloc(lat, (size_t)cap * 2 * sizeof(*lat));
+	    if (!grown) break;
+	    lat = grown;
+	    cap *= 2;
+	}
+	lat[n++] = dt;
+	fflush(stdout);
+	if (r == CMD_QUIT) break;
+
+	if (tick_ns == 0) {
+	    for (int i = 0; i < o.ticks_per_command; i++, ticks++) game_tick(g);
+	} else {
+	    /* run every tick that fell due while the command executed */
+	    uint64_t now = now_ns();
+	    while (now >= next_tick) {
+		game_tick(g);
+		ticks++;
+		next_tick += tick_ns;
+	    }
+	}
+    }
+
+    if (o.drain) {
+	for (int i = 0; g->sched.pending > 0 && i < BATCH_DRAIN_MAX_TICKS; i++, ticks++) {
+	    if (tick_ns) {
+		uint64_t now = now_ns();
+		if (next_tick > now) sleep_ns(next_tick - now);
+		next_tick += tick_ns;
+	    }
+	    game_tick(g);
+	}
+    }
+    fflush(stdout);
+
+    if (!o.quiet) print_summary(lat, n, ticks, now_ns() - start, cmd_total);
+    free(lat);
+    return n;
+}
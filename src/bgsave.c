@@ -0,0 +1,116 @@
+/* bgsave.c - saves written by a forked child */
+#include "bgsave.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+struct BgSave {
+    char* filename;
+    pid_t pid;
+    int progress_fd; /* read end; the child writes one byte per percent step */
+    int percent;
+    BgSaveStatus status;
+};
+
+typedef struct {
+    int fd;
+    int last;
+} ChildProgress;
+
+/* Runs in the child. Writes are best effort: a parent that stopped
+ * listening must not fail the save. */
+static void child_progress(void* ctx, int done, int total) {
+    ChildProgress* p = ctx;
+    int percent = total > 0 ? (int)((long long)done * 100 / total) : 100;
+    if (percent <= p->last) return;
+    p->last = percent;
+    unsigned char b = (unsigned char)percent;
+    ssize_t r = write(p->fd, &b, 1);
+    (void)r;
+}
+
+BgSave* bgsave_start(const GameState* g, const char* filename) {
+    if (!g || !filename) return NULL;
+    BgSave* s = calloc(1, sizeof(*s));
+    if (!s) return NULL;
+    s->filename = strdup(filename);
+    int fds[2];
+    if (!s->filename || pipe(fds) != 0) {
+	free(s->filename);
+	free(s);
+	return NULL;
+    }
+
+    fflush(NULL);
+    pid_t pid = fork();
+    if (pid == 0) {
+	close(fds[0]);
+	ChildProgress p = { fds[1], -1 };
+	/* _exit: skip the parent's atexit handlers and stdio buffers */
+	_exit(game_save_progress(g, filename, child_progress, &p) ? 0 : 1);
+    }
+    close(fds[1]);
+    if (pid < 0) {
+	close(fds[0]);
+	free(s->filename);
+	free(s);
+	return NULL;
+    }
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    s->pid = pid;
+    s->progress_fd = fds[0];
+    s->status = BGSAVE_RUNNING;
+    return s;
+}
+
+static void read_progress(BgSave* s) {
+    unsigned char buf[128];
+    ssize_t n;
+    while ((n = read(s->progress_fd, buf, sizeof(buf))) > 0) s->percent = buf[n - 1];
+}
+
+static BgSaveStatus reap(BgSave* s, int block) {
+    if (s->status != BGSAVE_RUNNING) return s->status;
+    read_progress(s);
+    int wstatus = 0;
+    pid_t r;
+    do {
+	r = waitpid(s->pid, &wstatus, block ? 0 : WNOHANG);
+    } while (r < 0 && errno == EINTR);
+    if (r == 0) return BGSAVE_RUNNING;
+    read_progress(s);
+    close(s->progress_fd);
+    s->progress_fd = -1;
+    s->status = r > 0 && WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 0 ? BGSAVE_DONE : BGSAVE_FAILED;
+    if (s->status == BGSAVE_DONE) s->percent = 100;
+    return s->status;
+}
+
+BgSaveStatus bgsave_poll(BgSave* s) {
+    return s ? reap(s, 0) : BGSAVE_FAILED;
+}
+
+BgSaveStatus bgsave_wait(BgSave* s) {
+    return s ? reap(s, 1) : BGSAVE_FAILED;
+}
+
+int bgsave_percent(const BgSave* s) {
+    return s ? s->percent : 0;
+}
+
+const char* bgsave_filename(const BgSave* s) {
+    return s ? s->filename : NULL;
+}
+
+void bgsave_free(BgSave* s) {
+    if (!s) return;
+    bgsave_wait(s);
+    free(s->filename);
+    free(s);
+}
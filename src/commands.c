@@ -7,8 +7,11 @@
 #include "commands.h"
 #include "ui.h"
 #include "script.h"
+#include "journal.h"
 
 #define MAX_ARGS 100
+/* Ticks a download takes per point of target security. */
+#define DOWNLOAD_TICKS_PER_SECURITY 5
 
 /**
  * @brief Represents a shell command.
@@ -50,11 +53,47 @@ static CommandResult cmd_scan(GameState* g, int argc, char** argv);
  */
 static CommandResult cmd_connect(GameState* g, int argc, char** argv);
 
+/**
+ * @brief Show the shortest hop path to a server.
+ *
+ * Usage: `route <server>` (from the current server) or
+ * `route <from> <to>`.
+ */
+static CommandResult cmd_route(GameState* g, int argc, char** argv);
+
 /**
  * @brief Save the current game state to a file.
+ *
+ * The file is written in the background; its completion is reported by
+ * commands_report_save().
  */
 static CommandResult cmd_save(GameState* g, int argc, char** argv);
 
+/**
+ * @brief Save in the background on a timer.
+ *
+ * Usage: `autosave <ticks> [file]` saves every `<ticks>` ticks (to
+ * save.json by default); `autosave off` stops; `autosave` shows the state.
+ */
+static CommandResult cmd_autosave(GameState* g, int argc, char** argv);
+
+/**
+ * @brief Turn journaled saves on or off.
+ *
+ * Usage: `journal <file>` starts logging changes against a save file, so
+ * later `save <file>` calls only flush the log; `journal off` stops;
+ * `journal` shows the state.
+ */
+static CommandResult cmd_journal(GameState* g, int argc, char** argv);
+
+/**
+ * @brief Schedule a download of money from the current server.
+ *
+ * Usage: `download <amount>`. The transfer completes after a number of
+ * ticks that grows with the server's security.
+ */
+static CommandResult cmd_download(GameState* g, int argc, char** argv);
+
 /**
  * @brief Show recent script log entries.
  */
@@ -72,8 +111,12 @@ static const Command commands[] = {
     {"exit", "quit hackterm", cmd_exit},
     {"echo", "print text", cmd_echo},
     {"scan", "list servers connected to current server", cmd_scan},
-    {"connect", "connect to a linked server", cmd_connect},
+    {"connect", "connect to a linked server (-r: follow a route)", cmd_connect},
+    {"route", "show the hop path to a server: route [from] <to>", cmd_route},
     {"save", "save the game", cmd_save},
+    {"autosave", "save on a timer: autosave <ticks> [file]|off", cmd_autosave},
+    {"journal", "journal changes against a save: journal <file>|off", cmd_journal},
+    {"download", "download money from current server: download <amount>", cmd_download},
     {"run", "run a script: run <script> [args...]", cmd_run},
     {"scriptlog", "show recent script logs", cmd_scriptlog},
 };
@@ -104,9 +147,9 @@ static CommandResult cmd_help(GameState* g, int argc, char** argv) {
     (void)argc;
     (void)argv;
 
-    Server* cur = game_get_current_server(g);
+    const char* cur = game_server_name(g, g->current_server);
     if (cur) {
-	ui_print("Connected to: %s", cur->name);
+	ui_print("Connected to: %s", cur);
     }
 
     ui_print("Available commands:");
@@ -139,13 +182,13 @@ static CommandResult cmd_scan(GameState* g, int argc, char** argv) {
     (void)argc;
     (void)argv;
     int n = 0;
-    ServerId* connections = core_scan(g, &n);
+    const ServerId* connections = core_scan(g, &n);
     ui_print("Connected servers:");
     for (int i = 0; i < n; i++) {
     	ServerId id = connections[i];
-    	Server* s = game_get_server(g, id);
-    	if (s) {
-    		ui_print("  %s", s->name);
+    	const char* name = game_server_name(g, id);
+    	if (name) {
+    		ui_print("  %s", name);
     	} else {
     		ui_print("  <unknown> (%d)", id);
     	}
@@ -153,21 +196,48 @@ static CommandResult cmd_scan(GameState* g, int argc, char** argv) {
     return CMD_OK;
 }
 
+/* connect -r <server>: walk a shortest path, one hop at a time */
+static CommandResult connect_routed(GameState* g, const char* name) {
+    ServerId target = -1;
+    int hops = 0;
+    CoreResult cr = core_connect_route(g, name, &target, &hops);
+    const char* tname = game_server_name(g, target);
+    if (cr == CORE_OK) {
+	ui_print("Connected to %s (%d hop%s).", tname ? tname : name, hops, hops == 1 ? "" : "s");
+    } else if (cr == CORE_ERR_NOT_FOUND) {
+	ui_print("Server '%s' not found.", name);
+    } else if (cr == CORE_ERR_NOT_LINKED) {
+	const char* at = game_server_name(g, g->current_server);
+	if (hops > 0) {
+	    ui_print("Route to %s broken after %d hop%s; now at %s.", tname ? tname : name, hops,
+	             hops == 1 ? "" : "s", at ? at : "?");
+	} else {
+	    ui_print("No route to %s.", tname ? tname : name);
+	}
+    } else {
+	ui_print("Cannot connect to %s: error (%d).", name, cr);
+    }
+    return CMD_OK;
+}
+
 static CommandResult cmd_connect(GameState* g, int argc, char** argv) {
-    if (argc < 2) {
-	ui_print("Usage: connect <server_name>");
+    if (argc >= 3 && strcmp(argv[1], "-r") == 0) {
+	return connect_routed(g, argv[2]);
+    }
+    if (argc < 2 || strcmp(argv[1], "-r") == 0) {
+	ui_print("Usage: connect [-r] <server_name>");
 	return CMD_OK;
     }
     ServerId out_target = -1;
     CoreResult cr = core_connect(g, argv[1], &out_target);
     if (cr == CORE_OK) {
-	Server* s = game_get_server(g, out_target);
-	ui_print("Connected to %s.", s ? s->name : argv[1]);
+	const char* name = game_server_name(g, out_target);
+	ui_print("Connected to %s.", name ? name : argv[1]);
     } else if (cr == CORE_ERR_NOT_FOUND) {
 	ui_print("Server '%s' not found.", argv[1]);
     } else if (cr == CORE_ERR_NOT_LINKED) {
-	Server* s = game_get_server(g, out_target);
-	ui_print("Cannot connect to %s: not directly linked.", s ? s->name : argv[1]);
+	const char* name = game_server_name(g, out_target);
+	ui_print("Cannot connect to %s: not directly linked.", name ? name : argv[1]);
     } else if (cr == CORE_ERR_INVALID_ARG) {
 	ui_print("Invalid argument to connect.");
     } else {
@@ -177,11 +247,46 @@ static CommandResult cmd_connect(GameState* g, int argc, char** argv) {
     return CMD_OK;
 }
 
+static CommandResult cmd_route(GameState* g, int argc, char** argv) {
+    if (argc < 2) {
+	ui_print("Usage: route [from] <to>");
+	return CMD_OK;
+    }
+    const char* cur = game_server_name(g, g->current_server);
+    const char* from = (argc >= 3) ? argv[1] : (cur ? cur : "");
+    const char* to = (argc >= 3) ? argv[2] : argv[1];
+
+    const ServerId* path = NULL;
+    int len = 0;
+    CoreResult cr = core_route(g, from, to, &path, &len);
+    if (cr == CORE_ERR_NOT_FOUND) {
+	ui_print("Server '%s' not found.",
+	         server_find_by_name(&g->servers, from) == SERVER_INVALID_ID ? from : to);
+	return CMD_OK;
+    }
+    if (cr != CORE_OK) {
+	ui_print("No route from %s to %s.", from, to);
+	return CMD_OK;
+    }
+
+    ui_print("Route from %s to %s (%d hop%s):", from, to, len - 1, len == 2 ? "" : "s");
+    for (int i = 0; i < len; i++) {
+	const char* name = game_server_name(g, path[i]);
+	ui_print("  %d. %s", i, name ? name : "<unknown>");
+    }
+    return CMD_OK;
+}
+
 static CommandResult cmd_save(GameState* g, int argc, char** argv) {
     const char* file = (argc > 1) ? argv[1] : "save.json";
-    CoreResult cr = core_save(g, file);
-    if (cr == CORE_OK) {
+    bool started = false;
+    CoreResult cr = core_save_background(g, file, &started);
+    if (cr == CORE_OK && started) {
+	ui_print("Saving to %s in the background...", file);
+    } else if (cr == CORE_OK) {
 	ui_print("Game saved to %s", file);
+    } else if (cr == CORE_ERR_BUSY) {
+	ui_print("A save is already in progress; try again when it finishes.");
     } else if (cr == CORE_ERR_FILE) {
 	ui_print("Failed to save game to %s: file error.", file);
     } else if (cr == CORE_ERR_INVALID_ARG) {
@@ -192,6 +297,79 @@ static CommandResult cmd_save(GameState* g, int argc, char** argv) {
     return CMD_OK;
 }
 
+static CommandResult cmd_autosave(GameState* g, int argc, char** argv) {
+    if (argc < 2) {
+	if (g->autosave_ticks > 0) {
+	    ui_print("Autosaving to %s every %d ticks.", g->autosave_file, g->autosave_ticks);
+	} else {
+	    ui_print("Autosave is off.");
+	}
+	return CMD_OK;
+    }
+    if (strcmp(argv[1], "off") == 0) {
+	core_autosave(g, 0, NULL);
+	ui_print("Autosave stopped.");
+	return CMD_OK;
+    }
+    int ticks = atoi(argv[1]);
+    const char* file = (argc > 2) ? argv[2] : "save.json";
+    if (ticks <= 0 || core_autosave(g, ticks, file) != CORE_OK) {
+	ui_print("Usage: autosave <ticks> [file]|off");
+	return CMD_OK;
+    }
+    ui_print("Autosaving to %s every %d ticks.", file, ticks);
+    return CMD_OK;
+}
+
+static CommandResult cmd_journal(GameState* g, int argc, char** argv) {
+    if (argc < 2) {
+	if (!g->journal) {
+	    ui_print("Journaling is off.");
+	} else {
+	    ui_print("Journaling to %s (%zu bytes logged%s).", journal_filename(g->journal),
+	             journal_size(g->journal), journal_compacting(g->journal) ? ", compacting" : "");
+	}
+	return CMD_OK;
+    }
+    if (strcmp(argv[1], "off") == 0) {
+	core_journal(g, NULL);
+	ui_print("Journaling stopped.");
+	return CMD_OK;
+    }
+    if (core_journal(g, argv[1]) != CORE_OK) {
+	ui_print("Failed to start a journal for %s: file error.", argv[1]);
+	return CMD_OK;
+    }
+    ui_print("Journaling to %s; writing a snapshot in the background.", argv[1]);
+    return CMD_OK;
+}
+
+static CommandResult cmd_download(GameState* g, int argc, char** argv) {
+    if (argc < 2 || atoi(argv[1]) <= 0) {
+	ui_print("Usage: download <amount>");
+	return CMD_OK;
+    }
+    ServerId target = g->current_server;
+    if (target == g->home_server) {
+	ui_print("Nothing to download from your home server.");
+	return CMD_OK;
+    }
+    const char* name = game_server_name(g, target);
+    if (!name) {
+	ui_print("Not connected to a server.");
+	return CMD_OK;
+    }
+
+    Action a = {.type = ACTION_DOWNLOAD, .target_server = target, .value = atoi(argv[1])};
+    int delay = server_security(&g->servers, target) * DOWNLOAD_TICKS_PER_SECURITY;
+    if (game_schedule(g, a, delay) != CORE_OK) {
+	ui_print("Failed to start download.");
+	return CMD_OK;
+    }
+    ui_print("Downloading from %s (%d ticks)...", name, delay);
+    return CMD_OK;
+}
+
 static CommandResult cmd_run(GameState* g, int argc, char** argv) {
     (void)g;
     if (argc < 2) {
@@ -275,6 +453,45 @@ CommandResult commands_run(GameState* g, const char* input) {
     return CMD_OK;
 }
 
+/* Reports the end of a background save to the terminal */
+void commands_report_save(void* ctx, const char* filename, bool ok) {
+    (void)ctx;
+    if (ok) {
+	ui_print("Game saved to %s", filename);
+    } else {
+	ui_print("Failed to save game to %s: file error.", filename);
+    }
+}
+
+/* Reports the outcome of scheduled actions to the terminal */
+void commands_report_action(void* ctx, const Action* a, CoreResult result) {
+    GameState* g = ctx;
+    const char* name = game_server_name(g, a->target_server);
+    if (!name) name = "<unknown>";
+
+    switch (a->type) {
+	case ACTION_DOWNLOAD:
+	    if (result == CORE_OK) {
+		ui_print("Download from %s complete: %d credits.", name, a->value);
+	    } else {
+		ui_print("Download from %s failed: error (%d).", name, result);
+	    }
+	    break;
+	case ACTION_CONNECT:
+	    if (result == CORE_OK) {
+		ui_print("Connected to %s.", name);
+	    } else {
+		ui_print("Cannot connect to %s: error (%d).", name, result);
+	    }
+	    break;
+	case ACTION_SCAN:
+	    ui_print("Scan of %s finished.", name);
+	    break;
+	default:
+	    break;
+    }
+}
+
 /* Simple accessors so the UI can implement autocomplete */
 
 /**
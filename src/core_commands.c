@@ -6,20 +6,15 @@
 #include <stdbool.h>
 
 #include "game.h"
+#include "journal.h"
 
 /* --- Connect --- */
 CoreResult core_connect(GameState* g, const char* server_name, ServerId* out_target) {
     if (!g || !server_name) return CORE_ERR_INVALID_ARG;
 
-    ServerId target = -1;
-    for (int i = 0; i < g->server_count; i++) {
-	if (strcmp(g->servers[i].name, server_name) == 0) {
-	    target = i;
-	    break;
-	}
-    }
+    ServerId target = server_find_by_name(&g->servers, server_name);
 
-    if (target == -1) {
+    if (target == SERVER_INVALID_ID) {
 	if (out_target) *out_target = -1;
 	return CORE_ERR_NOT_FOUND;
     }
@@ -33,14 +28,57 @@ CoreResult core_connect(GameState* g, const char* server_name, ServerId* out_tar
     return CORE_OK;
 }
 
+CoreResult core_connect_route(GameState* g, const char* server_name, ServerId* out_target, int* out_hops) {
+    if (out_hops) *out_hops = 0;
+    if (!g || !server_name) return CORE_ERR_INVALID_ARG;
+
+    ServerId target = server_find_by_name(&g->servers, server_name);
+    if (out_target) *out_target = target;
+    if (target == SERVER_INVALID_ID) return CORE_ERR_NOT_FOUND;
+
+    return game_connect_route(g, target, out_hops);
+}
+
+/* --- Route --- */
+CoreResult core_route(GameState* g, const char* from_name, const char* to_name,
+                      const ServerId** out_path, int* out_len) {
+    if (out_path) *out_path = NULL;
+    if (out_len) *out_len = 0;
+    if (!g || !from_name || !to_name) return CORE_ERR_INVALID_ARG;
+
+    ServerId from = server_find_by_name(&g->servers, from_name);
+    ServerId to = server_find_by_name(&g->servers, to_name);
+    if (from == SERVER_INVALID_ID || to == SERVER_INVALID_ID) return CORE_ERR_NOT_FOUND;
+
+    int len = 0;
+    const ServerId* path = game_route(g, from, to, &len);
+    if (!path) return CORE_ERR_NOT_LINKED;
+    if (out_path) *out_path = path;
+    if (out_len) *out_len = len;
+    return CORE_OK;
+}
+
+/* --- Distance --- */
+CoreResult core_distance(GameState* g, const char* from_name, const char* to_name, int* out_hops) {
+    if (out_hops) *out_hops = 0;
+    if (!g || !from_name || !to_name) return CORE_ERR_INVALID_ARG;
+
+    ServerId from = server_find_by_name(&g->servers, from_name);
+    ServerId to = server_find_by_name(&g->servers, to_name);
+    if (from == SERVER_INVALID_ID || to == SERVER_INVALID_ID) return CORE_ERR_NOT_FOUND;
+
+    int hops = game_distance(g, from, to);
+    if (hops < 0) return CORE_ERR_NOT_LINKED;
+    if (out_hops) *out_hops = hops;
+    return CORE_OK;
+}
+
 /* --- Scan --- */
-ServerId* core_scan(GameState* g, int* out_count) {
-    static ServerId buf[16];  // max 16 connections
+const ServerId* core_scan(GameState* g, int* out_count) {
     if (!g || !out_count) return NULL;
 
-    int n = game_scan(g, buf, 16);
-    *out_count = n;
-    return buf;
+    game_expand(g, g->current_server);
+    return game_get_links(g, g->current_server, out_count);
 }
 
 /* --- Echo --- */
@@ -85,6 +123,30 @@ char* core_echo(int argc, char** argv) {
 /* --- Save --- */
 CoreResult core_save(GameState* g, const char* file) {
     if (!g || !file) return CORE_ERR_INVALID_ARG;
-    if (game_save(g, file)) return CORE_OK;
-    return CORE_ERR_FILE;
+    if (g->journal && strcmp(journal_filename(g->journal), file) == 0) {
+        return journal_sync(g->journal) ? CORE_OK : CORE_ERR_FILE;
+    }
+    /* a background save still writing the file would rename its older
+     * snapshot over this one */
+    game_wait_save(g, file);
+    if (!game_save(g, file)) return CORE_ERR_FILE;
+    /* the snapshot holds everything a leftover log would replay */
+    journal_discard(file);
+    return CORE_OK;
+}
+
+/* --- Journal --- */
+CoreResult core_journal(GameState* g, const char* file) {
+    return game_journal(g, file);
+}
+
+/* --- Background save --- */
+CoreResult core_save_background(GameState* g, const char* file, bool* out_started) {
+    if (!g || !file) return CORE_ERR_INVALID_ARG;
+    return game_save_background(g, file, out_started);
+}
+
+/* --- Autosave --- */
+CoreResult core_autosave(GameState* g, int ticks, const char* file) {
+    return game_set_autosave(g, ticks, file);
 }
@@ -0,0 +1,366 @@
+#include "distance.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* "unreachable" that still survives adding a few distances together */
+#define DIST_INF (INT32_MAX / 4)
+
+void distance_index_init(DistanceIndex* di) {
+    if (!di) return;
+    memset(di, 0, sizeof(*di));
+}
+
+void distance_index_free(DistanceIndex* di) {
+    if (!di) return;
+    free(di->depth);
+    free(di->comp);
+    free(di->pos);
+    free(di->order_depth);
+    free(di->prefix_min);
+    free(di->suffix_min);
+    free(di->sparse);
+    free(di->anchor);
+    free(di->anchor_node);
+    free(di->labels);
+    uint64_t failed = di->failed_generation;
+    distance_index_init(di);
+    di->failed_generation = failed;
+}
+
+int distance_index_is_current(const DistanceIndex* di, const LinkGraph* lg) {
+    return di && lg && di->generation != 0 && di->generation == lg->generation;
+}
+
+int distance_index_failed(const DistanceIndex* di, const LinkGraph* lg) {
+    return di && lg && di->failed_generation != 0 && di->failed_generation == lg->generation;
+}
+
+static inline int32_t min32(int32_t a, int32_t b) {
+    return a < b ? a : b;
+}
+
+/* Minimum of order_depth[l..r], l <= r. */
+static int32_t range_min(const DistanceIndex* di, int l, int r) {
+    int bl = l / DISTANCE_BLOCK;
+    int br = r / DISTANCE_BLOCK;
+    if (bl == br) {
+	int32_t m = di->order_depth[l];
+	for (int i = l + 1; i <= r; i++) m = min32(m, di->order_depth[i]);
+	return m;
+    }
+    int32_t m = min32(di->suffix_min[l], di->prefix_min[r]);
+    if (br - bl > 1) {
+	int a = bl + 1;
+	int b = br - 1;
+	int k = 31 - __builtin_clz((unsigned)(b - a + 1));
+	const int32_t* row = di->sparse + (size_t)k * di->blocks;
+	m = min32(m, min32(row[a], row[b - (1 << k) + 1]));
+    }
+    return m;
+}
+
+/* Distance along the spanning forest. */
+static int32_t tree_distance(const DistanceIndex* di, ServerId u, ServerId v) {
+    if (u == v) return 0;
+    if (di->comp[u] != di->comp[v]) return DIST_INF;
+    int l = di->pos[u];
+    int r = di->pos[v];
+    if (l > r) {
+	int t = l;
+	l = r;
+	r = t;
+    }
+    /* in preorder, the shallowest node after u up to v is a child of the LCA */
+    int32_t lca_depth = range_min(di, l + 1, r) - 1;
+    return di->depth[u] + di->depth[v] - 2 * lca_depth;
+}
+
+/* BFS spanning forest rooted at the lowest unvisited ID of each component.
+ * `queue` ends up holding every node in BFS order, parents first. */
+static void build_forest(DistanceIndex* di, const LinkGraph* lg, ServerId* parent, ServerId* queue) {
+    int n = lg->node_count;
+    for (int i = 0; i < n; i++) di->comp[i] = -1;
+    int head = 0, tail = 0;
+    for (int root = 0; root < n; root++) {
+	if (di->comp[root] >= 0) continue;
+	queue[tail++] = root;
+	di->comp[root] = root;
+	di->depth[root] = 0;
+	parent[root] = SERVER_INVALID_ID;
+	while (head < tail) {
+	    ServerId u = queue[head++];
+	    int deg = 0;
+	    const ServerId* nb = link_graph_neighbors(lg, u, &deg);
+	    for (int j = 0; j < deg; j++) {
+		ServerId v = nb[j];
+		if (di->comp[v] >= 0) continue;
+		di->comp[v] = root;
+		di->depth[v] = di->depth[u] + 1;
+		parent[v] = u;
+		queue[tail++] = v;
+	    }
+	}
+    }
+}
+
+/* Numbers the forest in DFS preorder; subtrees become contiguous ranges. */
+static int build_order(DistanceIndex* di, const ServerId* parent, int n) {
+    uint32_t* child_off = calloc((size_t)n + 1, sizeof(*child_off));
+    ServerId* children = malloc((size_t)(n ? n : 1) * sizeof(*children));
+    ServerId* stack = malloc((size_t)(n ? n : 1) * sizeof(*stack));
+    if (!child_off || !children || !stack) {
+	free(child_off);
+	free(children);
+	free(stack);
+	return -1;
+    }
+    for (int v = 0; v < n; v++) {
+	if (parent[v] >= 0) child_off[parent[v] + 1]++;
+    }
+    for (int v = 0; v < n; v++) child_off[v + 1] += child_off[v];
+    /* the stack doubles as the fill cursor for each child list */
+    for (int v = 0; v < n; v++) stack[v] = (ServerId)child_off[v];
+    for (int v = 0; v < n; v++) {
+	if (parent[v] >= 0) children[stack[parent[v]]++] = v;
+    }
+
+    int next = 0;
+    for (int root = 0; root < n; root++) {
+	if (parent[root] >= 0) continue;
+	int sp = 0;
+	stack[sp++] = root;
+	while (sp > 0) {
+	    ServerId u = stack[--sp];
+	    di->pos[u] = next;
+	    di->order_depth[next] = di->depth[u];
+	    next++;
+	    /* push in reverse so children are visited in link order */
+	    for (uint32_t k = child_off[u + 1]; k > child_off[u]; k--) stack[sp++] = children[k - 1];
+	}
+    }
+    free(child_off);
+    free(children);
+    free(stack);
+    return 0;
+}
+
+static int build_rmq(DistanceIndex* di, int n) {
+    di->blocks = (n + DISTANCE_BLOCK - 1) / DISTANCE_BLOCK;
+    di->levels = 1;
+    while ((1 << di->levels) <= di->blocks) di->levels++;
+    di->sparse = malloc((size_t)di->levels * (di->blocks ? di->blocks : 1) * sizeof(*di->sparse));
+    if (!di->sparse) return -1;
+
+    for (int b = 0; b < di->blocks; b++) {
+	int start = b * DISTANCE_BLOCK;
+	int end = min32(start + DISTANCE_BLOCK, n);
+	int32_t m = DIST_INF;
+	for (int i = start; i < end; i++) {
+	    m = min32(m, di->order_depth[i]);
+	    di->prefix_min[i] = m;
+	}
+	di->sparse[b] = m;
+	m = DIST_INF;
+	for (int i = end - 1; i >= start; i--) {
+	    m = min32(m, di->order_depth[i]);
+	    di->suffix_min[i] = m;
+	}
+    }
+    for (int k = 1; k < di->levels; k++) {
+	const int32_t* prev = di->sparse + (size_t)(k - 1) * di->blocks;
+	int32_t* row = di->sparse + (size_t)k * di->blocks;
+	for (int b = 0; b + (1 << k) <= di->blocks; b++) {
+	    row[b] = min32(prev[b], prev[b + (1 << (k - 1))]);
+	}
+    }
+    return 0;
+}
+
+static int is_tree_link(const ServerId* parent, ServerId u, ServerId v) {
+    return parent[v] == u || parent[u] == v;
+}
+
+/* Adds a link both ways to the anchor graph, or only counts it while
+ * `adj` is NULL. */
+static void anchor_link(uint32_t* cur, int32_t* adj, int32_t a, int32_t b) {
+    if (adj) {
+	adj[cur[a]++] = b;
+	adj[cur[b]++] = a;
+    } else {
+	cur[a + 1]++;
+	cur[b + 1]++;
+    }
+}
+
+/*
+ * Labels the anchors: every node on a tree path from a root down to an
+ * endpoint of a non-tree link. Any path that leaves the tree enters and
+ * leaves the anchors through tree links only, so distances between
+ * anchors over tree links among anchors plus the non-tree links are the
+ * true ones. One BFS of that small graph per endpoint fills a column of
+ * the label matrix.
+ */
+static int build_overlay(DistanceIndex* di, const LinkGraph* lg, const ServerId* parent, const ServerId* bfs_order) {
+    int n = lg->node_count;
+    int32_t* anchor = di->anchor;
+    for (int i = 0; i < n; i++) anchor[i] = -1;
+
+    /* endpoints first, so anchor index x < k is endpoint x */
+    int k = 0;
+    ServerId* nodes = malloc(((size_t)n + 1) * sizeof(*nodes));
+    if (!nodes) return -1;
+    for (ServerId u = 0; u < n; u++) {
+	int deg = 0;
+	const ServerId* nb = link_graph_neighbors(lg, u, &deg);
+	for (int j = 0; j < deg; j++) {
+	    ServerId ends[2] = { u, nb[j] };
+	    if (is_tree_link(parent, u, nb[j])) continue;
+	    for (int e = 0; e < 2; e++) {
+		if (anchor[ends[e]] >= 0) continue;
+		if (k == DISTANCE_OVERLAY_MAX) goto fail;
+		anchor[ends[e]] = k;
+		nodes[k++] = ends[e];
+	    }
+	}
+    }
+    di->endpoint_count = k;
+    if (k == 0) {
+	free(nodes);
+	return 0;
+    }
+    int m = k;
+    for (int x = 0; x < k; x++) {
+	for (ServerId v = parent[nodes[x]]; v >= 0 && anchor[v] < 0; v = parent[v]) {
+	    anchor[v] = m;
+	    nodes[m++] = v;
+	}
+    }
+    if ((size_t)m * k > DISTANCE_LABEL_MAX) goto fail;
+    di->anchor_count = m;
+
+    /* anchor graph in CSR form: tree links between anchors both ways,
+     * non-tree links both ways */
+    uint32_t* off = calloc((size_t)m + 1, sizeof(*off));
+    int32_t* adj = NULL;
+    int32_t* queue = malloc((size_t)m * sizeof(*queue));
+    int32_t* dist = malloc((size_t)m * sizeof(*dist));
+    di->anchor_node = malloc((size_t)m * sizeof(*di->anchor_node));
+    di->labels = malloc((size_t)m * k * sizeof(*di->labels));
+    int ok = off && queue && dist && di->anchor_node && di->labels;
+    for (int pass = 0; pass < 2 && ok; pass++) {
+	/* pass 0 counts degrees, pass 1 fills; dist doubles as the fill cursor */
+	uint32_t* cur = pass ? (uint32_t*)dist : off;
+	if (pass) {
+	    for (int i = 0; i < m; i++) off[i + 1] += off[i];
+	    adj = malloc((size_t)(off[m] ? off[m] : 1) * sizeof(*adj));
+	    if (!adj) {
+		ok = 0;
+		break;
+	    }
+	    for (int i = 0; i < m; i++) cur[i] = off[i];
+	}
+	for (int i = 0; i < m; i++) {
+	    if (parent[nodes[i]] >= 0) anchor_link(cur, adj, i, anchor[parent[nodes[i]]]);
+	}
+	for (int x = 0; x < k; x++) {
+	    int deg = 0;
+	    const ServerId* nb = link_graph_neighbors(lg, nodes[x], &deg);
+	    for (int j = 0; j < deg; j++) {
+		if (!is_tree_link(parent, nodes[x], nb[j])) anchor_link(cur, adj, x, anchor[nb[j]]);
+	    }
+	}
+    }
+
+    for (int x = 0; x < k && ok; x++) {
+	for (int i = 0; i < m; i++) dist[i] = DIST_INF;
+	int head = 0, tail = 0;
+	queue[tail++] = x;
+	dist[x] = 0;
+	while (head < tail) {
+	    int32_t u = queue[head++];
+	    for (uint32_t e = off[u]; e < off[u + 1]; e++) {
+		if (dist[adj[e]] != DIST_INF) continue;
+		dist[adj[e]] = dist[u] + 1;
+		queue[tail++] = adj[e];
+	    }
+	}
+	for (int i = 0; i < m; i++) di->labels[(size_t)i * k + x] = dist[i];
+    }
+    if (ok) memcpy(di->anchor_node, nodes, (size_t)m * sizeof(*nodes));
+    free(off);
+    free(adj);
+    free(queue);
+    free(dist);
+    free(nodes);
+    if (!ok) return -1;
+
+    /* every other node borrows the nearest anchor above it */
+    for (int i = 0; i < n; i++) {
+	ServerId u = bfs_order[i];
+	if (anchor[u] < 0 && parent[u] >= 0) anchor[u] = anchor[parent[u]];
+    }
+    return 0;
+
+fail:
+    free(nodes);
+    return -1;
+}
+
+CoreResult distance_index_build(DistanceIndex* di, const LinkGraph* lg) {
+    if (!di || !lg) return CORE_ERR_INVALID_ARG;
+    distance_index_free(di);
+
+    int n = lg->node_count;
+    size_t cells = (size_t)(n ? n : 1);
+    di->depth = malloc(cells * sizeof(*di->depth));
+    di->comp = malloc(cells * sizeof(*di->comp));
+    di->pos = malloc(cells * sizeof(*di->pos));
+    di->anchor = malloc(cells * sizeof(*di->anchor));
+    di->order_depth = malloc(cells * sizeof(*di->order_depth));
+    di->prefix_min = malloc(cells * sizeof(*di->prefix_min));
+    di->suffix_min = malloc(cells * sizeof(*di->suffix_min));
+    ServerId* parent = malloc(cells * sizeof(*parent));
+    ServerId* bfs_order = malloc(cells * sizeof(*bfs_order));
+    int ok = di->depth && di->comp && di->pos && di->anchor && di->order_depth && di->prefix_min &&
+             di->suffix_min && parent && bfs_order;
+
+    if (ok) {
+	build_forest(di, lg, parent, bfs_order);
+	di->node_count = n;
+	ok = build_order(di, parent, n) == 0 && build_rmq(di, n) == 0 &&
+	     build_overlay(di, lg, parent, bfs_order) == 0;
+    }
+    free(parent);
+    free(bfs_order);
+    if (!ok) {
+	/* remembered, so queries don't rebuild until the links change */
+	distance_index_free(di);
+	di->failed_generation = lg->generation;
+	return CORE_ERR_UNKNOWN;
+    }
+    di->generation = lg->generation;
+    di->failed_generation = 0;
+    return CORE_OK;
+}
+
+int distance_index_query(const DistanceIndex* di, ServerId a, ServerId b) {
+    if (!di || a < 0 || b < 0 || a >= di->node_count || b >= di->node_count) return -1;
+    if (di->comp[a] != di->comp[b]) return -1;
+    int32_t best = tree_distance(di, a, b);
+
+    int k = di->endpoint_count;
+    if (k == 0 || best <= 1) return best;
+
+    /* a path that leaves the tree climbs to the nearest anchors above a
+     * and b, then meets at some endpoint */
+    int32_t pa = di->anchor[a], pb = di->anchor[b];
+    if (pa < 0 || pb < 0) return best;
+    int32_t climb = di->depth[a] - di->depth[di->anchor_node[pa]] + di->depth[b] - di->depth[di->anchor_node[pb]];
+    if (climb >= best) return best;
+    const int32_t* la = di->labels + (size_t)pa * k;
+    const int32_t* lb = di->labels + (size_t)pb * k;
+    int32_t via = DIST_INF;
+    for (int x = 0; x < k; x++) via = min32(via, la[x] + lb[x]);
+    return min32(best, climb + via);
+}
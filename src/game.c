@@ -1,32 +1,60 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <unistd.h>
 
 #include "game.h"
 #include "server.h"
 #include "core_result.h"
-#include "cJSON.h"
 #include "generator.h"
+#include "world_file.h"
+#include "save_json.h"
+#include "journal.h"
+#include "bgsave.h"
+
+/* Set and not "0" */
+static int env_flag(const char* name) {
+    const char* v = getenv(name);
+    return v && *v && strcmp(v, "0") != 0;
+}
+
+static void game_finish_save(GameState* g, bool block);
 
 void game_generate_network(GameState* g) {
-    /* Preserve behavior: use HACKTERM_SEED if set, else 0 to use global RNG */
+    /* use HACKTERM_SEED if set, else 0 for the generator's default seed */
     const char* seed_env = getenv("HACKTERM_SEED");
     unsigned int seed = 0;
     if (seed_env) seed = (unsigned int)atoi(seed_env);
-    generator_generate_city(g, seed);
+
+    GeneratorParams params;
+    generator_city_params(&params);
+    /* HACKTERM_COMPACT_NAMES: keep generated names as coordinates */
+    params.compact_names = env_flag("HACKTERM_COMPACT_NAMES");
+
+    /* HACKTERM_LAZY: fill in neighbourhoods only as they are explored */
+    if (env_flag("HACKTERM_LAZY")) {
+	g->lazy = generator_generate_lazy(g, &params, seed);
+	if (g->lazy) return;
+    }
+    generator_generate_with_params(g, &params, seed);
 }
 
 void game_init(GameState* g) {
     if (!g) return;
 
-    g->server_count = 0;
+    journal_close(g->journal);
+    g->journal = NULL;
+    server_store_free(&g->servers);
+    link_graph_free(&g->links);
+    generator_lazy_free(g->lazy);
+    g->lazy = NULL;
 
     /* create home server */
-    server_init(&g->servers[0], 0, "home");
-    g->server_count = 1;
-    g->home_server = 0;
-    g->current_server = 0;
+    g->home_server = server_store_add(&g->servers, "home");
+    g->current_server = g->home_server;
     g->tick = 0;
+    scheduler_free(&g->sched);
+    scheduler_init(&g->sched, 0);
 
     // generate demo network
     game_generate_network(g);
@@ -34,38 +62,81 @@ void game_init(GameState* g) {
 
 /* Sends the shutdown signal */
 void game_shutdown(GameState* g) {
-    (void)g;
-    /* nothing yet */
+    if (!g) return;
+    server_store_free(&g->servers);
+    link_graph_free(&g->links);
+    scheduler_free(&g->sched);
+    route_free(&g->route);
+    distance_index_free(&g->dist);
+    generator_lazy_free(g->lazy);
+    g->lazy = NULL;
+    journal_close(g->journal);
+    g->journal = NULL;
+    /* a save in flight is finished, not abandoned */
+    game_finish_save(g, true);
+    g->autosave_ticks = 0;
 }
 
 /* helper functions*/
 
-/* Returns a pointer to the server with ServerId */
-Server* game_get_server(GameState* g, ServerId id) {
-    if (!g) return NULL;
-    if (id < 0 || id >= g->server_count) return NULL;
-    return &g->servers[id];
+/* Returns the name of a server, or NULL for an unknown id */
+const char* game_server_name(const GameState* g, ServerId id) {
+    if (!g || !server_valid(&g->servers, id)) return NULL;
+    return server_name(&g->servers, id);
+}
+
+int game_server_count(const GameState* g) {
+    return g ? g->servers.count : 0;
+}
+
+const ServerId* game_get_links(const GameState* g, ServerId id, int* out_count) {
+    if (!g) {
+	if (out_count) *out_count = 0;
+	return NULL;
+    }
+    return link_graph_neighbors(&g->links, id, out_count);
+}
+
+/* Logs the servers from `first` on, then every link touching them */
+static void journal_new_servers(GameState* g, ServerId first) {
+    for (ServerId a = first; a < g->servers.count; a++) {
+	journal_record_server(g->journal, &g->servers, a);
+    }
+    for (ServerId a = first; a < g->servers.count; a++) {
+	int n = 0;
+	const ServerId* nb = game_get_links(g, a, &n);
+	for (int i = 0; i < n; i++) {
+	    journal_record_link(g->journal, a, nb[i]);
+	    if (nb[i] < first && link_graph_has_link(&g->links, nb[i], a)) {
+		journal_record_link(g->journal, nb[i], a);
+	    }
+	}
+    }
 }
 
-/* Returns a pointer to the server the player is connected to */
-Server* game_get_current_server(GameState* g) {
-    return game_get_server(g, g->current_server);
+int game_expand(GameState* g, ServerId id) {
+    if (!g || !g->lazy) return 0;
+    ServerId first = g->servers.count;
+    int added = generator_lazy_expand(g->lazy, g, id);
+    if (added > 0 && g->journal) {
+	journal_record_expand(g->journal, id);
+	journal_new_servers(g, first);
+    }
+    return added;
 }
 
 /* game commands */
 
 /* Returns an array of linked servers*/
-int game_scan(const GameState* g, ServerId* out, int max) {
+int game_scan(GameState* g, ServerId* out, int max) {
     if (!g || !out) return 0;
+    game_expand(g, g->current_server);
 
-    const Server* curr = &g->servers[g->current_server];
-    int count = curr->link_count;
+    int count = 0;
+    const ServerId* links = game_get_links(g, g->current_server, &count);
 
     if (count > max) count = max;
-
-    for (int i = 0; i < count; i++) {
-	out[i] = curr->links[i].to;  // just indices
-    }
+    if (count > 0) memcpy(out, links, (size_t)count * sizeof(*out));
 
     return count;
 }
@@ -73,216 +144,271 @@ int game_scan(const GameState* g, ServerId* out, int max) {
 CoreResult game_connect(GameState* g, ServerId to) {
     if (!g) return CORE_ERR_INVALID_ARG;
 
-    Server* curr = &g->servers[g->current_server];
-    for (int i = 0; i < curr->link_count; i++) {
-	if (curr->links[i].to == to) {
-	    g->current_server = to;
-	    return CORE_OK;
-	}
+    if (link_graph_has_link(&g->links, g->current_server, to)) {
+	g->current_server = to;
+	journal_record_current(g->journal, to);
+	return CORE_OK;
     }
     return CORE_ERR_NOT_LINKED;
 }
 
+const ServerId* game_route(GameState* g, ServerId from, ServerId to, int* out_len) {
+    if (!g) {
+	if (out_len) *out_len = 0;
+	return NULL;
+    }
+    return route_find(&g->route, &g->links, from, to, out_len);
+}
+
+CoreResult game_connect_route(GameState* g, ServerId to, int* out_hops) {
+    if (out_hops) *out_hops = 0;
+    if (!g || !server_valid(&g->servers, to)) return CORE_ERR_INVALID_ARG;
+
+    int len = 0;
+    const ServerId* path = game_route(g, g->current_server, to, &len);
+    if (!path) return CORE_ERR_NOT_LINKED;
+    for (int i = 1; i < len; i++) {
+	if (game_connect(g, path[i]) != CORE_OK) return CORE_ERR_NOT_LINKED;
+	if (out_hops) (*out_hops)++;
+    }
+    return CORE_OK;
+}
+
+int game_distance(GameState* g, ServerId a, ServerId b) {
+    if (!g || !server_valid(&g->servers, a) || !server_valid(&g->servers, b)) return -1;
+    if (!distance_index_is_current(&g->dist, &g->links) &&
+        (distance_index_failed(&g->dist, &g->links) ||
+         distance_index_build(&g->dist, &g->links) != CORE_OK)) {
+	/* too many mesh links for the index: search instead */
+	int len = 0;
+	return game_route(g, a, b, &len) ? len - 1 : -1;
+    }
+    return distance_index_query(&g->dist, a, b);
+}
+
+/* True if `filename` ends in `ext` */
+static int has_extension(const char* filename, const char* ext) {
+    size_t n = strlen(filename), e = strlen(ext);
+    return n > e && strcmp(filename + n - e, ext) == 0;
+}
+
+/* Servers written between progress reports */
+#define SAVE_PROGRESS_STEP 4096
+
 bool game_save(const GameState* g, const char* filename) {
-    if (!g || !filename) return false;
+    return game_save_progress(g, filename, NULL, NULL);
+}
 
-    char tmpfile[512];
-    snprintf(tmpfile, sizeof(tmpfile), "%s.tmp", filename);
-
-    cJSON* root = cJSON_CreateObject();
-    if (!root) return false;
-    cJSON_AddNumberToObject(root, "version", 1);
-
-    cJSON* game = cJSON_CreateObject();
-    cJSON_AddItemToObject(root, "game", game);
-    cJSON_AddNumberToObject(game, "server_count", g->server_count);
-    cJSON_AddNumberToObject(game, "home_server", g->home_server);
-    cJSON_AddNumberToObject(game, "current_server", g->current_server);
-
-    cJSON* servers = cJSON_CreateArray();
-    cJSON_AddItemToObject(game, "servers", servers);
-
-    for (int i = 0; i < g->server_count; i++) {
-        const Server* s = &g->servers[i];
-        cJSON* sObj = cJSON_CreateObject();
-        cJSON_AddNumberToObject(sObj, "id", s->id);
-        cJSON_AddStringToObject(sObj, "name", s->name);
-        cJSON_AddNumberToObject(sObj, "security", s->security);
-        cJSON_AddNumberToObject(sObj, "money", s->money);
-        /* store string type name under the stable "type" key */
-        cJSON_AddStringToObject(sObj, "type", server_type_to_string(s->type));
-        cJSON_AddNumberToObject(sObj, "subnet", s->subnet_id);
-
-        cJSON* links = cJSON_CreateArray();
-        for (int j = 0; j < s->link_count; j++) {
-            cJSON_AddItemToArray(links, cJSON_CreateNumber(s->links[j].to));
-        }
-        cJSON_AddItemToObject(sObj, "links", links);
-
-        cJSON* sArr = cJSON_CreateArray();
-        for (int j = 0; j < s->service_count; j++) {
-            cJSON* svc = cJSON_CreateObject();
-            cJSON_AddStringToObject(svc, "name", s->services[j].name);
-            cJSON_AddNumberToObject(svc, "port", s->services[j].port);
-            cJSON_AddNumberToObject(svc, "vuln", s->services[j].vuln_level);
-            cJSON_AddItemToArray(sArr, svc);
-        }
-        cJSON_AddItemToObject(sObj, "services", sArr);
-
-        cJSON_AddItemToArray(servers, sObj);
+bool game_save_progress(const GameState* g, const char* filename, GameSaveProgressFn progress, void* ctx) {
+    if (!g || !filename) return false;
+    if (has_extension(filename, WORLD_FILE_EXT)) {
+        bool ok = world_file_save(g, filename);
+        if (ok && progress) progress(ctx, g->servers.count, g->servers.count);
+        return ok;
     }
 
-    char* out = cJSON_PrintUnformatted(root);
-    if (!out) { cJSON_Delete(root); return false; }
+    /* what a lazy world still has to generate travels with it */
+    GenLazyState lazy;
+    if (!generator_lazy_save_state(g->lazy, &lazy)) return false;
+
+    /* per-process name: a background save child may be writing this file too */
+    char tmpfile[512];
+    snprintf(tmpfile, sizeof(tmpfile), "%s.tmp.%ld", filename, (long)getpid());
 
     FILE* f = fopen(tmpfile, "w");
-    if (!f) { free(out); cJSON_Delete(root); return false; }
-    fwrite(out, 1, strlen(out), f);
-    fwrite("\n", 1, 1, f);
-    fclose(f);
-    free(out);
-    cJSON_Delete(root);
+    if (!f) {
+        generator_lazy_state_free(&lazy);
+        return false;
+    }
+    setvbuf(f, NULL, _IOFBF, 1 << 20);
+
+    /* servers go straight to the file; nothing is built in memory */
+    JsonWriter w;
+    json_writer_init(&w, f);
+    save_json_begin(&w, g->servers.count, g->home_server, g->current_server);
+    for (int i = 0; i < g->servers.count && !w.failed; i++) {
+        int link_count = 0;
+        const ServerId* nb = game_get_links(g, i, &link_count);
+        save_json_server(&w, i, &g->servers, i, nb, link_count);
+        if (progress && (i + 1) % SAVE_PROGRESS_STEP == 0) progress(ctx, i + 1, g->servers.count);
+    }
+    bool ok = save_json_end(&w, &lazy);
+    generator_lazy_state_free(&lazy);
+    if (fclose(f) != 0) ok = false;
+    if (ok && progress) progress(ctx, g->servers.count, g->servers.count);
 
-    if (rename(tmpfile, filename) != 0) {
+    if (!ok || rename(tmpfile, filename) != 0) {
         remove(tmpfile);
         return false;
     }
     return true;
 }
 
-/* Load using cJSON for robustness */
-bool game_load(GameState* g, const char* filename) {
-    if (!g || !filename) return false;
-    FILE* f = fopen(filename, "r");
-    if (!f) return false;
-    fseek(f, 0, SEEK_END);
-    long sz = ftell(f);
-    fseek(f, 0, SEEK_SET);
-    if (sz <= 0) { fclose(f); return false; }
-    char* buf = malloc(sz + 1);
-    if (!buf) { fclose(f); return false; }
-    if (fread(buf, 1, sz, f) != (size_t)sz) { free(buf); fclose(f); return false; }
-    buf[sz] = '\0';
-    fclose(f);
+CoreResult game_save_background(GameState* g, const char* filename, bool* out_started) {
+    if (out_started) *out_started = false;
+    if (!g || !filename) return CORE_ERR_INVALID_ARG;
+    if (g->journal && strcmp(journal_filename(g->journal), filename) == 0) {
+        return journal_sync(g->journal) ? CORE_OK : CORE_ERR_FILE;
+    }
+    if (g->bgsave) return CORE_ERR_BUSY;
+    g->bgsave = bgsave_start(g, filename);
+    if (!g->bgsave) return CORE_ERR_FILE;
+    if (out_started) *out_started = true;
+    return CORE_OK;
+}
 
-    cJSON* root = cJSON_Parse(buf);
-    free(buf);
-    if (!root) return false;
+int game_save_percent(const GameState* g) {
+    return g && g->bgsave ? bgsave_percent(g->bgsave) : -1;
+}
 
-    cJSON* game = cJSON_GetObjectItem(root, "game");
-    if (!game) { cJSON_Delete(root); return false; }
+CoreResult game_set_autosave(GameState* g, int ticks, const char* filename) {
+    if (!g || ticks < 0) return CORE_ERR_INVALID_ARG;
+    if (ticks > 0 && (!filename || !*filename || strlen(filename) >= sizeof(g->autosave_file))) {
+        return CORE_ERR_INVALID_ARG;
+    }
+    g->autosave_ticks = ticks;
+    if (ticks == 0) return CORE_OK;
+    strcpy(g->autosave_file, filename);
+    g->autosave_next = g->tick + ticks;
+    return CORE_OK;
+}
 
-    cJSON* sc = cJSON_GetObjectItem(game, "server_count");
-    cJSON* hs = cJSON_GetObjectItem(game, "home_server");
-    cJSON* cs = cJSON_GetObjectItem(game, "current_server");
-    cJSON* servers = cJSON_GetObjectItem(game, "servers");
-    if (!sc || !servers) { cJSON_Delete(root); return false; }
+/* Reports a background save that has ended; `block` waits for it */
+static void game_finish_save(GameState* g, bool block) {
+    if (!g->bgsave) return;
+    BgSaveStatus st = block ? bgsave_wait(g->bgsave) : bgsave_poll(g->bgsave);
+    if (st == BGSAVE_RUNNING) return;
+    const char* file = bgsave_filename(g->bgsave);
+    /* the snapshot holds everything a leftover log would replay */
+    bool journaled = g->journal && strcmp(journal_filename(g->journal), file) == 0;
+    if (st == BGSAVE_DONE && !journaled) journal_discard(file);
+    if (g->on_save) g->on_save(g->on_save_ctx, file, st == BGSAVE_DONE);
+    bgsave_free(g->bgsave);
+    g->bgsave = NULL;
+}
 
-    int server_count = (int)sc->valuedouble;
-    int home_server = hs ? (int)hs->valuedouble : 0;
-    int current_server = cs ? (int)cs->valuedouble : 0;
+void game_wait_save(GameState* g, const char* filename) {
+    if (!g || !g->bgsave) return;
+    if (!filename || strcmp(bgsave_filename(g->bgsave), filename) == 0) game_finish_save(g, true);
+}
 
-    if (server_count <= 0 || server_count > MAX_SERVERS) { cJSON_Delete(root); return false; }
+CoreResult game_journal(GameState* g, const char* filename) {
+    if (!g) return CORE_ERR_INVALID_ARG;
+    journal_close(g->journal);
+    g->journal = NULL;
+    if (!filename) return CORE_OK;
+    /* the journal's first snapshot must not race a save to the same file */
+    game_wait_save(g, filename);
+    g->journal = journal_open(g, filename, 0);
+    return g->journal ? CORE_OK : CORE_ERR_FILE;
+}
 
-    g->server_count = 0;
-    g->home_server = home_server;
-    g->current_server = current_server;
-    g->tick = 0;
+/* Streams the save into a fresh world and swaps it in only once it has
+ * loaded completely */
+static bool load_json(GameState* g, const char* filename) {
+    FILE* f = fopen(filename, "r");
+    if (!f) return false;
 
-    int arr_len = cJSON_GetArraySize(servers);
-    for (int i = 0; i < arr_len; i++) {
-        cJSON* sObj = cJSON_GetArrayItem(servers, i);
-        if (!sObj) continue;
-        cJSON* jid = cJSON_GetObjectItem(sObj, "id");
-        cJSON* jname = cJSON_GetObjectItem(sObj, "name");
-        cJSON* jsec = cJSON_GetObjectItem(sObj, "security");
-        cJSON* jmoney = cJSON_GetObjectItem(sObj, "money");
-        cJSON* jtype = cJSON_GetObjectItem(sObj, "type");
-        cJSON* jsub = cJSON_GetObjectItem(sObj, "subnet");
-
-        int id = jid ? (int)jid->valuedouble : -1;
-        const char* name = jname && jname->valuestring ? jname->valuestring : NULL;
-        int security = jsec ? (int)jsec->valuedouble : 1;
-        int money = jmoney ? (int)jmoney->valuedouble : 0;
-        ServerType role_val = SERVER_TYPE_UNKNOWN;
-        if (jtype && cJSON_IsString(jtype) && jtype->valuestring) {
-            role_val = server_type_from_string(jtype->valuestring);
-        }
-        int subnet = jsub ? (int)jsub->valuedouble : -1;
-
-        if (id < 0 || id >= MAX_SERVERS) continue;
-
-        server_init(&g->servers[id], id, name);
-        g->servers[id].security = security;
-        g->servers[id].money = money;
-        g->servers[id].type = role_val;
-        g->servers[id].subnet_id = subnet;
-
-        /* links */
-        cJSON* jlinks = cJSON_GetObjectItem(sObj, "links");
-        if (jlinks && cJSON_IsArray(jlinks)) {
-            int ln = cJSON_GetArraySize(jlinks);
-            for (int li = 0; li < ln; li++) {
-                cJSON* item = cJSON_GetArrayItem(jlinks, li);
-                if (item && cJSON_IsNumber(item)) {
-                    server_add_link(&g->servers[id], (int)item->valuedouble);
-                }
-            }
-        }
-
-        /* services */
-        cJSON* jsvcs = cJSON_GetObjectItem(sObj, "services");
-        if (jsvcs && cJSON_IsArray(jsvcs)) {
-            int sn = cJSON_GetArraySize(jsvcs);
-            for (int si = 0; si < sn && si < MAX_SERVICES_PER_SERVER; si++) {
-                cJSON* svc = cJSON_GetArrayItem(jsvcs, si);
-                if (!svc) continue;
-                cJSON* sname = cJSON_GetObjectItem(svc, "name");
-                cJSON* sport = cJSON_GetObjectItem(svc, "port");
-                cJSON* svuln = cJSON_GetObjectItem(svc, "vuln");
-                const char* sname_s = sname && sname->valuestring ? sname->valuestring : "";
-                int port = sport ? (int)sport->valuedouble : 0;
-                int vuln = svuln ? (int)svuln->valuedouble : 0;
-                g->servers[id].services[g->servers[id].service_count].port = port;
-                g->servers[id].services[g->servers[id].service_count].vuln_level = vuln;
-                strncpy(g->servers[id].services[g->servers[id].service_count].name, sname_s, SERVICE_NAME_LEN - 1);
-                g->servers[id].services[g->servers[id].service_count].name[SERVICE_NAME_LEN - 1] = '\0';
-                g->servers[id].service_count++;
-            }
-        }
-
-        if (id >= 0) {
-            if (id >= g->server_count) g->server_count = id + 1;
-        }
+    JsonReader* r = malloc(sizeof(*r));
+    if (!r) { fclose(f); return false; }
+    json_reader_init(r, f);
+    ServerStore servers;
+    LinkGraph links;
+    server_store_init(&servers);
+    link_graph_init(&links);
+    ServerId home_server = 0, current_server = 0;
+    GenLazyState state;
+    bool ok = save_json_read(r, &servers, &links, &home_server, &current_server, &state);
+    free(r);
+    fclose(f);
+    /* a lazy world picks up its plan again; one that doesn't fit it is damaged */
+    GenLazy* lazy = NULL;
+    if (ok && state.expanded_count >= 0) {
+        lazy = generator_lazy_resume(&state, &servers);
+        ok = lazy != NULL;
+    }
+    generator_lazy_state_free(&state);
+    if (!ok) {
+        server_store_free(&servers);
+        link_graph_free(&links);
+        return false;
     }
 
-    cJSON_Delete(root);
+    server_store_free(&g->servers);
+    link_graph_free(&g->links);
+    g->servers = servers;
+    g->links = links;
+    generator_lazy_free(g->lazy);
+    g->lazy = lazy;
+    g->home_server = home_server;
+    g->current_server = current_server;
+    g->tick = 0;
+    scheduler_free(&g->sched);
+    scheduler_init(&g->sched, 0);
     return true;
 }
 
-void game_tick(GameState* g) {
-    /* Placeholder*/
-    g->tick++;
+bool game_load(GameState* g, const char* filename) {
+    if (!g || !filename) return false;
+    journal_close(g->journal);
+    g->journal = NULL;
+    bool ok = world_file_detect(filename) ? world_file_load(g, filename) : load_json(g, filename);
+    /* a damaged log still leaves the records before the damage applied */
+    if (ok) journal_replay(g, filename);
+    return ok;
 }
 
-void action_queue_push(GameState* g, Action a) {
-    if (g->queue.count < MAX_ACTIONS) {
-	g->queue.actions[g->queue.count++] = a;
-    } else {
-	// Error, reached max actions
-	printf("[debug] action queue full, action dropped!");
+/* Applies an action that has become due and reports the outcome */
+static void game_fire_action(void* ctx, const Action* action) {
+    GameState* g = ctx;
+    Action a = *action;
+    ServerStore* st = &g->servers;
+    CoreResult r = CORE_OK;
+
+    switch (a.type) {
+	case ACTION_CONNECT:
+	    r = server_valid(st, a.target_server) ? game_connect(g, a.target_server)
+	                                          : CORE_ERR_NOT_FOUND;
+	    break;
+	case ACTION_SCAN:
+	    r = server_valid(st, a.target_server) ? CORE_OK : CORE_ERR_NOT_FOUND;
+	    break;
+	case ACTION_DOWNLOAD: {
+	    if (!server_valid(st, a.target_server) || !server_valid(st, g->home_server)) {
+		r = CORE_ERR_NOT_FOUND;
+		break;
+	    }
+	    int available = server_money(st, a.target_server);
+	    int amount = a.value < available ? a.value : available;
+	    if (amount < 0) amount = 0;
+	    server_set_money(st, a.target_server, available - amount);
+	    server_set_money(st, g->home_server, server_money(st, g->home_server) + amount);
+	    journal_record_money(g->journal, a.target_server, available - amount);
+	    journal_record_money(g->journal, g->home_server, server_money(st, g->home_server));
+	    a.value = amount;
+	    break;
+	}
+	default:
+	    return;
     }
+
+    if (g->on_action) g->on_action(g->on_action_ctx, &a, r);
 }
 
-Action action_queue_pop(GameState* g) {
-    Action a = {.type = ACTION_NOP};
-    if (g->queue.count == 0) return a;
+CoreResult game_schedule(GameState* g, Action a, int delay) {
+    if (!g || delay < 0) return CORE_ERR_INVALID_ARG;
+    return scheduler_schedule(&g->sched, a, (uint32_t)delay);
+}
 
-    a = g->queue.actions[0];
-    // shift remaining actoins
-    for (int i = 1; i < g->queue.count; i++) {
-	g->queue.actions[i - 1] = g->queue.actions[i];
+void game_tick(GameState* g) {
+    g->tick++;
+    scheduler_advance(&g->sched, game_fire_action, g);
+    journal_poll(g->journal, g);
+    game_finish_save(g, false);
+    if (g->autosave_ticks > 0 && g->tick >= g->autosave_next) {
+	/* a save still running from last time pushes this one back a tick */
+	if (game_save_background(g, g->autosave_file, NULL) != CORE_ERR_BUSY) {
+	    g->autosave_next = g->tick + g->autosave_ticks;
+	}
     }
-    g->queue.count--;
-    return a;
 }
@@ -1,15 +1,21 @@
 /* generator.c - procedural network generation implementation */
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "generator.h"
+#include "generator_internal.h"
+#include "rng.h"
 #include "server.h"
 
-/* Helper to choose an int in [min..max] (handles min==max) */
-static int rand_range(int min, int max) {
-    if (max <= min) return min;
-    return min + (rand() % (max - min + 1));
+static uint64_t child_key(uint64_t key, int index) {
+    return rng_key(key, STREAM_CHILD + (uint64_t)index);
 }
 
 /* Helper: identify router-like devices at file scope */
@@ -17,189 +23,582 @@ static int is_router_like(ServerType t) {
     return (t == SERVER_TYPE_ROUTER || t == SERVER_TYPE_RACK);
 }
 
-void generator_generate_with_params(GameState* g, const GeneratorParams* p, unsigned int seed) {
-    if (!g) return;
-
-    GeneratorParams params;
-    if (p) params = *p; else {
-        /* defaults */
-        params.isp_count = 1;
-        params.areas_min = 1;
-        params.areas_max = 2;
-        params.neigh_min = 3;
-        params.neigh_max = 6;
-        params.buildings_min = 4;
-        params.buildings_max = 10;
-        params.floors_per_building_min = 1;
-        params.floors_per_building_max = 3;
-        params.routers_per_building_min = 1;
-        params.routers_per_building_max = 4;
-        params.users_per_router_min = 8;
-        params.users_per_router_max = 32;
-        params.inter_router_link_density = 0.00;
-        params.public_dmz_fraction = 0.02;
-    }
-
-    /* apply seed locally if set (0 means don't reseed) */
-    unsigned int used_seed = seed;
-    if (used_seed != 0) srand(used_seed);
+typedef struct {
+    const GeneratorParams* params;
+    NeighJob* jobs;
+    int count;
+    atomic_int next;
+} JobQueue;
 
+/* Names a generated server: as coordinates, or formatted into a stored
+ * string when compact names are off. */
+static ServerId add_named(ServerStore* st, const ServerCoord* c, Rng* stats, int compact) {
+    if (compact) return server_generate_random_coord(st, c, stats);
     char name_buf[128];
+    server_coord_format(c, name_buf, sizeof(name_buf));
+    return server_generate_random(st, name_buf, stats);
+}
 
-    /* Create ISP nodes */
-    int isp_count = params.isp_count > 0 ? params.isp_count : 1;
-    int isp_ids[isp_count];
-    for (int i = 0; i < isp_count; i++) {
-        snprintf(name_buf, sizeof(name_buf), "isp%d", i + 1);
-        int id = server_generate_random(g->servers, &g->server_count, name_buf);
-        if (id == SERVER_INVALID_ID) break;
-        g->servers[id].type = SERVER_TYPE_ISP;
-        isp_ids[i] = id;
-    }
-
-    /* For each ISP, create areas -> neighborhoods -> buildings -> floors/routers -> users */
-    for (int pidx = 0; pidx < isp_count; pidx++) {
-        int areas = rand_range(params.areas_min, params.areas_max);
-        for (int a = 0; a < areas; a++) {
-            snprintf(name_buf, sizeof(name_buf), "area%d_i%d", a + 1, pidx + 1);
-            int aid = server_generate_random(g->servers, &g->server_count, name_buf);
-            if (aid == SERVER_INVALID_ID) break;
-            g->servers[aid].type = SERVER_TYPE_AREA;
-            /* link area to ISP (no PoP layer) */
-            server_link_bidirectional(&g->servers[aid], &g->servers[isp_ids[pidx]]);
-
-                int neigh = rand_range(params.neigh_min, params.neigh_max);
-            for (int n = 0; n < neigh; n++) {
-                snprintf(name_buf, sizeof(name_buf), "neigh%d_a%d_p%d", n + 1, a + 1, pidx + 1);
-                int nid = server_generate_random(g->servers, &g->server_count, name_buf);
-                if (nid == SERVER_INVALID_ID) break;
-                g->servers[nid].type = SERVER_TYPE_NEIGHBORHOOD;
-                /* link neighborhood to area */
-                server_link_bidirectional(&g->servers[nid], &g->servers[aid]);
-
-                    /* no PoP layer: nothing to record here */
-
-                int blds = rand_range(params.buildings_min, params.buildings_max);
-                for (int b = 0; b < blds; b++) {
-                    snprintf(name_buf, sizeof(name_buf), "bld%d_n%d_a%d_p%d", b + 1, n + 1, a + 1, pidx + 1);
-                    int bid = server_generate_random(g->servers, &g->server_count, name_buf);
-                    if (bid == SERVER_INVALID_ID) break;
-                    g->servers[bid].type = SERVER_TYPE_BUILDING;
-                    /* link building to neighborhood */
-                    server_link_bidirectional(&g->servers[bid], &g->servers[nid]);
-
-                    int floors = rand_range(params.floors_per_building_min, params.floors_per_building_max);
-                    if (floors <= 1) {
-                        /* No explicit floors: create routers directly under building */
-                        int rtrs = rand_range(params.routers_per_building_min, params.routers_per_building_max);
-                        for (int r = 0; r < rtrs; r++) {
-                            snprintf(name_buf, sizeof(name_buf), "rtr_b%d_n%d_a%d_p%d_r%d", b + 1, n + 1, a + 1, pidx + 1, r + 1);
-                            int rid = server_generate_random(g->servers, &g->server_count, name_buf);
-                            if (rid == SERVER_INVALID_ID) break;
-                            g->servers[rid].type = SERVER_TYPE_ROUTER;
-                            /* mark router subnet as building id so we can keep links scoped */
-                            g->servers[rid].subnet_id = bid;
-                            /* link router to building */
-                            server_link_bidirectional(&g->servers[rid], &g->servers[bid]);
-
-                            int users = rand_range(params.users_per_router_min, params.users_per_router_max);
-                            if (users <= 0) continue;
-                            /* Attach users directly to this router (no ToR layer).
-                             * This yields: floor -> router -> hosts
-                             */
-                            for (int u = 0; u < users; u++) {
-                                snprintf(name_buf, sizeof(name_buf), "usr%d", g->server_count + 1);
-                                int uid = server_generate_random(g->servers, &g->server_count, name_buf);
-                                if (uid == SERVER_INVALID_ID) break;
-                                server_link_bidirectional(&g->servers[uid], &g->servers[rid]);
-                                g->servers[uid].subnet_id = bid;
-                                g->servers[uid].type = SERVER_TYPE_USER;
-                                g->servers[uid].service_count = 0;
-                            }
-                        }
-                    } else {
-                        /* Create floor nodes, attach routers to floors */
-                        for (int f = 0; f < floors; f++) {
-                            snprintf(name_buf, sizeof(name_buf), "floor%d_b%d_n%d_a%d_p%d", f + 1, b + 1, n + 1, a + 1, pidx + 1);
-                            int fid = server_generate_random(g->servers, &g->server_count, name_buf);
-                            if (fid == SERVER_INVALID_ID) break;
-                            g->servers[fid].type = SERVER_TYPE_FLOOR;
-                            server_link_bidirectional(&g->servers[fid], &g->servers[bid]);
-
-                            int rtrs = rand_range(params.routers_per_building_min, params.routers_per_building_max);
-                            for (int r = 0; r < rtrs; r++) {
-                                snprintf(name_buf, sizeof(name_buf), "rtr_floor%d_b%d_n%d_a%d_p%d_r%d", f + 1, b + 1, n + 1, a + 1, pidx + 1, r + 1);
-                                int rid = server_generate_random(g->servers, &g->server_count, name_buf);
-                                if (rid == SERVER_INVALID_ID) break;
-                                g->servers[rid].type = SERVER_TYPE_ROUTER;
-                                    /* mark router subnet as building id so we can keep links scoped */
-                                    g->servers[rid].subnet_id = bid;
-                                /* link router to floor */
-                                server_link_bidirectional(&g->servers[rid], &g->servers[fid]);
-
-                                int users = rand_range(params.users_per_router_min, params.users_per_router_max);
-                                if (users <= 0) continue;
-                                /* Attach users directly to this router (no ToR layer). */
-                                for (int u = 0; u < users; u++) {
-                                    snprintf(name_buf, sizeof(name_buf), "usr%d", g->server_count + 1);
-                                    int uid = server_generate_random(g->servers, &g->server_count, name_buf);
-                                    if (uid == SERVER_INVALID_ID) break;
-                                    server_link_bidirectional(&g->servers[uid], &g->servers[rid]);
-                                    g->servers[uid].subnet_id = bid;
-                                    g->servers[uid].type = SERVER_TYPE_USER;
-                                    g->servers[uid].service_count = 0;
-                                }
-                            }
-                        }
-                    }
-                }
+/* Adds a generated server to the block and returns its global id. */
+static ServerId block_add(GenBlock* out, const ServerCoord* c, Rng* stats, ServerType type, int subnet) {
+    ServerId local = add_named(out->servers, c, stats, out->compact_names);
+    if (local == SERVER_INVALID_ID) return SERVER_INVALID_ID;
+    server_set_type(out->servers, local, type);
+    if (subnet >= 0) server_set_subnet(out->servers, local, subnet);
+    return out->base + local;
+}
+
+/* Walks one building (floors, routers, users). With out == NULL only the
+ * shape stream is read; if `routers` is set it then receives the ids the
+ * routers will get, given the building gets `first`. Returns the number
+ * of servers, or -1 on failure. */
+static int gen_building(const GeneratorParams* p, const NeighJob* job, int b, ServerId nid, GenBlock* out,
+                        ServerId first, ServerId* routers, int* router_count) {
+    uint64_t key = child_key(job->key, b);
+    Rng shape, stats;
+    rng_init(&shape, rng_key(key, STREAM_SHAPE));
+    rng_init(&stats, rng_key(key, STREAM_STATS));
+    ServerCoord c = { SERVER_NAME_BUILDING, job->isp + 1, job->area + 1, job->neigh + 1, b + 1, 0, 0, 0 };
+    int count = 1;
+    if (router_count) *router_count = 0;
+
+    ServerId bid = SERVER_INVALID_ID;
+    if (out) {
+        bid = block_add(out, &c, &stats, SERVER_TYPE_BUILDING, -1);
+        if (bid == SERVER_INVALID_ID) return -1;
+        link_graph_add_bidirectional(out->links, bid, nid);
+    }
+
+    int floors = rng_range(&shape, p->floors_per_building_min, p->floors_per_building_max);
+    /* with a single floor, routers hang directly off the building */
+    int levels = floors <= 1 ? 1 : floors;
+    for (int f = 0; f < levels; f++) {
+        ServerId up = bid;
+        if (floors > 1) {
+            count++;
+            if (out) {
+                c.kind = SERVER_NAME_FLOOR;
+                c.floor = f + 1;
+                up = block_add(out, &c, &stats, SERVER_TYPE_FLOOR, -1);
+                if (up == SERVER_INVALID_ID) return -1;
+                link_graph_add_bidirectional(out->links, up, bid);
+            }
+        }
+
+        int rtrs = rng_range(&shape, p->routers_per_building_min, p->routers_per_building_max);
+        for (int r = 0; r < rtrs; r++) {
+            if (!out && routers) routers[(*router_count)++] = first + count;
+            count++;
+            ServerId rid = SERVER_INVALID_ID;
+            if (out) {
+                c.kind = floors > 1 ? SERVER_NAME_FLOOR_ROUTER : SERVER_NAME_ROUTER;
+                c.floor = f + 1;
+                c.router = r + 1;
+                /* mark router subnet as building id so we can keep links scoped */
+                rid = block_add(out, &c, &stats, SERVER_TYPE_ROUTER, bid);
+                if (rid == SERVER_INVALID_ID) return -1;
+                link_graph_add_bidirectional(out->links, rid, up);
+            }
+
+            int users = rng_range(&shape, p->users_per_router_min, p->users_per_router_max);
+            if (users <= 0) continue;
+            count += users;
+            if (!out) continue;
+            /* Attach users directly to this router (no ToR layer). */
+            for (int u = 0; u < users; u++) {
+                ServerCoord uc = { SERVER_NAME_USER, 0, 0, 0, 0, 0, 0,
+                                   out->base + out->servers->count + out->name_offset + 1 };
+                ServerId uid = block_add(out, &uc, &stats, SERVER_TYPE_USER, bid);
+                if (uid == SERVER_INVALID_ID) return -1;
+                link_graph_add_bidirectional(out->links, uid, rid);
+                server_clear_services(out->servers, uid - out->base);
             }
         }
     }
+    return count;
+}
 
-        /* Rare inter-router links to create some mesh within neighbourhoods.
-         * Only link router-like devices so we don't connect ISPs/POPs/area nodes
-         * directly to users/hosts. This keeps the hierarchical layering intact.
-         */
-        int total = g->server_count;
-        for (int a = 1; a < total; a++) {
-            for (int b = a + 1; b < total; b++) {
-                if (!is_router_like(g->servers[a].type)) continue;
-                if (!is_router_like(g->servers[b].type)) continue;
-                if (((double)rand() / (double)RAND_MAX) < params.inter_router_link_density) {
-                    /* optional: prefer linking routers in same subnet if known */
-                    if (g->servers[a].subnet_id != -1 && g->servers[a].subnet_id == g->servers[b].subnet_id) {
-                        server_link_bidirectional(&g->servers[a], &g->servers[b]);
-                    } else {
-                        server_link_bidirectional(&g->servers[a], &g->servers[b]);
-                    }
+ServerId gen_neigh_server(const NeighJob* job, GenBlock* out) {
+    Rng stats;
+    rng_init(&stats, rng_key(job->key, STREAM_STATS));
+    ServerCoord c = { SERVER_NAME_NEIGH, job->isp + 1, job->area + 1, job->neigh + 1, 0, 0, 0, 0 };
+    ServerId nid = block_add(out, &c, &stats, SERVER_TYPE_NEIGHBORHOOD, -1);
+    if (nid == SERVER_INVALID_ID) return SERVER_INVALID_ID;
+    /* link neighborhood to area */
+    link_graph_add_bidirectional(out->links, nid, job->area_id);
+    return nid;
+}
+
+int gen_neigh_children(const GeneratorParams* p, const NeighJob* job, ServerId nid, GenBlock* out) {
+    Rng shape;
+    rng_init(&shape, rng_key(job->key, STREAM_SHAPE));
+    int count = 0;
+    int blds = rng_range(&shape, p->buildings_min, p->buildings_max);
+    for (int b = 0; b < blds; b++) {
+        int c = gen_building(p, job, b, nid, out, 0, NULL, NULL);
+        if (c < 0) return -1;
+        count += c;
+    }
+    return count;
+}
+
+/* Walks one neighbourhood; see gen_building(). */
+static int gen_neighbourhood(const GeneratorParams* p, const NeighJob* job, GenBlock* out) {
+    ServerId nid = SERVER_INVALID_ID;
+    if (out) {
+        nid = gen_neigh_server(job, out);
+        if (nid == SERVER_INVALID_ID) return -1;
+    }
+    int count = gen_neigh_children(p, job, nid, out);
+    return count < 0 ? -1 : count + 1;
+}
+
+static void run_job(const GeneratorParams* p, NeighJob* job) {
+    server_store_init(&job->servers);
+    link_graph_init(&job->links);
+    GenBlock out = { &job->servers, &job->links, job->base, 0, p->compact_names };
+    job->ok = gen_neighbourhood(p, job, &out) == job->count;
+}
+
+static void* gen_worker(void* arg) {
+    JobQueue* q = arg;
+    for (;;) {
+        int i = atomic_fetch_add(&q->next, 1);
+        if (i >= q->count) break;
+        run_job(q->params, &q->jobs[i]);
+    }
+    return NULL;
+}
+
+void gen_run_jobs(const GeneratorParams* p, NeighJob* jobs, int count, int threads) {
+    JobQueue q = { p, jobs, count, 0 };
+    if (threads > count) threads = count;
+    if (threads > GENERATOR_MAX_THREADS) threads = GENERATOR_MAX_THREADS;
+    pthread_t tids[GENERATOR_MAX_THREADS];
+    int started = 0;
+    for (int i = 1; i < threads; i++) {
+        if (pthread_create(&tids[started], NULL, gen_worker, &q) != 0) break;
+        started++;
+    }
+    gen_worker(&q);
+    for (int i = 0; i < started; i++) pthread_join(tids[i], NULL);
+}
+
+void gen_job_release(NeighJob* job) {
+    server_store_free(&job->servers);
+    link_graph_free(&job->links);
+}
+
+int gen_thread_count(const GeneratorParams* p) {
+    int threads = p->threads;
+    if (threads <= 0) threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    return threads > 0 ? threads : 1;
+}
+
+static void default_params(GeneratorParams* params) {
+    memset(params, 0, sizeof(*params));
+    params->isp_count = 1;
+    params->areas_min = 1;
+    params->areas_max = 2;
+    params->neigh_min = 3;
+    params->neigh_max = 6;
+    params->buildings_min = 4;
+    params->buildings_max = 10;
+    params->floors_per_building_min = 1;
+    params->floors_per_building_max = 3;
+    params->routers_per_building_min = 1;
+    params->routers_per_building_max = 4;
+    params->users_per_router_min = 8;
+    params->users_per_router_max = 32;
+    params->inter_router_link_density = 0.00;
+    params->intra_subnet_link_density = 0.00;
+    params->public_dmz_fraction = 0.02;
+    params->threads = 0;
+}
+
+/* Falls back to the default for a range bound that is 0 or negative and
+ * raises max to min, so every walk can size its buffers from max. */
+static void clamp_range(int* min, int* max, int def_min, int def_max) {
+    if (*min <= 0) *min = def_min;
+    if (*max <= 0) *max = def_max;
+    if (*max < *min) *max = *min;
+}
+
+static void normalise_params(GeneratorParams* p) {
+    GeneratorParams d;
+    default_params(&d);
+    if (p->isp_count <= 0) p->isp_count = d.isp_count;
+    clamp_range(&p->areas_min, &p->areas_max, d.areas_min, d.areas_max);
+    clamp_range(&p->neigh_min, &p->neigh_max, d.neigh_min, d.neigh_max);
+    clamp_range(&p->buildings_min, &p->buildings_max, d.buildings_min, d.buildings_max);
+    clamp_range(&p->floors_per_building_min, &p->floors_per_building_max,
+                d.floors_per_building_min, d.floors_per_building_max);
+    clamp_range(&p->routers_per_building_min, &p->routers_per_building_max,
+                d.routers_per_building_min, d.routers_per_building_max);
+    clamp_range(&p->users_per_router_min, &p->users_per_router_max,
+                d.users_per_router_min, d.users_per_router_max);
+}
+
+/* Ranges must fit the packed name coordinates (see server.c); ISPs, areas
+ * and neighbourhoods are servers of their own, so none can outnumber the
+ * store. */
+bool generator_params_valid(const GeneratorParams* params, int server_count) {
+    if (!params) return false;
+    const int pairs[][2] = {
+        { params->areas_min, params->areas_max },
+        { params->neigh_min, params->neigh_max },
+        { params->buildings_min, params->buildings_max },
+        { params->floors_per_building_min, params->floors_per_building_max },
+        { params->routers_per_building_min, params->routers_per_building_max },
+        { params->users_per_router_min, params->users_per_router_max },
+    };
+    for (size_t i = 0; i < sizeof(pairs) / sizeof(pairs[0]); i++) {
+        if (pairs[i][0] > 0 && pairs[i][1] > 0 && pairs[i][0] > pairs[i][1]) return false;
+    }
+    const double fractions[] = { params->inter_router_link_density, params->intra_subnet_link_density,
+                                 params->public_dmz_fraction };
+    for (size_t i = 0; i < sizeof(fractions) / sizeof(fractions[0]); i++) {
+        if (!(fractions[i] >= 0.0 && fractions[i] <= 1.0)) return false;
+    }
+
+    GeneratorParams p = *params;
+    normalise_params(&p);
+    if (p.isp_count > 0xffff || p.isp_count > server_count) return false;
+    if (p.areas_max > 0xff || p.areas_max > server_count) return false;
+    if (p.neigh_max > 0x3ff || p.neigh_max > server_count) return false;
+    if (p.buildings_max > 0x3ff || p.floors_per_building_max > 0xff || p.routers_per_building_max > 0xff) {
+        return false;
+    }
+    /* the largest neighbourhood the ranges allow must still have int ids */
+    double routers = (double)p.routers_per_building_max * (1.0 + p.users_per_router_max);
+    double neigh = 1.0 + p.buildings_max * (1.0 + p.floors_per_building_max * (1.0 + routers));
+    return neigh <= (double)INT_MAX;
+}
+
+CoreResult gen_plan(GenPlan* plan, const GeneratorParams* params, unsigned int seed, ServerId first_isp) {
+    if (!plan) return CORE_ERR_INVALID_ARG;
+    memset(plan, 0, sizeof(*plan));
+    if (params) plan->params = *params; else default_params(&plan->params);
+    normalise_params(&plan->params);
+    const GeneratorParams* p = &plan->params;
+
+    /* Every node draws from streams keyed by its path from the seed, so
+     * the world does not depend on the order subtrees are built in. */
+    plan->world = seed != 0 ? seed : GENERATOR_DEFAULT_SEED;
+    plan->isp_root = rng_key(plan->world, WORLD_ISPS);
+    plan->isp_count = p->isp_count;
+    plan->first_isp = first_isp;
+
+    /* Size every neighbourhood from its shape stream, so each one knows
+     * its final ids before it is built. */
+    int area_cap = 0, job_cap = 0;
+    ServerId next_id = first_isp + plan->isp_count;
+    Rng rng;
+    for (int pidx = 0; pidx < plan->isp_count; pidx++) {
+        uint64_t isp_key = child_key(plan->isp_root, pidx);
+        rng_init(&rng, rng_key(isp_key, STREAM_SHAPE));
+        int na = rng_range(&rng, p->areas_min, p->areas_max);
+        for (int a = 0; a < na; a++) {
+            if (plan->area_count == area_cap) {
+                area_cap = area_cap ? area_cap * 2 : 16;
+                AreaPlan* grown = realloc(plan->areas, (size_t)area_cap * sizeof(*grown));
+                if (!grown) goto fail;
+                plan->areas = grown;
+            }
+            AreaPlan* ap = &plan->areas[plan->area_count++];
+            ap->key = child_key(isp_key, a);
+            ap->isp = pidx;
+            ap->area = a;
+            ap->id = next_id++;
+            ap->first_job = plan->job_count;
+            rng_init(&rng, rng_key(ap->key, STREAM_SHAPE));
+            ap->job_count = rng_range(&rng, p->neigh_min, p->neigh_max);
+            for (int n = 0; n < ap->job_count; n++) {
+                if (plan->job_count == job_cap) {
+                    job_cap = job_cap ? job_cap * 2 : 64;
+                    NeighJob* grown = realloc(plan->jobs, (size_t)job_cap * sizeof(*grown));
+                    if (!grown) goto fail;
+                    plan->jobs = grown;
                 }
+                NeighJob* job = &plan->jobs[plan->job_count++];
+                memset(job, 0, sizeof(*job));
+                job->key = child_key(ap->key, n);
+                job->isp = pidx;
+                job->area = a;
+                job->neigh = n;
+                job->area_id = ap->id;
+                job->base = next_id;
+                job->count = gen_neighbourhood(p, job, NULL);
+                if (job->count > INT_MAX - next_id) goto fail;
+                next_id += job->count;
             }
         }
+    }
+    plan->end_id = next_id;
+    return CORE_OK;
 
-        /* DMZ/public exposure step removed: keep topology strictly hierarchical
-         * (ISP -> Area -> Neighborhood -> Building -> Floor -> Router -> Host).
-         */
+fail:
+    gen_plan_free(plan);
+    return CORE_ERR_UNKNOWN;
 }
 
-void generator_generate_city(GameState* g, unsigned int seed) {
-    GeneratorParams params = {0};
+void gen_plan_free(GenPlan* plan) {
+    if (!plan) return;
+    for (int j = 0; j < plan->job_count; j++) gen_job_release(&plan->jobs[j]);
+    free(plan->jobs);
+    free(plan->areas);
+    plan->jobs = NULL;
+    plan->areas = NULL;
+    plan->job_count = plan->area_count = 0;
+}
+
+ServerId gen_isp(const GenPlan* plan, int i, ServerStore* out) {
+    ServerCoord c = { SERVER_NAME_ISP, i + 1, 0, 0, 0, 0, 0, 0 };
+    Rng rng;
+    rng_init(&rng, rng_key(child_key(plan->isp_root, i), STREAM_STATS));
+    ServerId id = add_named(out, &c, &rng, plan->params.compact_names);
+    if (id != SERVER_INVALID_ID) server_set_type(out, id, SERVER_TYPE_ISP);
+    return id;
+}
+
+ServerId gen_area(const GenPlan* plan, const AreaPlan* ap, ServerStore* out) {
+    ServerCoord c = { SERVER_NAME_AREA, ap->isp + 1, ap->area + 1, 0, 0, 0, 0, 0 };
+    Rng rng;
+    rng_init(&rng, rng_key(ap->key, STREAM_STATS));
+    ServerId id = add_named(out, &c, &rng, plan->params.compact_names);
+    if (id != SERVER_INVALID_ID) server_set_type(out, id, SERVER_TYPE_AREA);
+    return id;
+}
+
+int gen_walk_routers(const GenPlan* plan, GenRouterVisit visit, void* ctx) {
+    const GeneratorParams* p = &plan->params;
+    /* gen_plan() raised every max to its min, so max bounds each draw */
+    ServerId* routers = malloc((size_t)p->floors_per_building_max *
+                               (size_t)p->routers_per_building_max * sizeof(*routers));
+    if (!routers) return -1;
+
+    Rng shape;
+    for (int j = 0; j < plan->job_count; j++) {
+        const NeighJob* job = &plan->jobs[j];
+        rng_init(&shape, rng_key(job->key, STREAM_SHAPE));
+        int blds = rng_range(&shape, p->buildings_min, p->buildings_max);
+        ServerId next = job->base + 1;
+        for (int b = 0; b < blds; b++) {
+            int count = 0;
+            next += gen_building(p, job, b, SERVER_INVALID_ID, NULL, next, routers, &count);
+            if (count > 0) visit(ctx, routers, count);
+        }
+    }
+    free(routers);
+    return 0;
+}
+
+/* Number of misses before the next hit when every trial succeeds with
+ * probability p (geometric distribution, inverse transform). */
+static int64_t geometric_skip(Rng* rng, double log_miss) {
+    if (log_miss == 0.0) return INT64_MAX / 2; /* p rounds to zero */
+    if (log_miss < -700.0) return 0;           /* p == 1 */
+    double u = 1.0 - rng_unit(rng);            /* (0, 1] */
+    double skip = floor(log(u) / log_miss);
+    return skip < (double)(INT64_MAX / 2) ? (int64_t)skip : INT64_MAX / 2;
+}
+
+void pair_sampler_init(PairSampler* s, uint64_t key, double p) {
+    rng_init(&s->rng, key);
+    s->enabled = p > 0.0;
+    s->log_miss = p >= 1.0 ? -INFINITY : log1p(-p);
+    s->skip = s->enabled ? geometric_skip(&s->rng, s->log_miss) : 0;
+}
+
+/* Hits are found by skipping a geometric number of pairs at a time, so a
+ * pass costs one step per row plus one per link rather than per pair. */
+int pair_sampler_next(PairSampler* s, int* lo, int hi) {
+    if (!s->enabled || *lo >= hi) return -1;
+    if (s->skip < hi - *lo) {
+        int j = *lo + (int)s->skip;
+        *lo = j + 1;
+        s->skip = geometric_skip(&s->rng, s->log_miss);
+        return j;
+    }
+    s->skip -= hi - *lo;
+    *lo = hi;
+    return -1;
+}
+
+void gen_mesh_passes(LinkGraph* links, const ServerId* ids, const int* bucket_end, int m,
+                     const GeneratorParams* p, uint64_t key) {
+    PairSampler ps;
+    pair_sampler_init(&ps, rng_key(key, MESH_INTRA), p->intra_subnet_link_density);
+    for (int i = 0; i < m; i++) {
+        int lo = i + 1, j;
+        while ((j = pair_sampler_next(&ps, &lo, bucket_end[i])) >= 0) {
+            link_graph_add_bidirectional(links, ids[i], ids[j]);
+        }
+    }
+    pair_sampler_init(&ps, rng_key(key, MESH_INTER), p->inter_router_link_density);
+    for (int i = 0; i < m; i++) {
+        int lo = bucket_end[i], j;
+        while ((j = pair_sampler_next(&ps, &lo, m)) >= 0) {
+            link_graph_add_bidirectional(links, ids[i], ids[j]);
+        }
+    }
+}
+
+/*
+ * Adds random links between router-like devices. Routers are grouped by
+ * subnet with a counting sort (routers without a subnet are each their
+ * own subnet). Row i of the same-subnet pass covers the routers after i
+ * in its subnet; row i of the cross-subnet pass covers every router in a
+ * later subnet.
+ */
+static void link_mesh(GameState* g, const GeneratorParams* p, uint64_t key) {
+    if (p->inter_router_link_density <= 0.0 && p->intra_subnet_link_density <= 0.0) return;
+    int total = g->servers.count;
+    const uint8_t* types = g->servers.type;
+    const int32_t* subnets = g->servers.subnet_id;
+
+    int m = 0;
+    for (int a = 1; a < total; a++) {
+        if (is_router_like((ServerType)types[a])) m++;
+    }
+    if (m < 2) return;
+
+    /* slot 0 counts routers without a subnet; slot s + 1 counts subnet s */
+    int* start = calloc((size_t)total + 2, sizeof(*start));
+    ServerId* ids = malloc((size_t)m * sizeof(*ids));
+    int* bucket_end = malloc((size_t)m * sizeof(*bucket_end));
+    if (!start || !ids || !bucket_end) goto out;
+    for (int a = 1; a < total; a++) {
+        if (!is_router_like((ServerType)types[a])) continue;
+        int s = subnets[a] >= 0 && subnets[a] < total ? subnets[a] + 1 : 0;
+        start[s + 1]++;
+    }
+    for (int s = 0; s <= total; s++) start[s + 1] += start[s];
+    for (int a = 1; a < total; a++) {
+        if (!is_router_like((ServerType)types[a])) continue;
+        int s = subnets[a] >= 0 && subnets[a] < total ? subnets[a] + 1 : 0;
+        ids[start[s]++] = a;
+    }
+    /* after the scatter start[s] is the end of bucket s */
+    int no_subnet = start[0];
+    for (int i = 0; i < no_subnet; i++) bucket_end[i] = i + 1;
+    for (int i = no_subnet; i < m;) {
+        int a = ids[i];
+        int end = start[subnets[a] + 1];
+        for (; i < end; i++) bucket_end[i] = end;
+    }
+
+    gen_mesh_passes(&g->links, ids, bucket_end, m, p, key);
+
+out:
+    free(start);
+    free(ids);
+    free(bucket_end);
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* Adds the time since *mark to *stage and moves the mark. */
+static void lap(double* mark, double* stage) {
+    double t = now_seconds();
+    if (stage) *stage += t - *mark;
+    *mark = t;
+}
+
+void generator_generate_timed(GameState* g, const GeneratorParams* p, unsigned int seed, GeneratorTimings* timings) {
+    if (!g) return;
+    GeneratorTimings unused;
+    GeneratorTimings* t = timings ? timings : &unused;
+    memset(t, 0, sizeof(*t));
+    double mark = now_seconds();
+
+    GenPlan plan;
+    if (gen_plan(&plan, p, seed, g->servers.count) != CORE_OK) return;
+    lap(&mark, &t->plan);
+
+    /* Create ISP nodes */
+    int ok = 1;
+    for (int i = 0; i < plan.isp_count && ok; i++) {
+        ok = gen_isp(&plan, i, &g->servers) == plan.first_isp + i;
+    }
+    lap(&mark, &t->isps);
+
+    if (ok) {
+        gen_run_jobs(&plan.params, plan.jobs, plan.job_count, gen_thread_count(&plan.params));
+        lap(&mark, &t->neighbourhoods);
+
+        /* splice the blocks back in id order; the result is the same for
+         * any thread count */
+        for (int i = 0; i < plan.area_count && ok; i++) {
+            const AreaPlan* ap = &plan.areas[i];
+            int aid = gen_area(&plan, ap, &g->servers);
+            if (aid != ap->id) {
+                ok = 0;
+                break;
+            }
+            /* link area to ISP (no PoP layer) */
+            link_graph_add_bidirectional(&g->links, aid, plan.first_isp + ap->isp);
+
+            for (int j = ap->first_job; j < ap->first_job + ap->job_count; j++) {
+                NeighJob* job = &plan.jobs[j];
+                ok = job->ok && g->servers.count == job->base &&
+                     server_store_append(&g->servers, &job->servers) == CORE_OK &&
+                     link_graph_append_staged(&g->links, &job->links) == CORE_OK;
+                if (!ok) break;
+                gen_job_release(job);
+            }
+        }
+        lap(&mark, &t->splice);
+    }
+
+    /* Rare inter-router links to create some mesh. Only router-like
+     * devices are linked, so the hierarchical layering stays intact. A
+     * failed splice leaves a truncated world: don't mesh it. gen_plan_free()
+     * releases any blocks that were never spliced. */
+    if (ok) link_mesh(g, &plan.params, rng_key(plan.world, WORLD_MESH));
+    gen_plan_free(&plan);
+    lap(&mark, &t->mesh);
+
+    /* DMZ/public exposure step removed: keep topology strictly hierarchical
+     * (ISP -> Area -> Neighborhood -> Building -> Floor -> Router -> Host).
+     */
+
+    /* pack the staged links for scans, path queries and saves */
+    link_graph_freeze(&g->links, g->servers.count);
+    lap(&mark, &t->freeze);
+}
+
+void generator_generate_with_params(GameState* g, const GeneratorParams* p, unsigned int seed) {
+    generator_generate_timed(g, p, seed, NULL);
+}
+
+void generator_city_params(GeneratorParams* params) {
+    memset(params, 0, sizeof(*params));
     /* set explicit sensible defaults */
-    params.isp_count = 1;
-    params.areas_min = 1;
-    params.areas_max = 2;
-    params.neigh_min = 3;
-    params.neigh_max = 6;
-    params.buildings_min = 4;
-    params.buildings_max = 8;
-    params.floors_per_building_min = 1;
-    params.floors_per_building_max = 2;
-    params.routers_per_building_min = 1;
-    params.routers_per_building_max = 3;
-    params.users_per_router_min = 8;
-    params.users_per_router_max = 24;
-    params.inter_router_link_density = 0.01;
-    params.public_dmz_fraction = 0.02;
+    params->isp_count = 1;
+    params->areas_min = 1;
+    params->areas_max = 2;
+    params->neigh_min = 3;
+    params->neigh_max = 6;
+    params->buildings_min = 4;
+    params->buildings_max = 8;
+    params->floors_per_building_min = 1;
+    params->floors_per_building_max = 2;
+    params->routers_per_building_min = 1;
+    params->routers_per_building_max = 3;
+    params->users_per_router_min = 8;
+    params->users_per_router_max = 24;
+    params->inter_router_link_density = 0.01;
+    params->intra_subnet_link_density = 0.01;
+    params->public_dmz_fraction = 0.02;
+}
 
+void generator_generate_city(GameState* g, unsigned int seed) {
+    GeneratorParams params;
+    generator_city_params(&params);
     generator_generate_with_params(g, &params, seed);
 }
@@ -0,0 +1,116 @@
+/* generator_internal.h - pieces shared by the in-memory and streaming generators */
+#ifndef SRC_GENERATOR_INTERNAL_H_
+#define SRC_GENERATOR_INTERNAL_H_
+
+#include <stdint.h>
+
+#include "generator.h"
+#include "link_graph.h"
+#include "rng.h"
+#include "server.h"
+
+/* substreams of the world seed */
+enum { WORLD_ISPS = 1, WORLD_MESH = 2 };
+
+/* Substreams under every node key: the node's own shape (how many
+ * children it has) and stats, then one key per child. Keeping shape and
+ * stats apart lets a subtree be sized without generating it. */
+enum { STREAM_SHAPE = 0, STREAM_STATS = 1, STREAM_CHILD = 2 };
+
+/* substreams of the mesh key; MESH_LOCAL holds one key per neighbourhood
+ * for the mesh of lazily expanded worlds */
+enum { MESH_INTRA = 0, MESH_INTER = 1, MESH_LOCAL = 2 };
+
+/* Destination of a subtree walk: a private store whose local id 0 will
+ * become global id `base`, plus staged links in global ids. Ids written
+ * into generated names are shifted by `name_offset`. */
+typedef struct {
+    ServerStore* servers;
+    LinkGraph* links;
+    ServerId base;
+    ServerId name_offset;
+    int compact_names; /* see GeneratorParams */
+} GenBlock;
+
+/* One neighbourhood and everything below it: the unit of parallel work. */
+typedef struct {
+    uint64_t key;
+    int isp, area, neigh; /* 0-based, for names */
+    ServerId area_id;     /* parent area (global) */
+    ServerId base;        /* global id of the neighbourhood server */
+    int count;            /* servers in the subtree */
+    ServerStore servers;
+    LinkGraph links;
+    int ok;
+} NeighJob;
+
+typedef struct {
+    uint64_t key;
+    int isp, area;
+    ServerId id;
+    int first_job;
+    int job_count;
+} AreaPlan;
+
+/* Every ISP, area and neighbourhood of a world with its final ids, worked
+ * out from the shape streams alone. */
+typedef struct {
+    GeneratorParams params; /* with defaults applied */
+    uint64_t world;         /* root key */
+    uint64_t isp_root;
+    int isp_count;
+    ServerId first_isp;     /* ISPs take ids first_isp .. first_isp + isp_count - 1 */
+    AreaPlan* areas;
+    int area_count;
+    NeighJob* jobs;
+    int job_count;
+    ServerId end_id;        /* one past the last id of the world */
+} GenPlan;
+
+/* Called with the routers of one building, in id order. */
+typedef void (*GenRouterVisit)(void* ctx, const ServerId* routers, int count);
+
+/* Plans a world whose first ISP gets id `first_isp`. */
+CoreResult gen_plan(GenPlan* plan, const GeneratorParams* params, unsigned int seed, ServerId first_isp);
+void gen_plan_free(GenPlan* plan);
+
+/* Generate ISP `i` or an area server into `out`; return its id there. */
+ServerId gen_isp(const GenPlan* plan, int i, ServerStore* out);
+ServerId gen_area(const GenPlan* plan, const AreaPlan* ap, ServerStore* out);
+
+/* Adds a job's neighbourhood server, linked to job->area_id. */
+ServerId gen_neigh_server(const NeighJob* job, GenBlock* out);
+
+/* Adds everything below neighbourhood `nid`; returns the number of
+ * servers added, or -1. With out == NULL only counts them. */
+int gen_neigh_children(const GeneratorParams* p, const NeighJob* job, ServerId nid, GenBlock* out);
+
+/* Builds each job's block, on up to `threads` threads including the caller. */
+void gen_run_jobs(const GeneratorParams* p, NeighJob* jobs, int count, int threads);
+void gen_job_release(NeighJob* job);
+int gen_thread_count(const GeneratorParams* p);
+
+/* Visits the routers of every building in id order from the shape
+ * streams. Returns 0, or -1 if memory ran out. */
+int gen_walk_routers(const GenPlan* plan, GenRouterVisit visit, void* ctx);
+
+/* Runs both mesh passes over `m` routers grouped by subnet; the group of
+ * ids[i] ends before bucket_end[i]. */
+void gen_mesh_passes(LinkGraph* links, const ServerId* ids, const int* bucket_end, int m,
+                     const GeneratorParams* p, uint64_t key);
+
+/* Draws the pairs linked by a mesh pass one row at a time. */
+typedef struct {
+    Rng rng;
+    double log_miss;
+    int64_t skip;
+    int enabled;
+} PairSampler;
+
+void pair_sampler_init(PairSampler* s, uint64_t key, double p);
+
+/* Returns the next linked column in [*lo, hi) of the current row and moves
+ * *lo past it, or -1 once the row is used up. */
+int pair_sampler_next(PairSampler* s, int* lo, int hi);
+
+#endif  // SRC_GENERATOR_INTERNAL_H_
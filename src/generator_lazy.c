@@ -0,0 +1,220 @@
+/* generator_lazy.c - worlds whose neighbourhoods are filled in on first visit */
+#include <stdlib.h>
+#include <string.h>
+
+#include "generator.h"
+#include "generator_internal.h"
+
+struct GenLazy {
+    GenPlan plan;
+    unsigned int seed;
+    ServerId* neigh_ids;     /* per job: its neighbourhood server, ascending */
+    unsigned char* expanded; /* per job: subtree already generated */
+    uint64_t mesh_key;
+};
+
+void generator_lazy_free(GenLazy* lz) {
+    if (!lz) return;
+    gen_plan_free(&lz->plan);
+    free(lz->neigh_ids);
+    free(lz->expanded);
+    free(lz);
+}
+
+/* Plans the world and its per-job tables; no servers are added. */
+static GenLazy* lazy_plan(const GeneratorParams* params, unsigned int seed, ServerId first_isp) {
+    GenLazy* lz = calloc(1, sizeof(*lz));
+    if (!lz) return NULL;
+    if (gen_plan(&lz->plan, params, seed, first_isp) != CORE_OK) {
+	free(lz);
+	return NULL;
+    }
+    GenPlan* plan = &lz->plan;
+    lz->seed = seed;
+    lz->mesh_key = rng_key(rng_key(plan->world, WORLD_MESH), MESH_LOCAL);
+    lz->neigh_ids = malloc(((size_t)plan->job_count + 1) * sizeof(*lz->neigh_ids));
+    lz->expanded = calloc((size_t)plan->job_count + 1, 1);
+    if (!lz->neigh_ids || !lz->expanded) {
+	generator_lazy_free(lz);
+	return NULL;
+    }
+    return lz;
+}
+
+GenLazy* generator_generate_lazy(GameState* g, const GeneratorParams* params, unsigned int seed) {
+    if (!g) return NULL;
+    GenLazy* lz = lazy_plan(params, seed, g->servers.count);
+    if (!lz) return NULL;
+    GenPlan* plan = &lz->plan;
+
+    int ok = 1;
+    for (int i = 0; i < plan->isp_count && ok; i++) {
+	ok = gen_isp(plan, i, &g->servers) == plan->first_isp + i;
+    }
+
+    /* Areas and neighbourhood servers only. Ids are handed out as servers
+     * appear, so they differ from the eager world's from the first area
+     * on; the jobs are pointed at the ids their parents really got. */
+    GenBlock out = { &g->servers, &g->links, 0, 0, plan->params.compact_names };
+    for (int i = 0; i < plan->area_count && ok; i++) {
+	const AreaPlan* ap = &plan->areas[i];
+	ServerId aid = gen_area(plan, ap, &g->servers);
+	if (aid == SERVER_INVALID_ID) {
+	    ok = 0;
+	    break;
+	}
+	link_graph_add_bidirectional(&g->links, aid, plan->first_isp + ap->isp);
+	for (int j = ap->first_job; j < ap->first_job + ap->job_count && ok; j++) {
+	    plan->jobs[j].area_id = aid;
+	    lz->neigh_ids[j] = gen_neigh_server(&plan->jobs[j], &out);
+	    ok = lz->neigh_ids[j] != SERVER_INVALID_ID;
+	}
+    }
+    link_graph_freeze(&g->links, g->servers.count);
+    if (!ok) {
+	generator_lazy_free(lz);
+	return NULL;
+    }
+    return lz;
+}
+
+static int find_job(const GenLazy* lz, ServerId id) {
+    int lo = 0, hi = lz->plan.job_count;
+    while (lo < hi) {
+	int mid = lo + (hi - lo) / 2;
+	if (lz->neigh_ids[mid] < id) lo = mid + 1; else hi = mid;
+    }
+    return lo < lz->plan.job_count && lz->neigh_ids[lo] == id ? lo : -1;
+}
+
+/* The mesh of an expanded world stays inside each neighbourhood, drawn
+ * from that neighbourhood's own key so expansion order does not matter.
+ * Routers of a building share its subnet and come out contiguous. */
+static void link_local_mesh(const GenLazy* lz, GameState* g, int j, ServerId first) {
+    const GeneratorParams* p = &lz->plan.params;
+    if (p->inter_router_link_density <= 0.0 && p->intra_subnet_link_density <= 0.0) return;
+    int total = g->servers.count;
+    const uint8_t* types = g->servers.type;
+    const int32_t* subnets = g->servers.subnet_id;
+
+    int m = 0;
+    for (ServerId a = first; a < total; a++) {
+	if (types[a] == SERVER_TYPE_ROUTER || types[a] == SERVER_TYPE_RACK) m++;
+    }
+    if (m < 2) return;
+    ServerId* ids = malloc((size_t)m * sizeof(*ids));
+    int* bucket_end = malloc((size_t)m * sizeof(*bucket_end));
+    if (ids && bucket_end) {
+	m = 0;
+	for (ServerId a = first; a < total; a++) {
+	    if (types[a] == SERVER_TYPE_ROUTER || types[a] == SERVER_TYPE_RACK) ids[m++] = a;
+	}
+	for (int i = m - 1; i >= 0; i--) {
+	    int same = i + 1 < m && subnets[ids[i]] >= 0 && subnets[ids[i]] == subnets[ids[i + 1]];
+	    bucket_end[i] = same ? bucket_end[i + 1] : i + 1;
+	}
+	gen_mesh_passes(&g->links, ids, bucket_end, m, p, rng_key(lz->mesh_key, (uint64_t)j));
+    }
+    free(ids);
+    free(bucket_end);
+}
+
+int generator_lazy_mark_expanded(GenLazy* lz, ServerId id) {
+    int j = lz ? find_job(lz, id) : -1;
+    if (j >= 0) lz->expanded[j] = 1;
+    return j;
+}
+
+int generator_lazy_expand(GenLazy* lz, GameState* g, ServerId id) {
+    if (!lz || !g) return -1;
+    int j = find_job(lz, id);
+    if (j < 0 || lz->expanded[j]) return 0;
+
+    /* built into a private block like an eager job, so a failure leaves
+     * the world as it was and the neighbourhood can be tried again */
+    const NeighJob* job = &lz->plan.jobs[j];
+    ServerId first = g->servers.count;
+    ServerStore servers;
+    LinkGraph links;
+    server_store_init(&servers);
+    link_graph_init(&links);
+    /* users are named after the ids they have in the eagerly built world */
+    GenBlock out = { &servers, &links, first, job->base + 1 - first, lz->plan.params.compact_names };
+    int added = gen_neigh_children(&lz->plan.params, job, id, &out);
+    size_t staged = g->links.staged_count;
+    if (added >= 0 && link_graph_append_staged(&g->links, &links) != CORE_OK) added = -1;
+    if (added >= 0 && server_store_append(&g->servers, &servers) != CORE_OK) {
+	g->links.staged_count = staged;
+	added = -1;
+    }
+    server_store_free(&servers);
+    link_graph_free(&links);
+    if (added < 0) return -1;
+
+    lz->expanded[j] = 1;
+    link_local_mesh(lz, g, j, first);
+    link_graph_freeze(&g->links, g->servers.count);
+    return added;
+}
+
+GenLazy* generator_lazy_resume(const GenLazyState* state, const ServerStore* st) {
+    if (!state || !st || state->expanded_count < 0) return NULL;
+    if (!generator_params_valid(&state->params, st->count)) return NULL;
+    GenLazy* lz = lazy_plan(&state->params, state->seed, state->first_isp);
+    if (!lz) return NULL;
+    GenPlan* plan = &lz->plan;
+
+    /* hand out ids in the order generator_generate_lazy() added servers,
+     * checking each against what the save holds */
+    int ok = plan->first_isp >= 0 && plan->first_isp <= st->count - plan->isp_count;
+    ServerId next = ok ? plan->first_isp + plan->isp_count : 0;
+    for (int i = 0; i < plan->isp_count && ok; i++) {
+	ok = server_type(st, plan->first_isp + i) == SERVER_TYPE_ISP;
+    }
+    for (int i = 0; i < plan->area_count && ok; i++) {
+	const AreaPlan* ap = &plan->areas[i];
+	ServerId aid = next++;
+	ok = server_valid(st, aid) && server_type(st, aid) == SERVER_TYPE_AREA;
+	for (int j = ap->first_job; j < ap->first_job + ap->job_count && ok; j++) {
+	    plan->jobs[j].area_id = aid;
+	    lz->neigh_ids[j] = next++;
+	    ok = server_valid(st, lz->neigh_ids[j]) &&
+	         server_type(st, lz->neigh_ids[j]) == SERVER_TYPE_NEIGHBORHOOD;
+	}
+    }
+    for (int i = 0; i < state->expanded_count && ok; i++) {
+	int j = generator_lazy_mark_expanded(lz, state->expanded[i]);
+	ok = j >= 0;
+    }
+    if (!ok) {
+	generator_lazy_free(lz);
+	return NULL;
+    }
+    return lz;
+}
+
+bool generator_lazy_save_state(const GenLazy* lz, GenLazyState* out) {
+    if (!out) return false;
+    memset(out, 0, sizeof(*out));
+    out->expanded_count = -1;
+    if (!lz) return true;
+    int n = 0;
+    for (int j = 0; j < lz->plan.job_count; j++) n += lz->expanded[j];
+    out->expanded = malloc(((size_t)n + 1) * sizeof(*out->expanded));
+    if (!out->expanded) return false;
+    out->expanded_count = 0;
+    for (int j = 0; j < lz->plan.job_count; j++) {
+	if (lz->expanded[j]) out->expanded[out->expanded_count++] = lz->neigh_ids[j];
+    }
+    out->params = lz->plan.params;
+    out->seed = lz->seed;
+    out->first_isp = lz->plan.first_isp;
+    return true;
+}
+
+void generator_lazy_state_free(GenLazyState* state) {
+    if (!state) return;
+    free(state->expanded);
+    state->expanded = NULL;
+    state->expanded_count = -1;
+}
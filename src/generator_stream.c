@@ -0,0 +1,318 @@
+/* generator_stream.c - generate a world straight into a sink, server by server */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "generator.h"
+#include "generator_internal.h"
+#include "save_json.h"
+
+/* Neighbourhood blocks built per worker thread before they are emitted. */
+#define STREAM_JOBS_PER_THREAD 4
+
+/* One direction of a mesh link. Sorted by (owner, kind, other) this is
+ * the order the in-memory generator's CSR ends up listing them in. */
+typedef struct {
+    ServerId owner;
+    int kind;
+    ServerId other;
+} MeshEntry;
+
+/* A cross-subnet link whose far end is only known by router index. */
+typedef struct {
+    ServerId from;
+    int index;
+} MeshPending;
+
+typedef struct {
+    PairSampler intra;
+    PairSampler inter;
+    int routers;   /* total routers in the world */
+    int index;     /* index of the first router of the current building */
+
+    MeshEntry* entries;
+    size_t count;
+    size_t cap;
+    MeshPending* pending;
+    size_t pending_count;
+    size_t pending_cap;
+    size_t cursor;
+    int failed;
+} MeshList;
+
+static void mesh_add(MeshList* ml, ServerId a, ServerId b, int kind) {
+    if (ml->failed) return;
+    if (ml->count + 2 > ml->cap) {
+	size_t cap = ml->cap ? ml->cap * 2 : 256;
+	MeshEntry* grown = realloc(ml->entries, cap * sizeof(*grown));
+	if (!grown) {
+	    ml->failed = 1;
+	    return;
+	}
+	ml->entries = grown;
+	ml->cap = cap;
+    }
+    ml->entries[ml->count++] = (MeshEntry){ a, kind, b };
+    ml->entries[ml->count++] = (MeshEntry){ b, kind, a };
+}
+
+static void count_routers(void* ctx, const ServerId* routers, int count) {
+    (void)routers;
+    ((MeshList*)ctx)->routers += count;
+}
+
+/* Same rows as link_mesh() in generator.c, one building at a time. */
+static void sample_routers(void* ctx, const ServerId* routers, int count) {
+    MeshList* ml = ctx;
+    int end = ml->index + count;
+    for (int t = 0; t < count; t++) {
+	int i = ml->index + t;
+	int lo = i + 1, j;
+	while ((j = pair_sampler_next(&ml->intra, &lo, end)) >= 0) {
+	    mesh_add(ml, routers[t], routers[j - ml->index], MESH_INTRA);
+	}
+	lo = end;
+	while ((j = pair_sampler_next(&ml->inter, &lo, ml->routers)) >= 0) {
+	    if (ml->pending_count == ml->pending_cap) {
+		size_t cap = ml->pending_cap ? ml->pending_cap * 2 : 256;
+		MeshPending* grown = realloc(ml->pending, cap * sizeof(*grown));
+		if (!grown) {
+		    ml->failed = 1;
+		    return;
+		}
+		ml->pending = grown;
+		ml->pending_cap = cap;
+	    }
+	    ml->pending[ml->pending_count++] = (MeshPending){ routers[t], j };
+	}
+    }
+    ml->index = end;
+}
+
+/* Turns pending router indices into ids once their building is reached. */
+static void resolve_routers(void* ctx, const ServerId* routers, int count) {
+    MeshList* ml = ctx;
+    int end = ml->index + count;
+    while (ml->cursor < ml->pending_count && ml->pending[ml->cursor].index < end) {
+	const MeshPending* mp = &ml->pending[ml->cursor++];
+	mesh_add(ml, mp->from, routers[mp->index - ml->index], MESH_INTER);
+    }
+    ml->index = end;
+}
+
+static int cmp_pending(const void* a, const void* b) {
+    const MeshPending* x = a;
+    const MeshPending* y = b;
+    if (x->index != y->index) return x->index < y->index ? -1 : 1;
+    return (x->from > y->from) - (x->from < y->from);
+}
+
+static int cmp_entry(const void* a, const void* b) {
+    const MeshEntry* x = a;
+    const MeshEntry* y = b;
+    if (x->owner != y->owner) return x->owner < y->owner ? -1 : 1;
+    if (x->kind != y->kind) return x->kind < y->kind ? -1 : 1;
+    return (x->other > y->other) - (x->other < y->other);
+}
+
+static void mesh_free(MeshList* ml) {
+    free(ml->entries);
+    free(ml->pending);
+    memset(ml, 0, sizeof(*ml));
+}
+
+/* Collects every mesh link of the planned world without building it:
+ * count the routers, sample both passes row by row, then resolve the far
+ * ends of cross-subnet links in a second walk. */
+static int mesh_collect(MeshList* ml, const GenPlan* plan) {
+    memset(ml, 0, sizeof(*ml));
+    const GeneratorParams* p = &plan->params;
+    if (p->inter_router_link_density <= 0.0 && p->intra_subnet_link_density <= 0.0) return 0;
+
+    if (gen_walk_routers(plan, count_routers, ml) != 0) return -1;
+    if (ml->routers < 2) return 0;
+
+    uint64_t key = rng_key(plan->world, WORLD_MESH);
+    pair_sampler_init(&ml->intra, rng_key(key, MESH_INTRA), p->intra_subnet_link_density);
+    pair_sampler_init(&ml->inter, rng_key(key, MESH_INTER), p->inter_router_link_density);
+    if (gen_walk_routers(plan, sample_routers, ml) != 0 || ml->failed) return -1;
+
+    qsort(ml->pending, ml->pending_count, sizeof(*ml->pending), cmp_pending);
+    ml->index = 0;
+    ml->cursor = 0;
+    if (gen_walk_routers(plan, resolve_routers, ml) != 0 || ml->failed) return -1;
+
+    qsort(ml->entries, ml->count, sizeof(*ml->entries), cmp_entry);
+    ml->cursor = 0;
+    return 0;
+}
+
+typedef struct {
+    ServerId* ids;
+    int count;
+    int cap;
+} LinkBuf;
+
+static int link_push(LinkBuf* lb, ServerId id) {
+    if (lb->count == lb->cap) {
+	int cap = lb->cap ? lb->cap * 2 : 64;
+	ServerId* grown = realloc(lb->ids, (size_t)cap * sizeof(*grown));
+	if (!grown) return 0;
+	lb->ids = grown;
+	lb->cap = cap;
+    }
+    lb->ids[lb->count++] = id;
+    return 1;
+}
+
+/* Appends the mesh links of `id`; entries are consumed in id order. */
+static int push_mesh(LinkBuf* lb, MeshList* ml, ServerId id) {
+    while (ml->cursor < ml->count && ml->entries[ml->cursor].owner < id) ml->cursor++;
+    while (ml->cursor < ml->count && ml->entries[ml->cursor].owner == id) {
+	if (!link_push(lb, ml->entries[ml->cursor++].other)) return 0;
+    }
+    return 1;
+}
+
+/* Emits every server of a built neighbourhood. A server's links are its
+ * staged links in staging order (what a freeze would keep), then mesh. */
+static bool emit_block(const GenSink* sink, NeighJob* job, MeshList* ml, LinkBuf* lb) {
+    if (!job->ok) return false;
+    int n = job->servers.count;
+    const LinkEdge* edges = job->links.staged;
+    size_t edge_count = job->links.staged_count;
+
+    uint32_t* off = calloc((size_t)n + 1, sizeof(*off));
+    ServerId* adj = malloc((edge_count ? edge_count : 1) * sizeof(*adj));
+    bool ok = off && adj;
+    if (ok) {
+	for (size_t e = 0; e < edge_count; e++) {
+	    ServerId from = edges[e].from - job->base;
+	    if (from >= 0 && from < n) off[from + 1]++;
+	}
+	for (int k = 0; k < n; k++) off[k + 1] += off[k];
+	uint32_t* fill = malloc(((size_t)n + 1) * sizeof(*fill));
+	ok = fill != NULL;
+	if (ok) {
+	    memcpy(fill, off, ((size_t)n + 1) * sizeof(*fill));
+	    for (size_t e = 0; e < edge_count; e++) {
+		ServerId from = edges[e].from - job->base;
+		if (from >= 0 && from < n) adj[fill[from]++] = edges[e].to;
+	    }
+	    free(fill);
+	}
+    }
+    for (int k = 0; k < n && ok; k++) {
+	lb->count = 0;
+	for (uint32_t e = off[k]; e < off[k + 1] && ok; e++) ok = link_push(lb, adj[e]);
+	ok = ok && push_mesh(lb, ml, job->base + k);
+	ok = ok && sink->server(sink->ctx, job->base + k, &job->servers, k, lb->ids, lb->count);
+    }
+    free(off);
+    free(adj);
+    return ok;
+}
+
+/* Emits the single server `out` holds (home, an ISP or an area). */
+static bool emit_one(const GenSink* sink, ServerId id, ServerStore* out, const LinkBuf* lb) {
+    bool ok = out->count == 1 && sink->server(sink->ctx, id, out, 0, lb->ids, lb->count);
+    server_store_free(out);
+    return ok;
+}
+
+bool generator_stream(const GeneratorParams* params, unsigned int seed, const GenSink* sink) {
+    if (!sink || !sink->server) return false;
+
+    /* id 0 is the home server game_init() creates */
+    GenPlan plan;
+    if (gen_plan(&plan, params, seed, 1) != CORE_OK) return false;
+    MeshList mesh;
+    LinkBuf lb = { 0 };
+    ServerStore one;
+    server_store_init(&one);
+
+    bool ok = mesh_collect(&mesh, &plan) == 0;
+    ok = ok && (!sink->begin || sink->begin(sink->ctx, plan.end_id, 0));
+
+    if (ok) {
+	ok = server_store_add(&one, "home") == 0 && emit_one(sink, 0, &one, &lb);
+    }
+    for (int i = 0; i < plan.isp_count && ok; i++) {
+	lb.count = 0;
+	for (int a = 0; a < plan.area_count && ok; a++) {
+	    if (plan.areas[a].isp == i) ok = link_push(&lb, plan.areas[a].id);
+	}
+	ok = ok && gen_isp(&plan, i, &one) == 0 && emit_one(sink, plan.first_isp + i, &one, &lb);
+    }
+
+    int threads = gen_thread_count(&plan.params);
+    int batch = threads * STREAM_JOBS_PER_THREAD;
+    int built_end = 0;
+    for (int a = 0; a < plan.area_count && ok; a++) {
+	const AreaPlan* ap = &plan.areas[a];
+	lb.count = 0;
+	ok = link_push(&lb, plan.first_isp + ap->isp);
+	for (int j = ap->first_job; j < ap->first_job + ap->job_count && ok; j++) {
+	    ok = link_push(&lb, plan.jobs[j].base);
+	}
+	ok = ok && gen_area(&plan, ap, &one) == 0 && emit_one(sink, ap->id, &one, &lb);
+
+	for (int j = ap->first_job; j < ap->first_job + ap->job_count && ok; j++) {
+	    if (j >= built_end) {
+		int n = plan.job_count - j < batch ? plan.job_count - j : batch;
+		gen_run_jobs(&plan.params, &plan.jobs[j], n, threads);
+		built_end = j + n;
+	    }
+	    ok = emit_block(sink, &plan.jobs[j], &mesh, &lb);
+	    gen_job_release(&plan.jobs[j]);
+	}
+    }
+    ok = ok && (!sink->end || sink->end(sink->ctx));
+
+    server_store_free(&one);
+    free(lb.ids);
+    mesh_free(&mesh);
+    gen_plan_free(&plan);
+    return ok;
+}
+
+/* ---------------- JSON SAVE SINK ---------------- */
+
+static bool json_begin(void* ctx, int server_count, ServerId home_server) {
+    JsonWriter* w = ctx;
+    save_json_begin(w, server_count, home_server, home_server);
+    return !w->failed;
+}
+
+static bool json_server(void* ctx, ServerId id, const ServerStore* st, ServerId local,
+                        const ServerId* links, int link_count) {
+    JsonWriter* w = ctx;
+    save_json_server(w, id, st, local, links, link_count);
+    return !w->failed;
+}
+
+static bool json_end(void* ctx) {
+    return save_json_end(ctx, NULL) != 0;
+}
+
+bool generator_write_save(const GeneratorParams* params, unsigned int seed, const char* filename) {
+    if (!filename) return false;
+
+    char tmpfile[512];
+    snprintf(tmpfile, sizeof(tmpfile), "%s.tmp", filename);
+    FILE* f = fopen(tmpfile, "w");
+    if (!f) return false;
+    setvbuf(f, NULL, _IOFBF, 1 << 20);
+
+    JsonWriter w;
+    json_writer_init(&w, f);
+    GenSink sink = { &w, json_begin, json_server, json_end };
+    bool ok = generator_stream(params, seed, &sink);
+    if (fclose(f) != 0) ok = false;
+
+    if (!ok || rename(tmpfile, filename) != 0) {
+	remove(tmpfile);
+	return false;
+    }
+    return true;
+}
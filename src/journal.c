@@ -0,0 +1,458 @@
+/* journal.c - append-only change log with background snapshot compaction */
+#include "journal.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bgsave.h"
+#include "generator.h"
+
+#define JOURNAL_MAGIC "HTJRNL1" /* 8 bytes with the NUL */
+#define JOURNAL_VERSION 2
+#define JOURNAL_HEADER_SIZE 12  /* magic + version */
+#define JOURNAL_RECORD_MAX 512
+
+/* Record layout: u16 payload length, u8 kind, payload, u32 checksum of
+ * everything before it. All integers little-endian. */
+enum {
+    REC_CURRENT = 1, /* i32 id */
+    REC_MONEY,       /* i32 id, i32 money */
+    REC_LINK,        /* i32 from, i32 to */
+    REC_SERVER,      /* i32 id, u8 type, i32 security, money, subnet, str name,
+                        u8 services, then per service i32 port, i32 vuln, str name */
+    REC_EXPAND       /* i32 neighbourhood id; since version 2 */
+};
+
+struct Journal {
+    char* filename;
+    char* live_path; /* F.journal */
+    char* old_path;  /* F.journal.1, being folded into a snapshot */
+    FILE* f;
+    size_t size;
+    size_t compact_bytes;
+    BgSave* compaction; /* snapshot being written, or NULL */
+};
+
+/* FNV-1a; catches torn and garbled records, nothing more. */
+static uint32_t checksum(const unsigned char* p, size_t n) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < n; i++) {
+	h ^= p[i];
+	h *= 16777619u;
+    }
+    return h;
+}
+
+static char* path_with(const char* base, const char* suffix) {
+    size_t n = strlen(base), m = strlen(suffix);
+    char* p = malloc(n + m + 1);
+    if (!p) return NULL;
+    memcpy(p, base, n);
+    memcpy(p + n, suffix, m + 1);
+    return p;
+}
+
+static int file_exists(const char* path) {
+    return access(path, F_OK) == 0;
+}
+
+/* ---------------- ENCODING ---------------- */
+
+typedef struct {
+    unsigned char buf[JOURNAL_RECORD_MAX];
+    size_t len;
+} Record;
+
+static void put_u8(Record* r, unsigned v) {
+    if (r->len < sizeof(r->buf)) r->buf[r->len++] = (unsigned char)v;
+}
+
+static void put_i32(Record* r, int32_t v) {
+    uint32_t u = (uint32_t)v;
+    for (int i = 0; i < 4; i++) put_u8(r, (u >> (8 * i)) & 0xff);
+}
+
+static void put_str(Record* r, const char* s) {
+    size_t n = s ? strlen(s) : 0;
+    if (n > 255) n = 255;
+    put_u8(r, (unsigned)n);
+    for (size_t i = 0; i < n; i++) put_u8(r, (unsigned char)s[i]);
+}
+
+static void begin_record(Record* r, int kind) {
+    r->len = 3; /* length filled in by append_record() */
+    r->buf[2] = (unsigned char)kind;
+}
+
+static void append_record(Journal* j, Record* r) {
+    if (!j->f) return;
+    size_t payload = r->len - 3;
+    r->buf[0] = payload & 0xff;
+    r->buf[1] = (payload >> 8) & 0xff;
+    uint32_t sum = checksum(r->buf, r->len);
+    unsigned char tail[4] = { sum & 0xff, (sum >> 8) & 0xff, (sum >> 16) & 0xff, sum >> 24 };
+    /* flushed per record: a crash loses at most the record being written */
+    if (fwrite(r->buf, 1, r->len, j->f) == r->len && fwrite(tail, 1, 4, j->f) == 4) {
+	j->size += r->len + 4;
+    }
+    fflush(j->f);
+}
+
+void journal_record_current(Journal* j, ServerId id) {
+    if (!j) return;
+    Record r;
+    begin_record(&r, REC_CURRENT);
+    put_i32(&r, id);
+    append_record(j, &r);
+}
+
+void journal_record_money(Journal* j, ServerId id, int money) {
+    if (!j) return;
+    Record r;
+    begin_record(&r, REC_MONEY);
+    put_i32(&r, id);
+    put_i32(&r, money);
+    append_record(j, &r);
+}
+
+void journal_record_link(Journal* j, ServerId from, ServerId to) {
+    if (!j) return;
+    Record r;
+    begin_record(&r, REC_LINK);
+    put_i32(&r, from);
+    put_i32(&r, to);
+    append_record(j, &r);
+}
+
+void journal_record_expand(Journal* j, ServerId id) {
+    if (!j) return;
+    Record r;
+    begin_record(&r, REC_EXPAND);
+    put_i32(&r, id);
+    append_record(j, &r);
+}
+
+void journal_record_server(Journal* j, const ServerStore* st, ServerId id) {
+    if (!j || !server_valid(st, id)) return;
+    Record r;
+    begin_record(&r, REC_SERVER);
+    put_i32(&r, id);
+    put_u8(&r, (unsigned)server_type(st, id));
+    put_i32(&r, server_security(st, id));
+    put_i32(&r, server_money(st, id));
+    put_i32(&r, server_subnet(st, id));
+    put_str(&r, server_name(st, id));
+    int n = 0;
+    const Service* svcs = server_services(st, id, &n);
+    put_u8(&r, (unsigned)n);
+    for (int i = 0; i < n; i++) {
+	put_i32(&r, svcs[i].port);
+	put_i32(&r, svcs[i].vuln_level);
+	put_str(&r, svcs[i].name);
+    }
+    append_record(j, &r);
+}
+
+/* ---------------- READING ---------------- */
+
+typedef struct {
+    FILE* f;
+    long valid_end; /* file offset just past the last good record */
+} LogReader;
+
+static int open_log_reader(LogReader* lr, const char* path) {
+    lr->f = fopen(path, "rb");
+    lr->valid_end = 0;
+    if (!lr->f) return 0;
+    unsigned char hdr[JOURNAL_HEADER_SIZE];
+    if (fread(hdr, 1, sizeof(hdr), lr->f) != sizeof(hdr) || memcmp(hdr, JOURNAL_MAGIC, 8) != 0 ||
+        hdr[8] == 0 || hdr[8] > JOURNAL_VERSION) {
+	fclose(lr->f);
+	lr->f = NULL;
+	return 0;
+    }
+    lr->valid_end = JOURNAL_HEADER_SIZE;
+    return 1;
+}
+
+/* Next intact record into `r` (length prefix and kind included, checksum
+ * not); 0 at the end of the log or at a damaged record. */
+static int next_log_record(LogReader* lr, Record* r) {
+    if (fread(r->buf, 1, 3, lr->f) != 3) return 0;
+    size_t payload = (size_t)r->buf[0] | ((size_t)r->buf[1] << 8);
+    if (payload + 3 > sizeof(r->buf)) return 0;
+    unsigned char tail[4];
+    if (fread(r->buf + 3, 1, payload, lr->f) != payload || fread(tail, 1, 4, lr->f) != 4) return 0;
+    r->len = payload + 3;
+    uint32_t sum = (uint32_t)tail[0] | ((uint32_t)tail[1] << 8) | ((uint32_t)tail[2] << 16) |
+                   ((uint32_t)tail[3] << 24);
+    if (sum != checksum(r->buf, r->len)) return 0;
+    lr->valid_end += (long)(r->len + 4);
+    return 1;
+}
+
+/* Payload cursor */
+typedef struct {
+    const unsigned char* p;
+    size_t left;
+    int bad;
+} Cursor;
+
+static unsigned get_u8(Cursor* c) {
+    if (c->left < 1) {
+	c->bad = 1;
+	return 0;
+    }
+    c->left--;
+    return *c->p++;
+}
+
+static int32_t get_i32(Cursor* c) {
+    uint32_t u = 0;
+    for (int i = 0; i < 4; i++) u |= (uint32_t)get_u8(c) << (8 * i);
+    return (int32_t)u;
+}
+
+static void get_str(Cursor* c, char* out, size_t size) {
+    size_t n = get_u8(c), k = 0;
+    for (size_t i = 0; i < n; i++) {
+	unsigned ch = get_u8(c);
+	if (k + 1 < size) out[k++] = (char)ch;
+    }
+    out[k] = '\0';
+}
+
+static int apply_record(GameState* g, const Record* r) {
+    Cursor c = { r->buf + 3, r->len - 3, 0 };
+    ServerStore* st = &g->servers;
+    switch (r->buf[2]) {
+	case REC_CURRENT: {
+	    ServerId id = get_i32(&c);
+	    if (!c.bad && server_valid(st, id)) g->current_server = id;
+	    break;
+	}
+	case REC_MONEY: {
+	    ServerId id = get_i32(&c);
+	    int money = get_i32(&c);
+	    if (!c.bad && server_valid(st, id)) server_set_money(st, id, money);
+	    break;
+	}
+	case REC_LINK: {
+	    ServerId from = get_i32(&c);
+	    ServerId to = get_i32(&c);
+	    if (!c.bad) link_graph_add(&g->links, from, to);
+	    break;
+	}
+	case REC_EXPAND: {
+	    /* the servers follow as REC_SERVER records */
+	    ServerId id = get_i32(&c);
+	    if (!c.bad) generator_lazy_mark_expanded(g->lazy, id);
+	    break;
+	}
+	case REC_SERVER: {
+	    char name[SERVER_NAME_LEN];
+	    ServerId id = get_i32(&c);
+	    ServerType type = (ServerType)get_u8(&c);
+	    int security = get_i32(&c);
+	    int money = get_i32(&c);
+	    int subnet = get_i32(&c);
+	    get_str(&c, name, sizeof(name));
+	    if (c.bad || id > st->count) return 0;
+	    int fresh = id == st->count; /* else already in the snapshot */
+	    if (fresh) {
+		if (server_store_add(st, name) != id) return 0;
+		server_set_type(st, id, type);
+		server_set_security(st, id, security);
+		server_set_money(st, id, money);
+		server_set_subnet(st, id, subnet);
+	    }
+	    unsigned n = get_u8(&c);
+	    for (unsigned i = 0; i < n && !c.bad; i++) {
+		char svc[SERVICE_NAME_LEN];
+		int port = get_i32(&c);
+		int vuln = get_i32(&c);
+		get_str(&c, svc, sizeof(svc));
+		if (fresh && !c.bad) server_add_service(st, id, port, svc, vuln);
+	    }
+	    break;
+	}
+	default:
+	    return 0;
+    }
+    return !c.bad;
+}
+
+/* Replays one log; 1 if it was missing or read to its end. */
+static int replay_log(GameState* g, const char* path) {
+    if (!file_exists(path)) return 1;
+    LogReader lr;
+    if (!open_log_reader(&lr, path)) return 0;
+    Record r;
+    int ok = 1;
+    while (next_log_record(&lr, &r)) {
+	if (!apply_record(g, &r)) {
+	    ok = 0;
+	    break;
+	}
+    }
+    if (ok && fgetc(lr.f) != EOF) ok = 0; /* stopped at a damaged record */
+    fclose(lr.f);
+    return ok;
+}
+
+bool journal_replay(GameState* g, const char* filename) {
+    if (!g || !filename) return false;
+    char* live = path_with(filename, JOURNAL_EXT);
+    char* old = path_with(filename, JOURNAL_EXT ".1");
+    if (!live || !old) {
+	free(live);
+	free(old);
+	return false;
+    }
+    int ok = replay_log(g, old);
+    ok = replay_log(g, live) && ok;
+    free(live);
+    free(old);
+    if (!link_graph_is_frozen(&g->links)) link_graph_freeze(&g->links, g->servers.count);
+    return ok;
+}
+
+void journal_discard(const char* filename) {
+    if (!filename) return;
+    char* live = path_with(filename, JOURNAL_EXT);
+    char* old = path_with(filename, JOURNAL_EXT ".1");
+    if (live) remove(live);
+    if (old) remove(old);
+    free(live);
+    free(old);
+}
+
+/* ---------------- COMPACTION ---------------- */
+
+static FILE* create_log(const char* path) {
+    FILE* f = fopen(path, "wb");
+    if (!f) return NULL;
+    unsigned char hdr[JOURNAL_HEADER_SIZE] = { 0 };
+    memcpy(hdr, JOURNAL_MAGIC, 8);
+    hdr[8] = JOURNAL_VERSION;
+    if (fwrite(hdr, 1, sizeof(hdr), f) != sizeof(hdr) || fflush(f) != 0) {
+	fclose(f);
+	remove(path);
+	return NULL;
+    }
+    return f;
+}
+
+/* Appends the intact records of `src` to `dst`, first cutting a torn tail
+ * off `dst` so the new records stay reachable. */
+static int fold_log(const char* dst, const char* src) {
+    LogReader in, out;
+    Record r;
+    if (!open_log_reader(&out, dst)) {
+	FILE* f = create_log(dst);
+	if (!f) return 0;
+	fclose(f);
+	out.valid_end = JOURNAL_HEADER_SIZE;
+    } else {
+	while (next_log_record(&out, &r)) {}
+	fclose(out.f);
+    }
+    if (truncate(dst, out.valid_end) != 0) return 0;
+    if (!open_log_reader(&in, src)) return 1; /* nothing readable to keep */
+
+    FILE* f = fopen(dst, "ab");
+    int ok = f != NULL;
+    while (ok && next_log_record(&in, &r)) {
+	uint32_t sum = checksum(r.buf, r.len);
+	unsigned char tail[4] = { sum & 0xff, (sum >> 8) & 0xff, (sum >> 16) & 0xff, sum >> 24 };
+	ok = fwrite(r.buf, 1, r.len, f) == r.len && fwrite(tail, 1, 4, f) == 4;
+    }
+    fclose(in.f);
+    if (f && fclose(f) != 0) ok = 0;
+    return ok;
+}
+
+/* Sets the live log aside (folding it into one a failed compaction left),
+ * starts a new one and forks a child to snapshot the world. */
+static void start_compaction(Journal* j, const GameState* g) {
+    if (j->compaction) return;
+    if (j->f) {
+	fclose(j->f);
+	j->f = NULL;
+    }
+    if (file_exists(j->live_path)) {
+	int moved = file_exists(j->old_path) ? fold_log(j->old_path, j->live_path) && remove(j->live_path) == 0
+	                                     : rename(j->live_path, j->old_path) == 0;
+	if (!moved) {
+	    /* keep logging where we were; a later poll tries again */
+	    j->f = fopen(j->live_path, "ab");
+	    return;
+	}
+    }
+    j->f = create_log(j->live_path);
+    j->size = JOURNAL_HEADER_SIZE;
+    /* the child sees the world as of the switch */
+    j->compaction = bgsave_start(g, j->filename);
+}
+
+/* Collects the child; on success the set-aside log is no longer needed. */
+static void reap_compaction(Journal* j, int block) {
+    if (!j->compaction) return;
+    BgSaveStatus st = block ? bgsave_wait(j->compaction) : bgsave_poll(j->compaction);
+    if (st == BGSAVE_RUNNING) return;
+    if (st == BGSAVE_DONE) remove(j->old_path);
+    bgsave_free(j->compaction);
+    j->compaction = NULL;
+}
+
+Journal* journal_open(const GameState* g, const char* filename, size_t compact_bytes) {
+    if (!g || !filename) return NULL;
+    Journal* j = calloc(1, sizeof(*j));
+    if (!j) return NULL;
+    j->filename = path_with(filename, "");
+    j->live_path = path_with(filename, JOURNAL_EXT);
+    j->old_path = path_with(filename, JOURNAL_EXT ".1");
+    j->compact_bytes = compact_bytes ? compact_bytes : JOURNAL_COMPACT_BYTES;
+    if (j->filename && j->live_path && j->old_path) start_compaction(j, g);
+    if (!j->f) {
+	journal_close(j);
+	return NULL;
+    }
+    return j;
+}
+
+void journal_close(Journal* j) {
+    if (!j) return;
+    if (j->f) fclose(j->f);
+    reap_compaction(j, 1);
+    free(j->filename);
+    free(j->live_path);
+    free(j->old_path);
+    free(j);
+}
+
+const char* journal_filename(const Journal* j) {
+    return j ? j->filename : NULL;
+}
+
+bool journal_compacting(const Journal* j) {
+    return j && j->compaction != NULL;
+}
+
+size_t journal_size(const Journal* j) {
+    return j ? j->size : 0;
+}
+
+bool journal_sync(Journal* j) {
+    if (!j || !j->f) return false;
+    return fflush(j->f) == 0 && !ferror(j->f) && fsync(fileno(j->f)) == 0;
+}
+
+void journal_poll(Journal* j, const GameState* g) {
+    if (!j) return;
+    reap_compaction(j, 0);
+    if (!j->compaction && j->size >= j->compact_bytes) start_compaction(j, g);
+}
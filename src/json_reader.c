@@ -0,0 +1,258 @@
+#include "json_reader.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Refills the buffer once it is used up; returns 0 at end of file. */
+static int fill(JsonReader* r) {
+    if (r->pos < r->len) return 1;
+    if (r->failed) return 0;
+    r->pos = 0;
+    r->len = fread(r->buf, 1, sizeof(r->buf), r->f);
+    if (r->len == 0 && ferror(r->f)) r->failed = 1;
+    return r->len > 0;
+}
+
+/* Next byte without consuming it, or -1 at end of input. */
+static int peek_byte(JsonReader* r) {
+    return fill(r) ? (unsigned char)r->buf[r->pos] : -1;
+}
+
+static int get_byte(JsonReader* r) {
+    return fill(r) ? (unsigned char)r->buf[r->pos++] : -1;
+}
+
+static int fail(JsonReader* r) {
+    r->failed = 1;
+    return 0;
+}
+
+static void skip_ws(JsonReader* r) {
+    for (;;) {
+	if (!fill(r)) return;
+	while (r->pos < r->len && (unsigned char)r->buf[r->pos] <= ' ') r->pos++;
+	if (r->pos < r->len) return;
+    }
+}
+
+/* Consumes `c` after optional whitespace. */
+static int expect(JsonReader* r, int c) {
+    skip_ws(r);
+    if (get_byte(r) != c) return fail(r);
+    return 1;
+}
+
+void json_reader_init(JsonReader* r, FILE* f) {
+    if (!r) return;
+    r->f = f;
+    r->pos = 0;
+    r->len = 0;
+    r->depth = 0;
+    r->failed = f == NULL;
+    if (fill(r) && r->len >= 3 && memcmp(r->buf, "\xEF\xBB\xBF", 3) == 0) r->pos = 3;
+}
+
+JsonValueType json_peek(JsonReader* r) {
+    if (!r || r->failed) return JSON_VALUE_INVALID;
+    skip_ws(r);
+    int c = peek_byte(r);
+    switch (c) {
+	case '{': return JSON_VALUE_OBJECT;
+	case '[': return JSON_VALUE_ARRAY;
+	case '"': return JSON_VALUE_STRING;
+	case 't':
+	case 'f': return JSON_VALUE_BOOL;
+	case 'n': return JSON_VALUE_NULL;
+	default:
+	    return c == '-' || (c >= '0' && c <= '9') ? JSON_VALUE_NUMBER : JSON_VALUE_INVALID;
+    }
+}
+
+static int open_container(JsonReader* r, int c) {
+    if (!r || r->failed) return 0;
+    if (r->depth == JSON_READER_MAX_DEPTH || !expect(r, c)) return fail(r);
+    r->has_items[r->depth++] = 0;
+    return 1;
+}
+
+/* Shared by keys and elements: 0 if `close` ends the container, else 1
+ * once the separator before the next item is consumed. */
+static int next_item(JsonReader* r, int close) {
+    if (!r || r->failed || r->depth == 0) return r ? fail(r) : 0;
+    skip_ws(r);
+    if (peek_byte(r) == close) {
+	r->pos++;
+	r->depth--;
+	return 0;
+    }
+    if (r->has_items[r->depth - 1] && !expect(r, ',')) return 0;
+    r->has_items[r->depth - 1] = 1;
+    return 1;
+}
+
+int json_read_object(JsonReader* r) {
+    return open_container(r, '{');
+}
+
+int json_read_array(JsonReader* r) {
+    return open_container(r, '[');
+}
+
+int json_read_next(JsonReader* r) {
+    return next_item(r, ']');
+}
+
+int json_read_key(JsonReader* r, char* key, size_t size) {
+    if (!next_item(r, '}')) return 0;
+    if (!json_read_string(r, key, size)) return 0;
+    return expect(r, ':');
+}
+
+static int hex4(JsonReader* r, unsigned* out) {
+    unsigned v = 0;
+    for (int i = 0; i < 4; i++) {
+	int c = get_byte(r);
+	if (c >= '0' && c <= '9') v = v * 16 + (unsigned)(c - '0');
+	else if (c >= 'a' && c <= 'f') v = v * 16 + (unsigned)(c - 'a' + 10);
+	else if (c >= 'A' && c <= 'F') v = v * 16 + (unsigned)(c - 'A' + 10);
+	else return fail(r);
+    }
+    *out = v;
+    return 1;
+}
+
+/* \uXXXX (and its low surrogate) as UTF-8, like cJSON's utf16_literal_to_utf8 */
+static int read_unicode(JsonReader* r, unsigned char* utf8, int* n) {
+    unsigned cp = 0;
+    if (!hex4(r, &cp)) return 0;
+    if (cp >= 0xDC00 && cp <= 0xDFFF) return fail(r);
+    if (cp >= 0xD800 && cp <= 0xDBFF) {
+	unsigned lo = 0;
+	if (get_byte(r) != '\\' || get_byte(r) != 'u' || !hex4(r, &lo)) return fail(r);
+	if (lo < 0xDC00 || lo > 0xDFFF) return fail(r);
+	cp = 0x10000 + (((cp & 0x3FF) << 10) | (lo & 0x3FF));
+    }
+    if (cp < 0x80) {
+	utf8[0] = (unsigned char)cp;
+	*n = 1;
+    } else if (cp < 0x800) {
+	utf8[0] = (unsigned char)(0xC0 | (cp >> 6));
+	utf8[1] = (unsigned char)(0x80 | (cp & 0x3F));
+	*n = 2;
+    } else if (cp < 0x10000) {
+	utf8[0] = (unsigned char)(0xE0 | (cp >> 12));
+	utf8[1] = (unsigned char)(0x80 | ((cp >> 6) & 0x3F));
+	utf8[2] = (unsigned char)(0x80 | (cp & 0x3F));
+	*n = 3;
+    } else {
+	utf8[0] = (unsigned char)(0xF0 | (cp >> 18));
+	utf8[1] = (unsigned char)(0x80 | ((cp >> 12) & 0x3F));
+	utf8[2] = (unsigned char)(0x80 | ((cp >> 6) & 0x3F));
+	utf8[3] = (unsigned char)(0x80 | (cp & 0x3F));
+	*n = 4;
+    }
+    return 1;
+}
+
+int json_read_string(JsonReader* r, char* out, size_t size) {
+    if (!r || r->failed) return 0;
+    if (!expect(r, '"')) return 0;
+    size_t n = 0;
+    for (;;) {
+	/* copy the run up to the next quote or escape straight from the buffer */
+	if (!fill(r)) return fail(r);
+	const char* start = r->buf + r->pos;
+	size_t avail = r->len - r->pos, run = 0;
+	while (run < avail && start[run] != '"' && start[run] != '\\') run++;
+	if (out && n + 1 < size) {
+	    size_t take = run < size - 1 - n ? run : size - 1 - n;
+	    memcpy(out + n, start, take);
+	    n += take;
+	}
+	r->pos += run;
+	if (run == avail) continue;
+
+	if (get_byte(r) == '"') break;
+	unsigned char utf8[4];
+	int len = 1;
+	switch (get_byte(r)) {
+	    case '"': utf8[0] = '"'; break;
+	    case '\\': utf8[0] = '\\'; break;
+	    case '/': utf8[0] = '/'; break;
+	    case 'b': utf8[0] = '\b'; break;
+	    case 'f': utf8[0] = '\f'; break;
+	    case 'n': utf8[0] = '\n'; break;
+	    case 'r': utf8[0] = '\r'; break;
+	    case 't': utf8[0] = '\t'; break;
+	    case 'u':
+		if (!read_unicode(r, utf8, &len)) return 0;
+		break;
+	    default:
+		return fail(r);
+	}
+	for (int i = 0; i < len; i++) {
+	    if (out && n + 1 < size) out[n++] = (char)utf8[i];
+	}
+    }
+    if (out && size > 0) out[n] = '\0';
+    return 1;
+}
+
+int json_read_number(JsonReader* r, double* out) {
+    if (json_peek(r) != JSON_VALUE_NUMBER) return r ? fail(r) : 0;
+    char num[64];
+    size_t n = 0;
+    for (;;) {
+	int c = peek_byte(r);
+	if (!((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E')) break;
+	if (n + 1 == sizeof(num)) return fail(r);
+	num[n++] = (char)c;
+	r->pos++;
+    }
+    num[n] = '\0';
+    char* end = NULL;
+    double v = strtod(num, &end);
+    if (end == num) return fail(r);
+    if (out) *out = v;
+    return 1;
+}
+
+/* Consumes the literal `word`. */
+static int read_literal(JsonReader* r, const char* word) {
+    for (; *word; word++) {
+	if (get_byte(r) != *word) return fail(r);
+    }
+    return 1;
+}
+
+int json_skip(JsonReader* r) {
+    char key[1];
+    switch (json_peek(r)) {
+	case JSON_VALUE_OBJECT:
+	    if (!json_read_object(r)) return 0;
+	    while (json_read_key(r, key, sizeof(key))) {
+		if (!json_skip(r)) return 0;
+	    }
+	    return !r->failed;
+	case JSON_VALUE_ARRAY:
+	    if (!json_read_array(r)) return 0;
+	    while (json_read_next(r)) {
+		if (!json_skip(r)) return 0;
+	    }
+	    return !r->failed;
+	case JSON_VALUE_STRING:
+	    return json_read_string(r, NULL, 0);
+	case JSON_VALUE_NUMBER:
+	    return json_read_number(r, NULL);
+	case JSON_VALUE_BOOL:
+	    return read_literal(r, peek_byte(r) == 't' ? "true" : "false");
+	case JSON_VALUE_NULL:
+	    return read_literal(r, "null");
+	default:
+	    return r ? fail(r) : 0;
+    }
+}
+
+int json_reader_ok(const JsonReader* r) {
+    return r && !r->failed;
+}
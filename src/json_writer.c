@@ -0,0 +1,128 @@
+#include "json_writer.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+void json_writer_init(JsonWriter* w, FILE* f) {
+    if (!w) return;
+    memset(w, 0, sizeof(*w));
+    w->f = f;
+    w->failed = f == NULL;
+}
+
+static void put(JsonWriter* w, const char* s, size_t n) {
+    if (w->failed) return;
+    if (fwrite(s, 1, n, w->f) != n) w->failed = 1;
+}
+
+/* Separator before a value: a comma unless it is the first one in its
+ * container or it follows a key. */
+static void begin_value(JsonWriter* w) {
+    if (w->after_key) {
+	w->after_key = 0;
+	return;
+    }
+    if (w->depth > 0) {
+	if (w->has_items[w->depth - 1]) put(w, ",", 1);
+	w->has_items[w->depth - 1] = 1;
+    }
+}
+
+static void open_container(JsonWriter* w, char c) {
+    if (!w || w->failed) return;
+    begin_value(w);
+    if (w->depth == JSON_WRITER_MAX_DEPTH) {
+	w->failed = 1;
+	return;
+    }
+    w->has_items[w->depth++] = 0;
+    put(w, &c, 1);
+}
+
+static void close_container(JsonWriter* w, char c) {
+    if (!w || w->failed) return;
+    if (w->depth == 0 || w->after_key) {
+	w->failed = 1;
+	return;
+    }
+    w->depth--;
+    put(w, &c, 1);
+}
+
+void json_begin_object(JsonWriter* w) {
+    open_container(w, '{');
+}
+
+void json_end_object(JsonWriter* w) {
+    close_container(w, '}');
+}
+
+void json_begin_array(JsonWriter* w) {
+    open_container(w, '[');
+}
+
+void json_end_array(JsonWriter* w) {
+    close_container(w, ']');
+}
+
+/* Quoted string with the same escapes as cJSON's print_string_ptr. */
+static void put_string(JsonWriter* w, const char* s) {
+    put(w, "\"", 1);
+    const unsigned char* p = (const unsigned char*)(s ? s : "");
+    const unsigned char* run = p;
+    for (; *p; p++) {
+	if (*p > 31 && *p != '"' && *p != '\\') continue;
+	put(w, (const char*)run, (size_t)(p - run));
+	char esc[8];
+	switch (*p) {
+	    case '"': put(w, "\\\"", 2); break;
+	    case '\\': put(w, "\\\\", 2); break;
+	    case '\b': put(w, "\\b", 2); break;
+	    case '\f': put(w, "\\f", 2); break;
+	    case '\n': put(w, "\\n", 2); break;
+	    case '\r': put(w, "\\r", 2); break;
+	    case '\t': put(w, "\\t", 2); break;
+	    default:
+		snprintf(esc, sizeof(esc), "\\u%04x", *p);
+		put(w, esc, 6);
+		break;
+	}
+	run = p + 1;
+    }
+    put(w, (const char*)run, (size_t)(p - run));
+    put(w, "\"", 1);
+}
+
+void json_key(JsonWriter* w, const char* key) {
+    if (!w || w->failed) return;
+    begin_value(w);
+    put_string(w, key);
+    put(w, ":", 1);
+    w->after_key = 1;
+}
+
+void json_int(JsonWriter* w, long long v) {
+    if (!w || w->failed) return;
+    begin_value(w);
+    if (!w->failed && fprintf(w->f, "%lld", v) < 0) w->failed = 1;
+}
+
+void json_double(JsonWriter* w, double v) {
+    if (!w || w->failed) return;
+    begin_value(w);
+    /* shortest of cJSON's two precisions that reads back exactly */
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%1.15g", v);
+    if (strtod(buf, NULL) != v) snprintf(buf, sizeof(buf), "%1.17g", v);
+    if (!w->failed && fputs(buf, w->f) == EOF) w->failed = 1;
+}
+
+void json_string(JsonWriter* w, const char* s) {
+    if (!w || w->failed) return;
+    begin_value(w);
+    put_string(w, s);
+}
+
+int json_writer_ok(const JsonWriter* w) {
+    return w && !w->failed && w->depth == 0 && !ferror(w->f);
+}
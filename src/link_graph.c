@@ -0,0 +1,203 @@
+#include "link_graph.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+/* source of LinkGraph::generation values; never reused */
+static uint64_t next_generation = 1;
+
+void link_graph_init(LinkGraph* lg) {
+    if (!lg) return;
+    memset(lg, 0, sizeof(*lg));
+}
+
+/* Drops the CSR arrays, whether malloc'd or mapped from a file. */
+static void release_csr(LinkGraph* lg) {
+    if (lg->map) {
+	munmap(lg->map, lg->map_len);
+	lg->map = NULL;
+	lg->map_len = 0;
+    } else {
+	free(lg->offsets);
+	free(lg->neighbors);
+    }
+    lg->offsets = NULL;
+    lg->neighbors = NULL;
+}
+
+void link_graph_free(LinkGraph* lg) {
+    if (!lg) return;
+    release_csr(lg);
+    free(lg->staged);
+    link_graph_init(lg);
+}
+
+CoreResult link_graph_add(LinkGraph* lg, ServerId from, ServerId to) {
+    if (!lg || from < 0 || to < 0) return CORE_ERR_INVALID_ARG;
+    if (lg->staged_count == lg->staged_cap) {
+	size_t cap = lg->staged_cap ? lg->staged_cap * 2 : 256;
+	LinkEdge* grown = realloc(lg->staged, cap * sizeof(*grown));
+	if (!grown) return CORE_ERR_UNKNOWN;
+	lg->staged = grown;
+	lg->staged_cap = cap;
+    }
+    lg->staged[lg->staged_count].from = from;
+    lg->staged[lg->staged_count].to = to;
+    lg->staged_count++;
+    return CORE_OK;
+}
+
+CoreResult link_graph_add_bidirectional(LinkGraph* lg, ServerId a, ServerId b) {
+    if (!lg || a == b) return CORE_ERR_INVALID_ARG;
+    CoreResult r = link_graph_add(lg, a, b);
+    if (r != CORE_OK) return r;
+    return link_graph_add(lg, b, a);
+}
+
+CoreResult link_graph_append_staged(LinkGraph* dst, const LinkGraph* src) {
+    if (!dst || !src || dst == src) return CORE_ERR_INVALID_ARG;
+    size_t need = dst->staged_count + src->staged_count;
+    if (need > dst->staged_cap) {
+	size_t cap = dst->staged_cap ? dst->staged_cap : 256;
+	while (cap < need) cap *= 2;
+	LinkEdge* grown = realloc(dst->staged, cap * sizeof(*grown));
+	if (!grown) return CORE_ERR_UNKNOWN;
+	dst->staged = grown;
+	dst->staged_cap = cap;
+    }
+    if (src->staged_count > 0) {
+	memcpy(dst->staged + dst->staged_count, src->staged, src->staged_count * sizeof(*src->staged));
+    }
+    dst->staged_count = need;
+    return CORE_OK;
+}
+
+/* Merges frozen and staged links into fresh CSR arrays. Staged links are
+ * placed with a stable counting sort on the source, so every node keeps its
+ * links in insertion order; duplicates are then squeezed out in one pass
+ * using a per-target "last seen by" stamp. */
+CoreResult link_graph_freeze(LinkGraph* lg, int node_count) {
+    if (!lg || node_count < 0) return CORE_ERR_INVALID_ARG;
+    if (node_count < lg->node_count) node_count = lg->node_count;
+
+    size_t total = (size_t)lg->edge_count + lg->staged_count;
+    if (total > UINT32_MAX) return CORE_ERR_UNKNOWN;
+
+    uint32_t* offsets = calloc((size_t)node_count + 1, sizeof(*offsets));
+    uint32_t* cursor = malloc(((size_t)node_count + 1) * sizeof(*cursor));
+    ServerId* nb = malloc((total ? total : 1) * sizeof(*nb));
+    if (!offsets || !cursor || !nb) {
+	free(offsets);
+	free(cursor);
+	free(nb);
+	return CORE_ERR_UNKNOWN;
+    }
+
+    /* degree count */
+    for (int i = 0; i < lg->node_count; i++) {
+	offsets[i + 1] += lg->offsets[i + 1] - lg->offsets[i];
+    }
+    for (size_t i = 0; i < lg->staged_count; i++) {
+	const LinkEdge* e = &lg->staged[i];
+	if (e->from >= node_count || e->to >= node_count) continue;
+	offsets[e->from + 1]++;
+    }
+    for (int i = 0; i < node_count; i++) {
+	offsets[i + 1] += offsets[i];
+    }
+
+    /* scatter: frozen links first, then staged ones */
+    memcpy(cursor, offsets, (size_t)node_count * sizeof(*cursor));
+    for (int i = 0; i < lg->node_count; i++) {
+	uint32_t deg = lg->offsets[i + 1] - lg->offsets[i];
+	memcpy(nb + cursor[i], lg->neighbors + lg->offsets[i], deg * sizeof(*nb));
+	cursor[i] += deg;
+    }
+    for (size_t i = 0; i < lg->staged_count; i++) {
+	const LinkEdge* e = &lg->staged[i];
+	if (e->from >= node_count || e->to >= node_count) continue;
+	nb[cursor[e->from]++] = e->to;
+    }
+
+    /* dedup in place; `cursor` is reused as the stamp array */
+    memset(cursor, 0xff, (size_t)node_count * sizeof(*cursor));
+    uint32_t w = 0;
+    for (int i = 0; i < node_count; i++) {
+	uint32_t start = offsets[i];
+	uint32_t end = offsets[i + 1];
+	offsets[i] = w;
+	for (uint32_t k = start; k < end; k++) {
+	    ServerId to = nb[k];
+	    if (cursor[to] == (uint32_t)i) continue;
+	    cursor[to] = (uint32_t)i;
+	    nb[w++] = to;
+	}
+    }
+    offsets[node_count] = w;
+    free(cursor);
+
+    ServerId* shrunk = realloc(nb, (w ? w : 1) * sizeof(*nb));
+    if (shrunk) nb = shrunk;
+
+    release_csr(lg);
+    free(lg->staged);
+    lg->offsets = offsets;
+    lg->neighbors = nb;
+    lg->node_count = node_count;
+    lg->edge_count = w;
+    lg->generation = next_generation++;
+    lg->staged = NULL;
+    lg->staged_count = 0;
+    lg->staged_cap = 0;
+    return CORE_OK;
+}
+
+CoreResult link_graph_adopt_mapping(LinkGraph* lg, uint32_t* offsets, ServerId* neighbors, int node_count,
+                                    uint32_t edge_count, void* map, size_t map_len) {
+    if (!lg || !offsets || node_count < 0 || !map || (edge_count > 0 && !neighbors)) {
+	return CORE_ERR_INVALID_ARG;
+    }
+    if (offsets[0] != 0 || offsets[node_count] != edge_count) return CORE_ERR_INVALID_ARG;
+    for (int i = 0; i < node_count; i++) {
+	if (offsets[i + 1] < offsets[i]) return CORE_ERR_INVALID_ARG;
+    }
+    for (uint32_t e = 0; e < edge_count; e++) {
+	if (neighbors[e] < 0 || neighbors[e] >= node_count) return CORE_ERR_INVALID_ARG;
+    }
+
+    link_graph_free(lg);
+    lg->offsets = offsets;
+    lg->neighbors = neighbors;
+    lg->node_count = node_count;
+    lg->edge_count = edge_count;
+    lg->generation = next_generation++;
+    lg->map = map;
+    lg->map_len = map_len;
+    return CORE_OK;
+}
+
+int link_graph_is_frozen(const LinkGraph* lg) {
+    return !lg || lg->staged_count == 0;
+}
+
+const ServerId* link_graph_neighbors(const LinkGraph* lg, ServerId id, int* out_count) {
+    if (out_count) *out_count = 0;
+    if (!lg || id < 0 || id >= lg->node_count) return NULL;
+    if (out_count) *out_count = (int)(lg->offsets[id + 1] - lg->offsets[id]);
+    return lg->neighbors + lg->offsets[id];
+}
+
+int link_graph_degree(const LinkGraph* lg, ServerId id) {
+    if (!lg || id < 0 || id >= lg->node_count) return 0;
+    return (int)(lg->offsets[id + 1] - lg->offsets[id]);
+}
+
+int link_graph_has_link(const LinkGraph* lg, ServerId from, ServerId to) {
+    int n = 0;
+    const ServerId* nb = link_graph_neighbors(lg, from, &n);
+    for (int i = 0; i < n; i++) {
+	if (nb[i] == to) return 1;
+    }
+    return 0;
+}
@@ -1,17 +1,26 @@
 #define _POSIX_C_SOURCE 200809L
 
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <time.h>
 #include <stdint.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/signalfd.h>
+#include <unistd.h>
 
 #include "game.h"
 #include "ui.h"
 #include "commands.h"
 #include "script.h"
+#include "batch.h"
+#include "sim.h"
+#include "generator.h"
 
 #define TPS 10
-#define MS_PER_TICK (1000 / TPS)
 /* Target frame rate for UI rendering (frames per second). */
 #define FPS 60
 #define MS_PER_FRAME (1000 / FPS)
@@ -22,70 +31,237 @@ uint64_t current_time_ms(void) {
     return (uint64_t)ts.tv_sec * 1000 + (uint64_t)(ts.tv_nsec / 1000000);
 }
 
-int main(void) {
-    // Time related variable
-    uint64_t last_tick = current_time_ms();
+static void usage(const char* prog) {
+    fprintf(stderr,
+            "usage: %s [--batch [FILE|-]] [--load SAVE] [--tps N] [--ticks-per-command N]\n"
+            "          [--no-drain] [--quiet] [--generate FILE [--isps N]]\n"
+            "  --batch              run commands from FILE (default stdin) without the UI\n"
+            "  --load SAVE          batch: start from SAVE instead of a fresh world\n"
+            "  --tps N              batch: pace ticks to N per second (default: unpaced)\n"
+            "  --ticks-per-command  batch: ticks stepped after each command when unpaced\n"
+            "  --no-drain           batch: do not tick out pending actions at the end\n"
+            "  --quiet              batch: do not print the latency summary\n"
+            "  --generate FILE      write a new city world (HACKTERM_SEED) to FILE and exit\n"
+            "  --isps N             generate: number of ISPs instead of the default\n",
+            prog);
+}
+
+/* Streams a generated world straight to a save file; the world is never
+ * held in memory as a whole, so this works for worlds the game could not
+ * load at once. */
+static int run_generate(const char* file, int isps) {
+    GeneratorParams params;
+    generator_city_params(&params);
+    if (isps > 0) params.isp_count = isps;
+    const char* seed_env = getenv("HACKTERM_SEED");
+    unsigned int seed = seed_env ? (unsigned int)atoi(seed_env) : 0;
+    if (!generator_write_save(&params, seed, file)) {
+	fprintf(stderr, "could not write %s\n", file);
+	return 1;
+    }
+    return 0;
+}
+
+/* Headless mode: commands from a file or stdin, output to stdout. */
+static int run_batch(const char* input, const char* save, const BatchOptions* opts) {
+    FILE* in = stdin;
+    if (input && strcmp(input, "-") != 0) {
+	in = fopen(input, "r");
+	if (!in) {
+	    perror(input);
+	    return 1;
+	}
+    }
+
+    GameState* game = calloc(1, sizeof(*game));
+    if (!game) return 1;
+
+    ui_init_headless();
+    if (!save || !game_load(game, save)) {
+	if (save) fprintf(stderr, "Warning: could not load %s, generating a new world\n", save);
+	game_init(game);
+    }
+    game->on_action = commands_report_action;
+    game->on_action_ctx = game;
+    game->on_save = commands_report_save;
+    if (script_init(game) != 0) {
+	fprintf(stderr, "Warning: scripting subsystem failed to initialize\n");
+    }
+
+    batch_run(game, in, opts);
+
+    script_shutdown();
+    game_shutdown(game);
+    free(game);
+    ui_shutdown();
+    if (in != stdin) fclose(in);
+    return 0;
+}
 
-    // Fixed seed for debugging
-    srand(12345);
+int main(int argc, char** argv) {
+    int batch = 0;
+    const char* batch_input = NULL;
+    const char* batch_save = NULL;
+    const char* generate_file = NULL;
+    int generate_isps = 0;
+    BatchOptions opts;
+    batch_default_options(&opts);
+
+    for (int i = 1; i < argc; i++) {
+	if (strcmp(argv[i], "--batch") == 0) {
+	    batch = 1;
+	    if (i + 1 < argc && (argv[i + 1][0] != '-' || strcmp(argv[i + 1], "-") == 0)) {
+		batch_input = argv[++i];
+	    }
+	} else if (strcmp(argv[i], "--load") == 0 && i + 1 < argc) {
+	    batch_save = argv[++i];
+	} else if (strcmp(argv[i], "--tps") == 0 && i + 1 < argc) {
+	    opts.tps = atoi(argv[++i]);
+	} else if (strcmp(argv[i], "--ticks-per-command") == 0 && i + 1 < argc) {
+	    opts.ticks_per_command = atoi(argv[++i]);
+	} else if (strcmp(argv[i], "--no-drain") == 0) {
+	    opts.drain = 0;
+	} else if (strcmp(argv[i], "--quiet") == 0) {
+	    opts.quiet = 1;
+	} else if (strcmp(argv[i], "--generate") == 0 && i + 1 < argc) {
+	    generate_file = argv[++i];
+	} else if (strcmp(argv[i], "--isps") == 0 && i + 1 < argc) {
+	    generate_isps = atoi(argv[++i]);
+	} else {
+	    usage(argv[0]);
+	    return 2;
+	}
+    }
+    if (generate_file) return run_generate(generate_file, generate_isps);
+    if (batch) return run_batch(batch_input, batch_save, &opts);
 
-    // GameState
-    GameState game;
+    // GameState (heap-allocated: the world can be far larger than a stack frame)
+    GameState* game = calloc(1, sizeof(*game));
+    if (!game) return 1;
     char line[256];
 
     // Initialise UI and GameState
     ui_init();
 
     /* Try to load JSON save first (save.json). If it fails, initialize a new game. */
-    if (!game_load(&game, "save.json")) {
-        game_init(&game);
+    if (!game_load(game, "save.json")) {
+        game_init(game);
     }
+    /* Report scheduled actions as they complete. */
+    game->on_action = commands_report_action;
+    game->on_action_ctx = game;
+    game->on_save = commands_report_save;
+
     /* Initialize scripting subsystem. */
-    if (script_init(&game) != 0) {
+    if (script_init(game) != 0) {
 	ui_print("Warning: scripting subsystem failed to initialize");
     }
 
+    if (server_name_duplicates(&game->servers) > 0) {
+	ui_print("Warning: %d servers share a name with an earlier server and cannot be reached by name",
+	         server_name_duplicates(&game->servers));
+    }
+
     ui_print("hackterm v0.1");
     ui_print("Type 'help' to get started.");
 
-    while (1) {
-        /* Frame start timestamp */
-        uint64_t frame_start = current_time_ms();
+    /* Resizes are read from a signalfd instead of a handler. The mask is
+     * set before the simulation thread starts so it inherits it too. */
+    sigset_t winch;
+    sigemptyset(&winch);
+    sigaddset(&winch, SIGWINCH);
+    pthread_sigmask(SIG_BLOCK, &winch, NULL);
+    int winch_fd = signalfd(-1, &winch, SFD_NONBLOCK | SFD_CLOEXEC);
 
-        /* Render current state */
-        ui_render();
+    /* From here on the simulation thread owns the game state. */
+    Sim* sim = sim_start(game, TPS);
+    if (!sim) {
+	ui_shutdown();
+	fprintf(stderr, "Failed to start the simulation thread\n");
+	script_shutdown();
+	game_shutdown(game);
+	free(game);
+	return 1;
+    }
 
-        /* Handle user input, if there is any */
-        if (ui_readline_nonblocking(line, sizeof(line)) > 0) {
-            if (commands_run(&game, line) == CMD_QUIT) {
-                break;
+    /* Sleep until a key arrives, the simulation has output or a snapshot,
+     * or the terminal is resized; never on a fixed timer. */
+    enum { FD_INPUT, FD_SIM, FD_WINCH, FD_COUNT };
+    struct pollfd fds[FD_COUNT] = {
+        [FD_INPUT] = { .fd = STDIN_FILENO, .events = POLLIN },
+        [FD_SIM] = { .fd = sim_notify_fd(sim), .events = POLLIN },
+        [FD_WINCH] = { .fd = winch_fd, .events = POLLIN },
+    };
+    uint64_t last_frame = 0;
+    int running = 1;
+    while (running) {
+        /* Render damage right away, but at most FPS frames a second */
+        int timeout = -1;
+        if (ui_render_pending()) {
+            uint64_t now = current_time_ms();
+            if (now - last_frame >= MS_PER_FRAME) {
+                ui_render();
+                last_frame = now;
+            } else {
+                timeout = (int)(MS_PER_FRAME - (now - last_frame));
             }
         }
 
-        /* Advance simulation: catch up by running ticks until caught up */
-        uint64_t now = current_time_ms();
-        while (now - last_tick >= MS_PER_TICK) {
-            game_tick(&game);
-            last_tick += MS_PER_TICK;
-            now = current_time_ms();
+        if (poll(fds, FD_COUNT, timeout) < 0) {
+            if (errno == EINTR) continue;
+            break;
         }
 
-        /* Cap render loop to target FPS to avoid burning CPU */
-        uint64_t frame_end = current_time_ms();
-        int64_t elapsed = (int64_t)(frame_end - frame_start);
-        int64_t sleep_ms = MS_PER_FRAME - elapsed;
-        if (sleep_ms > 0) {
-            struct timespec ts;
-            ts.tv_sec = sleep_ms / 1000;
-            ts.tv_nsec = (sleep_ms % 1000) * 1000000L;
-            nanosleep(&ts, NULL);
+        if (fds[FD_WINCH].revents & POLLIN) {
+            struct signalfd_siginfo si;
+            while (read(winch_fd, &si, sizeof(si)) == (ssize_t)sizeof(si)) {
+            }
+            ui_resize();
+        }
+
+        /* Apply everything the simulation produced since the last wakeup */
+        if (fds[FD_SIM].revents & POLLIN) {
+            sim_ack_notify(sim);
+            SimEvent ev;
+            while (running && sim_poll_event(sim, &ev)) {
+                switch (ev.type) {
+                case SIM_EVENT_PRINT:
+                    ui_print("%s", ev.text);
+                    break;
+                case SIM_EVENT_SNAPSHOT:
+                    if (ev.saving >= 0) {
+                        ui_set_status("hackterm | %s | tick %d | %d pending | saving %d%%", ev.text, ev.tick,
+                                      ev.pending, ev.saving);
+                    } else {
+                        ui_set_status("hackterm | %s | tick %d | %d pending", ev.text, ev.tick, ev.pending);
+                    }
+                    break;
+                case SIM_EVENT_QUIT:
+                    running = 0;
+                    break;
+                }
+            }
+        }
+
+        /* Hand user input to the simulation, if there is any */
+        if (fds[FD_INPUT].revents & (POLLHUP | POLLERR)) break;
+        if (running && (fds[FD_INPUT].revents & POLLIN)) {
+            /* drain every available key; each completed line is posted */
+            while (ui_readline_nonblocking(line, sizeof(line)) > 0) {
+                if (!sim_post_command(sim, line)) {
+                    ui_print("Busy: command dropped, try again");
+                }
+            }
         }
     }
+    sim_stop(sim);
+    if (winch_fd >= 0) close(winch_fd);
 
     /* Shutdown scripting subsystem before tearing down game state. */
     script_shutdown();
 
-    game_shutdown(&game);
+    game_shutdown(game);
+    free(game);
     ui_shutdown();
     return 0;
 }
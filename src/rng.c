@@ -0,0 +1,23 @@
+#include "rng.h"
+
+static uint64_t splitmix64(uint64_t* x) {
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+uint64_t rng_key(uint64_t parent, uint64_t index) {
+    /* mix the index first so neighbouring indices land far apart */
+    uint64_t x = index;
+    uint64_t y = parent ^ splitmix64(&x);
+    return splitmix64(&y);
+}
+
+void rng_init(Rng* r, uint64_t key) {
+    if (!r) return;
+    uint64_t x = key;
+    for (int i = 0; i < 4; i++) r->s[i] = splitmix64(&x);
+    /* splitmix64 is a bijection of its counter, so four consecutive
+     * outputs are never all zero */
+}
@@ -0,0 +1,158 @@
+#include "route.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void side_free(RouteSide* s) {
+    free(s->seen);
+    free(s->touched);
+    free(s->parent);
+    free(s->depth);
+    free(s->queue);
+    memset(s, 0, sizeof(*s));
+}
+
+/* Grows every buffer of one side to @p cap nodes; new bitset words are
+ * zeroed so the "all clear between queries" invariant holds. */
+static int side_reserve(RouteSide* s, int old_cap, int cap) {
+    size_t old_words = ((size_t)old_cap + 63) / 64;
+    size_t words = ((size_t)cap + 63) / 64;
+
+    uint64_t* seen = realloc(s->seen, words * sizeof(*seen));
+    if (!seen) return -1;
+    memset(seen + old_words, 0, (words - old_words) * sizeof(*seen));
+    s->seen = seen;
+
+    uint32_t* touched = realloc(s->touched, words * sizeof(*touched));
+    if (!touched) return -1;
+    s->touched = touched;
+
+    ServerId* parent = realloc(s->parent, (size_t)cap * sizeof(*parent));
+    if (!parent) return -1;
+    s->parent = parent;
+
+    int32_t* depth = realloc(s->depth, (size_t)cap * sizeof(*depth));
+    if (!depth) return -1;
+    s->depth = depth;
+
+    ServerId* queue = realloc(s->queue, (size_t)cap * sizeof(*queue));
+    if (!queue) return -1;
+    s->queue = queue;
+    return 0;
+}
+
+static int reserve(RouteFinder* rf, int cap) {
+    if (cap <= rf->capacity) return 0;
+    if (side_reserve(&rf->fwd, rf->capacity, cap) != 0) return -1;
+    if (side_reserve(&rf->bwd, rf->capacity, cap) != 0) return -1;
+    ServerId* path = realloc(rf->path, (size_t)cap * sizeof(*path));
+    if (!path) return -1;
+    rf->path = path;
+    rf->capacity = cap;
+    return 0;
+}
+
+static inline int is_seen(const RouteSide* s, ServerId v) {
+    return (s->seen[(uint32_t)v >> 6] >> ((uint32_t)v & 63)) & 1;
+}
+
+static inline void mark(RouteSide* s, ServerId v, ServerId parent, int32_t depth) {
+    uint32_t w = (uint32_t)v >> 6;
+    if (s->seen[w] == 0) s->touched[s->touched_count++] = w;
+    s->seen[w] |= 1ull << ((uint32_t)v & 63);
+    s->parent[v] = parent;
+    s->depth[v] = depth;
+}
+
+static void side_clear(RouteSide* s) {
+    for (int i = 0; i < s->touched_count; i++) s->seen[s->touched[i]] = 0;
+    s->touched_count = 0;
+}
+
+/*
+ * Expands the whole BFS level queue[*head, *tail) of @p s. Every node that
+ * becomes visited by both sides is a meeting point; the best one found
+ * while finishing the level gives a shortest path.
+ */
+static void expand_level(RouteSide* s, const RouteSide* other, const LinkGraph* lg,
+                         int* head, int* tail, ServerId* meet, int* best) {
+    int level_end = *tail;
+    for (int i = *head; i < level_end; i++) {
+	ServerId u = s->queue[i];
+	int32_t d = s->depth[u] + 1;
+	int n = 0;
+	const ServerId* nb = link_graph_neighbors(lg, u, &n);
+	for (int j = 0; j < n; j++) {
+	    ServerId v = nb[j];
+	    if (is_seen(s, v)) continue;
+	    mark(s, v, u, d);
+	    s->queue[(*tail)++] = v;
+	    if (is_seen(other, v) && d + other->depth[v] < *best) {
+		*best = d + other->depth[v];
+		*meet = v;
+	    }
+	}
+    }
+    *head = level_end;
+}
+
+void route_init(RouteFinder* rf) {
+    if (!rf) return;
+    memset(rf, 0, sizeof(*rf));
+}
+
+void route_free(RouteFinder* rf) {
+    if (!rf) return;
+    side_free(&rf->fwd);
+    side_free(&rf->bwd);
+    free(rf->path);
+    route_init(rf);
+}
+
+const ServerId* route_find(RouteFinder* rf, const LinkGraph* lg, ServerId from, ServerId to, int* out_len) {
+    if (out_len) *out_len = 0;
+    if (!rf || !lg) return NULL;
+    if (from < 0 || to < 0 || from >= lg->node_count || to >= lg->node_count) return NULL;
+    if (reserve(rf, lg->node_count) != 0) return NULL;
+
+    if (from == to) {
+	rf->path[0] = from;
+	if (out_len) *out_len = 1;
+	return rf->path;
+    }
+
+    RouteSide* f = &rf->fwd;
+    RouteSide* b = &rf->bwd;
+    mark(f, from, SERVER_INVALID_ID, 0);
+    mark(b, to, SERVER_INVALID_ID, 0);
+    f->queue[0] = from;
+    b->queue[0] = to;
+    int fh = 0, ft = 1, bh = 0, bt = 1;
+
+    ServerId meet = SERVER_INVALID_ID;
+    int best = INT_MAX;
+    while (meet == SERVER_INVALID_ID && fh < ft && bh < bt) {
+	/* grow the cheaper side */
+	if (ft - fh <= bt - bh) {
+	    expand_level(f, b, lg, &fh, &ft, &meet, &best);
+	} else {
+	    expand_level(b, f, lg, &bh, &bt, &meet, &best);
+	}
+    }
+
+    int len = 0;
+    if (meet != SERVER_INVALID_ID) {
+	len = best + 1;
+	int i = f->depth[meet];
+	for (ServerId v = meet; v != SERVER_INVALID_ID; v = f->parent[v]) rf->path[i--] = v;
+	i = f->depth[meet] + 1;
+	for (ServerId v = b->parent[meet]; v != SERVER_INVALID_ID; v = b->parent[v]) rf->path[i++] = v;
+    }
+    side_clear(f);
+    side_clear(b);
+
+    if (len == 0) return NULL;
+    if (out_len) *out_len = len;
+    return rf->path;
+}
@@ -0,0 +1,382 @@
+/* save_json.c - the JSON save layout shared by game_save() and the generator */
+#include "save_json.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+void save_json_begin(JsonWriter* w, int server_count, ServerId home_server, ServerId current_server) {
+    json_begin_object(w);
+    json_key(w, "version");
+    json_int(w, 1);
+    json_key(w, "game");
+    json_begin_object(w);
+    json_key(w, "server_count");
+    json_int(w, server_count);
+    json_key(w, "home_server");
+    json_int(w, home_server);
+    json_key(w, "current_server");
+    json_int(w, current_server);
+    json_key(w, "servers");
+    json_begin_array(w);
+}
+
+void save_json_server(JsonWriter* w, ServerId id, const ServerStore* st, ServerId local,
+                      const ServerId* links, int link_count) {
+    json_begin_object(w);
+    json_key(w, "id");
+    json_int(w, id);
+    json_key(w, "name");
+    json_string(w, server_name(st, local));
+    json_key(w, "security");
+    json_int(w, server_security(st, local));
+    json_key(w, "money");
+    json_int(w, server_money(st, local));
+    /* string type name under the stable "type" key */
+    json_key(w, "type");
+    json_string(w, server_type_to_string(server_type(st, local)));
+    json_key(w, "subnet");
+    json_int(w, server_subnet(st, local));
+    json_key(w, "links");
+    json_begin_array(w);
+    for (int i = 0; i < link_count; i++) json_int(w, links[i]);
+    json_end_array(w);
+    json_key(w, "services");
+    json_begin_array(w);
+    int svc_count = 0;
+    const Service* svcs = server_services(st, local, &svc_count);
+    for (int i = 0; i < svc_count; i++) {
+	json_begin_object(w);
+	json_key(w, "name");
+	json_string(w, svcs[i].name);
+	json_key(w, "port");
+	json_int(w, svcs[i].port);
+	json_key(w, "vuln");
+	json_int(w, svcs[i].vuln_level);
+	json_end_object(w);
+    }
+    json_end_array(w);
+    json_end_object(w);
+}
+
+/* Generator parameters kept with a lazy world; threads don't change the
+ * world and are left out. */
+#define PARAM(f) { #f, offsetof(GeneratorParams, f) }
+static const struct {
+    const char* key;
+    size_t off;
+} int_params[] = {
+    PARAM(isp_count), PARAM(pop_count), PARAM(neigh_min), PARAM(neigh_max),
+    PARAM(areas_min), PARAM(areas_max), PARAM(buildings_min), PARAM(buildings_max),
+    PARAM(routers_per_building_min), PARAM(routers_per_building_max),
+    PARAM(users_per_router_min), PARAM(users_per_router_max),
+    PARAM(floors_per_building_min), PARAM(floors_per_building_max), PARAM(compact_names),
+}, double_params[] = {
+    PARAM(inter_router_link_density), PARAM(intra_subnet_link_density), PARAM(public_dmz_fraction),
+};
+#undef PARAM
+#define COUNT(a) (sizeof(a) / sizeof((a)[0]))
+
+static void write_lazy(JsonWriter* w, const GenLazyState* lazy) {
+    const char* p = (const char*)&lazy->params;
+    json_key(w, "lazy");
+    json_begin_object(w);
+    json_key(w, "seed");
+    json_int(w, lazy->seed);
+    json_key(w, "first_isp");
+    json_int(w, lazy->first_isp);
+    json_key(w, "params");
+    json_begin_object(w);
+    for (size_t i = 0; i < COUNT(int_params); i++) {
+	json_key(w, int_params[i].key);
+	json_int(w, *(const int*)(p + int_params[i].off));
+    }
+    for (size_t i = 0; i < COUNT(double_params); i++) {
+	json_key(w, double_params[i].key);
+	json_double(w, *(const double*)(p + double_params[i].off));
+    }
+    json_end_object(w);
+    json_key(w, "expanded");
+    json_begin_array(w);
+    for (int i = 0; i < lazy->expanded_count; i++) json_int(w, lazy->expanded[i]);
+    json_end_array(w);
+    json_end_object(w);
+}
+
+int save_json_end(JsonWriter* w, const GenLazyState* lazy) {
+    json_end_array(w);
+    if (lazy && lazy->expanded_count >= 0) write_lazy(w, lazy);
+    json_end_object(w);
+    json_end_object(w);
+    if (!w->failed && fputc('\n', w->f) == EOF) w->failed = 1;
+    return json_writer_ok(w);
+}
+
+/* ---------------- LOADING ---------------- */
+
+/* One server object as read, applied once the object closes so its keys
+ * may come in any order. */
+typedef struct {
+    int id;
+    int has_name;
+    char name[SERVER_NAME_LEN];
+    int security, money, subnet;
+    char type[32];
+    int service_count;
+    Service services[MAX_SERVICES_PER_SERVER];
+    ServerId* links; /* reused across servers */
+    int link_count, link_cap;
+} ServerRecord;
+
+/* A number as an int; other values read as 0, as cJSON's valuedouble did. */
+static int read_int(JsonReader* r) {
+    double v = 0.0;
+    if (json_peek(r) != JSON_VALUE_NUMBER) return json_skip(r), 0;
+    if (!json_read_number(r, &v)) return 0;
+    if (v >= 2147483647.0) return 2147483647;
+    if (v <= -2147483648.0) return -2147483647 - 1;
+    return (int)v;
+}
+
+/* A string value into `out`; anything else leaves it empty. */
+static int read_text(JsonReader* r, char* out, size_t size) {
+    out[0] = '\0';
+    if (json_peek(r) != JSON_VALUE_STRING) {
+	json_skip(r);
+	return 0;
+    }
+    return json_read_string(r, out, size);
+}
+
+static void read_links(JsonReader* r, ServerRecord* rec) {
+    if (json_peek(r) != JSON_VALUE_ARRAY) {
+	json_skip(r);
+	return;
+    }
+    json_read_array(r);
+    while (json_read_next(r)) {
+	if (json_peek(r) != JSON_VALUE_NUMBER) {
+	    json_skip(r);
+	    continue;
+	}
+	int to = read_int(r);
+	if (rec->link_count == rec->link_cap) {
+	    int cap = rec->link_cap ? rec->link_cap * 2 : 16;
+	    ServerId* grown = realloc(rec->links, (size_t)cap * sizeof(*grown));
+	    if (!grown) {
+		r->failed = 1;
+		return;
+	    }
+	    rec->links = grown;
+	    rec->link_cap = cap;
+	}
+	rec->links[rec->link_count++] = to;
+    }
+}
+
+static void read_service(JsonReader* r, Service* svc) {
+    char key[32];
+    memset(svc, 0, sizeof(*svc));
+    if (json_peek(r) != JSON_VALUE_OBJECT) {
+	json_skip(r);
+	return;
+    }
+    json_read_object(r);
+    while (json_read_key(r, key, sizeof(key))) {
+	if (strcmp(key, "name") == 0) read_text(r, svc->name, sizeof(svc->name));
+	else if (strcmp(key, "port") == 0) svc->port = read_int(r);
+	else if (strcmp(key, "vuln") == 0) svc->vuln_level = read_int(r);
+	else json_skip(r);
+    }
+}
+
+static void read_services(JsonReader* r, ServerRecord* rec) {
+    if (json_peek(r) != JSON_VALUE_ARRAY) {
+	json_skip(r);
+	return;
+    }
+    json_read_array(r);
+    while (json_read_next(r)) {
+	if (rec->service_count < MAX_SERVICES_PER_SERVER) {
+	    read_service(r, &rec->services[rec->service_count++]);
+	} else {
+	    json_skip(r);
+	}
+    }
+}
+
+static int read_server(JsonReader* r, ServerRecord* rec) {
+    char key[32];
+    rec->id = -1;
+    rec->has_name = 0;
+    rec->security = 1;
+    rec->money = 0;
+    rec->subnet = -1;
+    rec->type[0] = '\0';
+    rec->service_count = 0;
+    rec->link_count = 0;
+    if (json_peek(r) != JSON_VALUE_OBJECT) return json_skip(r);
+
+    json_read_object(r);
+    while (json_read_key(r, key, sizeof(key))) {
+	if (strcmp(key, "id") == 0) rec->id = read_int(r);
+	else if (strcmp(key, "name") == 0) rec->has_name = read_text(r, rec->name, sizeof(rec->name));
+	else if (strcmp(key, "security") == 0) rec->security = read_int(r);
+	else if (strcmp(key, "money") == 0) rec->money = read_int(r);
+	else if (strcmp(key, "type") == 0) read_text(r, rec->type, sizeof(rec->type));
+	else if (strcmp(key, "subnet") == 0) rec->subnet = read_int(r);
+	else if (strcmp(key, "links") == 0) read_links(r, rec);
+	else if (strcmp(key, "services") == 0) read_services(r, rec);
+	else json_skip(r);
+    }
+    return json_reader_ok(r);
+}
+
+static void read_params(JsonReader* r, GeneratorParams* params) {
+    char key[40];
+    char* p = (char*)params;
+    if (json_peek(r) != JSON_VALUE_OBJECT) {
+	json_skip(r);
+	return;
+    }
+    json_read_object(r);
+    while (json_read_key(r, key, sizeof(key))) {
+	size_t i = 0, k = 0;
+	while (i < COUNT(int_params) && strcmp(key, int_params[i].key) != 0) i++;
+	while (k < COUNT(double_params) && strcmp(key, double_params[k].key) != 0) k++;
+	if (i < COUNT(int_params)) {
+	    *(int*)(p + int_params[i].off) = read_int(r);
+	} else if (k < COUNT(double_params) && json_peek(r) == JSON_VALUE_NUMBER) {
+	    json_read_number(r, (double*)(p + double_params[k].off));
+	} else {
+	    json_skip(r);
+	}
+    }
+}
+
+/* The "lazy" object; its ids are checked by generator_lazy_resume(). */
+static void read_lazy(JsonReader* r, GenLazyState* lazy) {
+    char key[32];
+    int cap = 0;
+    generator_lazy_state_free(lazy);
+    memset(lazy, 0, sizeof(*lazy));
+    if (json_peek(r) != JSON_VALUE_OBJECT) {
+	lazy->expanded_count = -1;
+	json_skip(r);
+	return;
+    }
+    json_read_object(r);
+    while (json_read_key(r, key, sizeof(key))) {
+	if (strcmp(key, "seed") == 0) {
+	    double v = 0.0;
+	    if (json_peek(r) == JSON_VALUE_NUMBER) json_read_number(r, &v);
+	    else json_skip(r);
+	    lazy->seed = v >= 0.0 && v <= 4294967295.0 ? (unsigned int)v : 0;
+	} else if (strcmp(key, "first_isp") == 0) {
+	    lazy->first_isp = read_int(r);
+	} else if (strcmp(key, "params") == 0) {
+	    read_params(r, &lazy->params);
+	} else if (strcmp(key, "expanded") == 0 && json_peek(r) == JSON_VALUE_ARRAY) {
+	    json_read_array(r);
+	    while (json_read_next(r)) {
+		if (lazy->expanded_count == cap) {
+		    cap = cap ? cap * 2 : 64;
+		    ServerId* grown = realloc(lazy->expanded, (size_t)cap * sizeof(*grown));
+		    if (!grown) {
+			r->failed = 1;
+			return;
+		    }
+		    lazy->expanded = grown;
+		}
+		lazy->expanded[lazy->expanded_count++] = read_int(r);
+	    }
+	} else {
+	    json_skip(r);
+	}
+    }
+}
+
+/* `limit` bounds the ids a record may use, so a bogus id can't grow the
+ * store past what the file declares. */
+static int apply_server(const ServerRecord* rec, ServerStore* st, LinkGraph* lg, int limit) {
+    ServerId id = rec->id;
+    if (id < 0) return 1;
+    if (id >= limit) return 0;
+    if (id >= st->count && server_store_resize(st, id + 1) != CORE_OK) return 0;
+    server_set_name(st, id, rec->has_name ? rec->name : NULL);
+    server_clear_services(st, id);
+    server_set_security(st, id, rec->security);
+    server_set_money(st, id, rec->money);
+    server_set_type(st, id, rec->type[0] ? server_type_from_string(rec->type) : SERVER_TYPE_UNKNOWN);
+    server_set_subnet(st, id, rec->subnet);
+    for (int i = 0; i < rec->link_count; i++) link_graph_add(lg, id, rec->links[i]);
+    for (int i = 0; i < rec->service_count; i++) {
+	const Service* svc = &rec->services[i];
+	server_add_service(st, id, svc->port, svc->name, svc->vuln_level);
+    }
+    return 1;
+}
+
+bool save_json_read(JsonReader* r, ServerStore* st, LinkGraph* lg, ServerId* home_server,
+                    ServerId* current_server, GenLazyState* lazy) {
+    char key[32];
+    int have_game = 0, have_count = 0, have_servers = 0;
+    int server_count = 0, home = 0, current = 0, records = 0;
+    ServerRecord rec;
+    memset(&rec, 0, sizeof(rec));
+    if (lazy) {
+	memset(lazy, 0, sizeof(*lazy));
+	lazy->expanded_count = -1;
+    }
+
+    if (json_peek(r) != JSON_VALUE_OBJECT) return false;
+    json_read_object(r);
+    while (json_read_key(r, key, sizeof(key))) {
+	if (have_game || strcmp(key, "game") != 0 || json_peek(r) != JSON_VALUE_OBJECT) {
+	    json_skip(r);
+	    continue;
+	}
+	have_game = 1;
+	json_read_object(r);
+	while (json_read_key(r, key, sizeof(key))) {
+	    if (strcmp(key, "server_count") == 0) {
+		have_count = 1;
+		server_count = read_int(r);
+	    } else if (strcmp(key, "home_server") == 0) {
+		home = read_int(r);
+	    } else if (strcmp(key, "current_server") == 0) {
+		current = read_int(r);
+	    } else if (strcmp(key, "lazy") == 0 && lazy) {
+		read_lazy(r, lazy);
+	    } else if (strcmp(key, "servers") == 0 && json_peek(r) == JSON_VALUE_ARRAY) {
+		have_servers = 1;
+		json_read_array(r);
+		while (json_read_next(r)) {
+		    /* before the count is known, growth is held to the records read */
+		    int limit = have_count ? server_count : 2 * records + SAVE_JSON_ID_SLACK;
+		    records++;
+		    if (!read_server(r, &rec) || !apply_server(&rec, st, lg, limit)) {
+			r->failed = 1;
+			break;
+		    }
+		}
+	    } else {
+		json_skip(r);
+	    }
+	}
+    }
+    free(rec.links);
+
+    bool ok = json_reader_ok(r) && have_game && have_count && have_servers && server_count > 0 &&
+              st->count > 0 && st->count <= server_count && home >= 0 && home < st->count &&
+              current >= 0 && current < st->count && link_graph_freeze(lg, st->count) == CORE_OK;
+    /* a lazy world must have been planned from params that fit the store */
+    ok = ok && (!lazy || lazy->expanded_count < 0 || generator_params_valid(&lazy->params, st->count));
+    if (!ok) {
+	generator_lazy_state_free(lazy);
+	return false;
+    }
+    *home_server = home;
+    *current_server = current;
+    return true;
+}
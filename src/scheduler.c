@@ -0,0 +1,129 @@
+#include "scheduler.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SLOT_MASK (SCHED_SLOTS - 1)
+
+static void slot_clear(SchedSlot* slot) {
+    slot->head = -1;
+    slot->tail = -1;
+}
+
+static void slot_push(Scheduler* s, SchedSlot* slot, int32_t ev) {
+    s->events[ev].next = -1;
+    if (slot->tail < 0) {
+	slot->head = ev;
+    } else {
+	s->events[slot->tail].next = ev;
+    }
+    slot->tail = ev;
+}
+
+void scheduler_init(Scheduler* s, uint64_t now) {
+    if (!s) return;
+    for (int l = 0; l < SCHED_LEVELS; l++) {
+	for (int i = 0; i < SCHED_SLOTS; i++) slot_clear(&s->wheel[l][i]);
+    }
+    slot_clear(&s->overflow);
+    s->events = NULL;
+    s->cap = 0;
+    s->free_head = -1;
+    s->pending = 0;
+    s->now = now;
+}
+
+void scheduler_free(Scheduler* s) {
+    if (!s) return;
+    free(s->events);
+    scheduler_init(s, s->now);
+}
+
+static int32_t event_alloc(Scheduler* s) {
+    if (s->free_head < 0) {
+	int32_t cap = s->cap ? s->cap * 2 : 64;
+	if (cap <= s->cap) return -1;
+	SchedEvent* grown = realloc(s->events, (size_t)cap * sizeof(*grown));
+	if (!grown) return -1;
+	for (int32_t i = s->cap; i < cap; i++) grown[i].next = (i + 1 < cap) ? i + 1 : -1;
+	s->events = grown;
+	s->free_head = s->cap;
+	s->cap = cap;
+    }
+    int32_t ev = s->free_head;
+    s->free_head = s->events[ev].next;
+    return ev;
+}
+
+static void event_release(Scheduler* s, int32_t ev) {
+    s->events[ev].next = s->free_head;
+    s->free_head = ev;
+}
+
+/* Places an event on the lowest level whose range covers its delay. */
+static void wheel_insert(Scheduler* s, int32_t ev) {
+    uint64_t due = s->events[ev].due;
+    uint64_t delta = due - s->now;
+    for (int l = 0; l < SCHED_LEVELS; l++) {
+	int shift = SCHED_SLOT_BITS * l;
+	if (delta < (1ull << (shift + SCHED_SLOT_BITS))) {
+	    slot_push(s, &s->wheel[l][(due >> shift) & SLOT_MASK], ev);
+	    return;
+	}
+    }
+    slot_push(s, &s->overflow, ev);
+}
+
+/* Re-inserts every event of a slot relative to the current tick. */
+static void cascade(Scheduler* s, SchedSlot* slot) {
+    int32_t ev = slot->head;
+    slot_clear(slot);
+    while (ev >= 0) {
+	int32_t next = s->events[ev].next;
+	wheel_insert(s, ev);
+	ev = next;
+    }
+}
+
+CoreResult scheduler_schedule(Scheduler* s, Action a, uint32_t delay) {
+    if (!s) return CORE_ERR_INVALID_ARG;
+    int32_t ev = event_alloc(s);
+    if (ev < 0) return CORE_ERR_UNKNOWN;
+    s->events[ev].action = a;
+    s->events[ev].due = s->now + (delay ? delay : 1);
+    wheel_insert(s, ev);
+    s->pending++;
+    return CORE_OK;
+}
+
+int scheduler_advance(Scheduler* s, SchedFireFn fire, void* ctx) {
+    if (!s) return 0;
+    s->now++;
+
+    /* when a level wraps, pull the next slot of the level above down */
+    for (int l = 1; l < SCHED_LEVELS; l++) {
+	int shift = SCHED_SLOT_BITS * l;
+	if (s->now & ((1ull << shift) - 1)) break;
+	cascade(s, &s->wheel[l][(s->now >> shift) & SLOT_MASK]);
+    }
+    if ((s->now & ((1ull << (SCHED_SLOT_BITS * SCHED_LEVELS)) - 1)) == 0) {
+	cascade(s, &s->overflow);
+    }
+
+    /* detach the due slot first so callbacks can schedule freely */
+    SchedSlot* slot = &s->wheel[0][s->now & SLOT_MASK];
+    int32_t ev = slot->head;
+    slot_clear(slot);
+
+    int fired = 0;
+    while (ev >= 0) {
+	int32_t next = s->events[ev].next;
+	Action a = s->events[ev].action;
+	event_release(s, ev);
+	s->pending--;
+	fired++;
+	if (fire) fire(ctx, &a);
+	ev = next;
+    }
+    return fired;
+}
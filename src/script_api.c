@@ -30,6 +30,8 @@ static const char* core_result_to_string(CoreResult r) {
 	    return "FILE_ERROR";
 	case CORE_ERR_INVALID_ARG:
 	    return "INVALID_ARG";
+	case CORE_ERR_BUSY:
+	    return "BUSY";
 	default:
 	    return "UNKNOWN";
     }
@@ -43,14 +45,14 @@ static int l_game_scan(lua_State* L) {
 	return 2;
     }
     int n = 0;
-    ServerId* ids = core_scan(g_state, &n);
+    const ServerId* ids = core_scan(g_state, &n);
     lua_newtable(L);
     for (int i = 0; i < n; i++) {
 	ServerId id = ids[i];
-	Server* s = game_get_server(g_state, id);
+	const char* name = game_server_name(g_state, id);
 	lua_pushinteger(L, i + 1);
-	if (s)
-	    lua_pushstring(L, s->name);
+	if (name)
+	    lua_pushstring(L, name);
 	else
 	    lua_pushnil(L);
 	lua_settable(L, -3);
@@ -83,6 +85,63 @@ static int l_game_connect(lua_State* L) {
     return 3;
 }
 
+/* net.route(from, to) -> table of server names (from first) | nil, errmsg, code */
+static int l_game_route(lua_State* L) {
+    if (!g_state) {
+	lua_pushnil(L);
+	lua_pushstring(L, "no game state");
+	return 2;
+    }
+    const char* from = lua_tostring(L, 1);
+    const char* to = lua_tostring(L, 2);
+    if (!from || !to) {
+	lua_pushnil(L);
+	lua_pushstring(L, "expected two string arguments");
+	return 2;
+    }
+    const ServerId* path = NULL;
+    int len = 0;
+    CoreResult cr = core_route(g_state, from, to, &path, &len);
+    if (cr != CORE_OK) {
+	lua_pushnil(L);
+	lua_pushstring(L, core_result_to_string(cr));
+	lua_pushinteger(L, (int)cr);
+	return 3;
+    }
+    lua_createtable(L, len, 0);
+    for (int i = 0; i < len; i++) {
+	lua_pushstring(L, game_server_name(g_state, path[i]));
+	lua_rawseti(L, -2, i + 1);
+    }
+    return 1;
+}
+
+/* net.distance(from, to) -> hop count | nil, errmsg, code */
+static int l_game_distance(lua_State* L) {
+    if (!g_state) {
+	lua_pushnil(L);
+	lua_pushstring(L, "no game state");
+	return 2;
+    }
+    const char* from = lua_tostring(L, 1);
+    const char* to = lua_tostring(L, 2);
+    if (!from || !to) {
+	lua_pushnil(L);
+	lua_pushstring(L, "expected two string arguments");
+	return 2;
+    }
+    int hops = 0;
+    CoreResult cr = core_distance(g_state, from, to, &hops);
+    if (cr != CORE_OK) {
+	lua_pushnil(L);
+	lua_pushstring(L, core_result_to_string(cr));
+	lua_pushinteger(L, (int)cr);
+	return 3;
+    }
+    lua_pushinteger(L, hops);
+    return 1;
+}
+
 /* game.save(path) -> true | false, errmsg, code */
 static int l_game_save(lua_State* L) {
     if (!g_state) {
@@ -114,23 +173,24 @@ static int l_game_get_current(lua_State* L) {
 	lua_pushnil(L);
 	return 1;
     }
-    Server* s = game_get_current_server(g_state);
-    if (!s) {
+    const ServerStore* st = &g_state->servers;
+    ServerId id = g_state->current_server;
+    if (!server_valid(st, id)) {
 	lua_pushnil(L);
 	return 1;
     }
     lua_newtable(L);
     lua_pushstring(L, "id");
-    lua_pushinteger(L, s->id);
+    lua_pushinteger(L, id);
     lua_settable(L, -3);
     lua_pushstring(L, "name");
-    lua_pushstring(L, s->name);
+    lua_pushstring(L, server_name(st, id));
     lua_settable(L, -3);
     lua_pushstring(L, "security");
-    lua_pushinteger(L, s->security);
+    lua_pushinteger(L, server_security(st, id));
     lua_settable(L, -3);
     lua_pushstring(L, "money");
-    lua_pushinteger(L, s->money);
+    lua_pushinteger(L, server_money(st, id));
     lua_settable(L, -3);
     return 1;
 }
@@ -145,9 +205,9 @@ static int l_game_list_servers(lua_State* L) {
 	return 2;
     }
     lua_newtable(L);
-    for (int i = 0; i < g_state->server_count; i++) {
+    for (int i = 0; i < game_server_count(g_state); i++) {
 	lua_pushinteger(L, i + 1);
-	lua_pushstring(L, g_state->servers[i].name);
+	lua_pushstring(L, game_server_name(g_state, i));
 	lua_settable(L, -3);
     }
     return 1;
@@ -219,6 +279,10 @@ int script_api_register(lua_State* L) {
     lua_setfield(L, -2, "get_current");
     lua_pushcfunction(L, l_game_list_servers);
     lua_setfield(L, -2, "list_servers");
+    lua_pushcfunction(L, l_game_route);
+    lua_setfield(L, -2, "route");
+    lua_pushcfunction(L, l_game_distance);
+    lua_setfield(L, -2, "distance");
     /* ht.net = net */
     lua_setfield(L, -2, "net"); /* pops net */
 
@@ -1,37 +1,14 @@
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <limits.h>
+#include <sys/mman.h>
 
 #include "server.h"
-#include "game.h"
 #include "core_result.h"
 
 #include <ctype.h>
 
-/* Initialises a server with a given name and sets default values */
-void server_init(Server* s, ServerId id, const char* name) {
-    if (!s) return;
-
-    s->id = id;
-
-    if (name) {
-	strncpy(s->name, name, SERVER_NAME_LEN - 1);
-	s->name[SERVER_NAME_LEN - 1] = '\0';
-    } else {
-	s->name[0] = '\0';
-    }
-
-    // Ser defaults
-    s->security = 1;
-    s->money = 0;
-
-    // topology
-    s->link_count = 0;
-    s->service_count = 0;
-    // unused as of now
-    s->subnet_id = -1;
-    s->type = SERVER_TYPE_UNKNOWN;
-}
-
 const char* server_type_to_string(ServerType t) {
     switch (t) {
         case SERVER_TYPE_ISP: return "isp";
@@ -84,18 +61,727 @@ ServerType server_type_from_string(const char* s) {
     return SERVER_TYPE_UNKNOWN;
 }
 
-/* Generates a random server and returns its Id */
-ServerId server_generate_random(Server* servers, int* server_count, const char* name) {
-    if (!servers || !server_count || *server_count >= MAX_SERVERS) return SERVER_INVALID_ID;
-    ServerId id = *server_count;
-    server_init(&servers[id], id, name);
+/* ---------------- STORE ---------------- */
+
+void server_store_init(ServerStore* store) {
+    if (!store) return;
+    memset(store, 0, sizeof(*store));
+}
+
+void server_store_free(ServerStore* store) {
+    if (!store) return;
+    if (store->map) {
+	munmap(store->map, store->map_len);
+	server_store_init(store);
+	return;
+    }
+    free(store->type);
+    free(store->security);
+    free(store->money);
+    free(store->subnet_id);
+    free(store->name_off);
+    free(store->coord);
+    free(store->names);
+    free(store->svc_first);
+    free(store->svc_count);
+    free(store->services);
+    free(store->name_slots);
+    server_store_init(store);
+}
+
+static int grow_column(void* column, size_t elem, int cap) {
+    void** p = column;
+    void* grown = realloc(*p, (size_t)cap * elem);
+    if (!grown) return 0;
+    *p = grown;
+    return 1;
+}
+
+/* Heap copy of `n` elements of a mapped column (NULL stays NULL). */
+static int detach_column(void* column, size_t elem, size_t n) {
+    void** p = column;
+    if (!*p) return 1;
+    void* copy = malloc(n ? n * elem : 1);
+    if (!copy) return 0;
+    memcpy(copy, *p, n * elem);
+    *p = copy;
+    return 1;
+}
+
+/* Moves a store that lives in a file mapping onto the heap, so its
+ * columns and pools can be reallocated. */
+static int store_detach(ServerStore* store) {
+    if (!store->map) return 1;
+    ServerStore heap = *store;
+    size_t n = (size_t)store->count;
+    size_t slots = store->name_slots ? (size_t)store->name_mask + 1 : 0;
+    int ok = detach_column(&heap.type, sizeof(*heap.type), n) &&
+             detach_column(&heap.security, sizeof(*heap.security), n) &&
+             detach_column(&heap.money, sizeof(*heap.money), n) &&
+             detach_column(&heap.subnet_id, sizeof(*heap.subnet_id), n) &&
+             detach_column(&heap.name_off, sizeof(*heap.name_off), n) &&
+             detach_column(&heap.coord, sizeof(*heap.coord), n) &&
+             detach_column(&heap.svc_first, sizeof(*heap.svc_first), n) &&
+             detach_column(&heap.svc_count, sizeof(*heap.svc_count), n) &&
+             detach_column(&heap.names, 1, store->names_len) &&
+             detach_column(&heap.services, sizeof(*heap.services), store->services_len) &&
+             detach_column(&heap.name_slots, sizeof(*heap.name_slots), slots);
+    if (!ok) {
+	/* free whatever was copied; the mapped store is untouched */
+	void* copies[] = { heap.type, heap.security, heap.money, heap.subnet_id, heap.name_off, heap.coord,
+	                   heap.svc_first, heap.svc_count, heap.names, heap.services, heap.name_slots };
+	void* mapped[] = { store->type, store->security, store->money, store->subnet_id, store->name_off,
+	                   store->coord, store->svc_first, store->svc_count, store->names, store->services,
+	                   store->name_slots };
+	for (size_t i = 0; i < sizeof(copies) / sizeof(copies[0]); i++) {
+	    if (copies[i] != mapped[i]) free(copies[i]);
+	}
+	return 0;
+    }
+    munmap(store->map, store->map_len);
+    heap.map = NULL;
+    heap.map_len = 0;
+    heap.cap = store->count;
+    heap.names_cap = store->names_len;
+    heap.services_cap = store->services_len;
+    *store = heap;
+    return 1;
+}
+
+/* Grows every column to hold at least `need` servers (doubling). */
+static int server_store_reserve(ServerStore* store, int need) {
+    if (need <= store->cap) return 1;
+    if (!store_detach(store)) return 0;
+    int cap = store->cap ? store->cap : 1024;
+    while (cap < need) cap = cap > INT_MAX / 2 ? INT_MAX : cap * 2;
+    if (!grow_column(&store->type, sizeof(*store->type), cap)) return 0;
+    if (!grow_column(&store->security, sizeof(*store->security), cap)) return 0;
+    if (!grow_column(&store->money, sizeof(*store->money), cap)) return 0;
+    if (!grow_column(&store->subnet_id, sizeof(*store->subnet_id), cap)) return 0;
+    if (!grow_column(&store->name_off, sizeof(*store->name_off), cap)) return 0;
+    if (!grow_column(&store->coord, sizeof(*store->coord), cap)) return 0;
+    if (!grow_column(&store->svc_first, sizeof(*store->svc_first), cap)) return 0;
+    if (!grow_column(&store->svc_count, sizeof(*store->svc_count), cap)) return 0;
+    store->cap = cap;
+    return 1;
+}
+
+/* Appends a NUL-terminated copy of `name` (truncated to SERVER_NAME_LEN - 1)
+ * to the string pool. Offset 0 always holds the empty string. */
+static int name_pool_intern(ServerStore* store, const char* name, uint32_t* out_off) {
+    if (store->names_len == 0) {
+	store->names = malloc(4096);
+	if (!store->names) return 0;
+	store->names_cap = 4096;
+	store->names[0] = '\0';
+	store->names_len = 1;
+    }
+    size_t len = name ? strnlen(name, SERVER_NAME_LEN - 1) : 0;
+    if (len == 0) {
+	*out_off = 0;
+	return 1;
+    }
+    if (store->names_len + len + 1 > UINT32_MAX) return 0;
+    if (store->names_len + len + 1 > store->names_cap) {
+	if (!store_detach(store)) return 0;
+	size_t cap = store->names_cap * 2;
+	char* grown = realloc(store->names, cap);
+	if (!grown) return 0;
+	store->names = grown;
+	store->names_cap = cap;
+    }
+    *out_off = (uint32_t)store->names_len;
+    memcpy(store->names + store->names_len, name, len);
+    store->names[store->names_len + len] = '\0';
+    store->names_len += len + 1;
+    return 1;
+}
+
+/* ---------------- IMPLICIT NAMES ---------------- */
+
+/* Packed layout: kind in the top 4 bits; users keep their number in the
+ * low 32 bits, every other kind packs isp:16 area:8 neigh:10 building:10
+ * floor:8 router:8. Fields a kind does not use stay 0. */
+#define COORD_KIND_SHIFT 60
+
+static int coord_field(uint64_t* packed, int v, int bits, int shift) {
+    if (v < 0 || v >= (1 << bits)) return 0;
+    *packed |= (uint64_t)v << shift;
+    return 1;
+}
+
+/* Returns 0 if the coordinate does not fit. */
+static uint64_t coord_pack(const ServerCoord* c) {
+    if (c->kind <= SERVER_NAME_STORED || c->kind > SERVER_NAME_USER) return 0;
+    uint64_t packed = (uint64_t)c->kind << COORD_KIND_SHIFT;
+    if (c->kind == SERVER_NAME_USER) return c->user >= 0 ? packed | (uint32_t)c->user : 0;
+    int ok = coord_field(&packed, c->isp, 16, 44);
+    if (c->kind != SERVER_NAME_ISP) ok = ok && coord_field(&packed, c->area, 8, 36);
+    if (c->kind >= SERVER_NAME_NEIGH) ok = ok && coord_field(&packed, c->neigh, 10, 26);
+    if (c->kind >= SERVER_NAME_BUILDING) ok = ok && coord_field(&packed, c->building, 10, 16);
+    if (c->kind == SERVER_NAME_FLOOR || c->kind == SERVER_NAME_FLOOR_ROUTER) {
+	ok = ok && coord_field(&packed, c->floor, 8, 8);
+    }
+    if (c->kind == SERVER_NAME_ROUTER || c->kind == SERVER_NAME_FLOOR_ROUTER) {
+	ok = ok && coord_field(&packed, c->router, 8, 0);
+    }
+    return ok ? packed : 0;
+}
+
+static ServerCoord coord_unpack(uint64_t packed) {
+    ServerCoord c;
+    memset(&c, 0, sizeof(c));
+    c.kind = (ServerNameKind)(packed >> COORD_KIND_SHIFT);
+    if (c.kind == SERVER_NAME_USER) {
+	c.user = (int)(uint32_t)packed;
+	return c;
+    }
+    c.isp = (int)(packed >> 44 & 0xffff);
+    c.area = (int)(packed >> 36 & 0xff);
+    c.neigh = (int)(packed >> 26 & 0x3ff);
+    c.building = (int)(packed >> 16 & 0x3ff);
+    c.floor = (int)(packed >> 8 & 0xff);
+    c.router = (int)(packed & 0xff);
+    return c;
+}
+
+int server_coord_format(const ServerCoord* c, char* buf, size_t len) {
+    if (!c) return -1;
+    switch (c->kind) {
+	case SERVER_NAME_ISP:
+	    return snprintf(buf, len, "isp%d", c->isp);
+	case SERVER_NAME_AREA:
+	    return snprintf(buf, len, "area%d_i%d", c->area, c->isp);
+	case SERVER_NAME_NEIGH:
+	    return snprintf(buf, len, "neigh%d_a%d_p%d", c->neigh, c->area, c->isp);
+	case SERVER_NAME_BUILDING:
+	    return snprintf(buf, len, "bld%d_n%d_a%d_p%d", c->building, c->neigh, c->area, c->isp);
+	case SERVER_NAME_FLOOR:
+	    return snprintf(buf, len, "floor%d_b%d_n%d_a%d_p%d", c->floor, c->building, c->neigh, c->area,
+	                    c->isp);
+	case SERVER_NAME_ROUTER:
+	    return snprintf(buf, len, "rtr_b%d_n%d_a%d_p%d_r%d", c->building, c->neigh, c->area, c->isp,
+	                    c->router);
+	case SERVER_NAME_FLOOR_ROUTER:
+	    return snprintf(buf, len, "rtr_floor%d_b%d_n%d_a%d_p%d_r%d", c->floor, c->building, c->neigh,
+	                    c->area, c->isp, c->router);
+	case SERVER_NAME_USER:
+	    return snprintf(buf, len, "usr%d", c->user);
+	default:
+	    return -1;
+    }
+}
+
+int server_coord_parse(const char* name, ServerCoord* out) {
+    if (!name || !out) return 0;
+    ServerCoord c;
+    memset(&c, 0, sizeof(c));
+    int end = -1;
+    /* every pattern starts with a distinct prefix; "rtr_floor" before "rtr_b" */
+    if (sscanf(name, "rtr_floor%d_b%d_n%d_a%d_p%d_r%d%n", &c.floor, &c.building, &c.neigh, &c.area,
+               &c.isp, &c.router, &end) == 6) {
+	c.kind = SERVER_NAME_FLOOR_ROUTER;
+    } else if (sscanf(name, "rtr_b%d_n%d_a%d_p%d_r%d%n", &c.building, &c.neigh, &c.area, &c.isp,
+                      &c.router, &end) == 5) {
+	c.kind = SERVER_NAME_ROUTER;
+    } else if (sscanf(name, "floor%d_b%d_n%d_a%d_p%d%n", &c.floor, &c.building, &c.neigh, &c.area,
+                      &c.isp, &end) == 5) {
+	c.kind = SERVER_NAME_FLOOR;
+    } else if (sscanf(name, "bld%d_n%d_a%d_p%d%n", &c.building, &c.neigh, &c.area, &c.isp, &end) == 4) {
+	c.kind = SERVER_NAME_BUILDING;
+    } else if (sscanf(name, "neigh%d_a%d_p%d%n", &c.neigh, &c.area, &c.isp, &end) == 3) {
+	c.kind = SERVER_NAME_NEIGH;
+    } else if (sscanf(name, "area%d_i%d%n", &c.area, &c.isp, &end) == 2) {
+	c.kind = SERVER_NAME_AREA;
+    } else if (sscanf(name, "isp%d%n", &c.isp, &end) == 1) {
+	c.kind = SERVER_NAME_ISP;
+    } else if (sscanf(name, "usr%d%n", &c.user, &end) == 1) {
+	c.kind = SERVER_NAME_USER;
+    } else {
+	return 0;
+    }
+    if (end < 0 || name[end] != '\0') return 0;
+
+    /* reject what sscanf tolerates but formatting never writes */
+    char buf[80];
+    int len = server_coord_format(&c, buf, sizeof(buf));
+    if (len != end || strcmp(buf, name) != 0) return 0;
+    *out = c;
+    return 1;
+}
+
+/* ---------------- NAME INDEX ---------------- */
+
+/* FNV-1a */
+static uint32_t name_hash(const char* s) {
+    uint32_t h = 2166136261u;
+    while (*s) {
+	h ^= (unsigned char)*s++;
+	h *= 16777619u;
+    }
+    return h;
+}
+
+/* splitmix64 finalizer */
+static uint32_t coord_hash(uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return (uint32_t)(x ^ (x >> 31));
+}
+
+/* What the index is keyed on: a packed coordinate for an implicit name,
+ * otherwise the stored string. An implicit name never matches a stored
+ * string, even one that reads the same. */
+typedef struct {
+    const char* name;
+    uint64_t coord;
+    uint32_t hash;
+} NameKey;
+
+static NameKey name_key_stored(const char* name) {
+    NameKey k = { name, 0, name_hash(name) };
+    return k;
+}
+
+static NameKey name_key_coord(uint64_t coord) {
+    NameKey k = { NULL, coord, coord_hash(coord) };
+    return k;
+}
+
+static NameKey name_key_of(const ServerStore* store, ServerId id) {
+    if (store->coord[id]) return name_key_coord(store->coord[id]);
+    return name_key_stored(store->names + store->name_off[id]);
+}
+
+static int name_key_empty(const NameKey* k) {
+    return !k->coord && !k->name[0];
+}
+
+static int name_key_match(const ServerStore* store, ServerId id, const NameKey* k) {
+    if (store->coord[id] != k->coord) return 0;
+    return k->coord || strcmp(store->names + store->name_off[id], k->name) == 0;
+}
+
+/* Finds the slot holding `k`, or the empty slot where it would go. */
+static uint32_t name_index_probe(const ServerStore* store, const NameKey* k, int* found) {
+    uint32_t i = k->hash & store->name_mask;
+    while (store->name_slots[i].id != SERVER_INVALID_ID) {
+	if (store->name_slots[i].hash == k->hash && name_key_match(store, store->name_slots[i].id, k)) {
+	    *found = 1;
+	    return i;
+	}
+	i = (i + 1) & store->name_mask;
+    }
+    *found = 0;
+    return i;
+}
+
+static int name_index_grow(ServerStore* store) {
+    if (!store_detach(store)) return 0;
+    uint32_t cap = store->name_slots ? (store->name_mask + 1) * 2 : 1024;
+    if (cap == 0) return 0;
+    NameSlot* slots = malloc((size_t)cap * sizeof(*slots));
+    if (!slots) return 0;
+    for (uint32_t i = 0; i < cap; i++) slots[i].id = SERVER_INVALID_ID;
+    if (store->name_slots) {
+	for (uint32_t i = 0; i <= store->name_mask; i++) {
+	    NameSlot e = store->name_slots[i];
+	    if (e.id == SERVER_INVALID_ID) continue;
+	    uint32_t j = e.hash & (cap - 1);
+	    while (slots[j].id != SERVER_INVALID_ID) j = (j + 1) & (cap - 1);
+	    slots[j] = e;
+	}
+    }
+    free(store->name_slots);
+    store->name_slots = slots;
+    store->name_mask = cap - 1;
+    return 1;
+}
+
+static int name_index_insert(ServerStore* store, ServerId id) {
+    NameKey k = name_key_of(store, id);
+    if (name_key_empty(&k)) return 1; /* unnamed servers are not reachable by name */
+    if (!store->name_slots || (store->name_used + 1) * 4 > (store->name_mask + 1) * 3) {
+	if (!name_index_grow(store)) return 0;
+    }
+    int found = 0;
+    uint32_t i = name_index_probe(store, &k, &found);
+    if (found) {
+	/* keep the lowest id so lookups match a first-to-last scan */
+	if (id < store->name_slots[i].id) store->name_slots[i].id = id;
+	store->name_dups++;
+	return 1;
+    }
+    store->name_slots[i].hash = k.hash;
+    store->name_slots[i].id = id;
+    store->name_used++;
+    return 1;
+}
+
+/* Drops `id`'s current name from the index (backward-shift deletion).
+ * Must run before the name changes. */
+static void name_index_remove(ServerStore* store, ServerId id) {
+    NameKey k = name_key_of(store, id);
+    if (name_key_empty(&k) || !store->name_slots) return;
+    int found = 0;
+    uint32_t i = name_index_probe(store, &k, &found);
+    if (!found) return;
+    if (store->name_slots[i].id != id) {
+	/* `id` was a duplicate; the indexed owner is unaffected */
+	store->name_dups--;
+	return;
+    }
+
+    uint32_t j = i;
+    for (;;) {
+	j = (j + 1) & store->name_mask;
+	if (store->name_slots[j].id == SERVER_INVALID_ID) break;
+	uint32_t h = store->name_slots[j].hash & store->name_mask;
+	/* move j back into the hole unless its home slot lies in (i, j] */
+	int in_range = (i <= j) ? (i < h && h <= j) : (i < h || h <= j);
+	if (!in_range) {
+	    store->name_slots[i] = store->name_slots[j];
+	    i = j;
+	}
+    }
+    store->name_slots[i].id = SERVER_INVALID_ID;
+    store->name_used--;
+
+    /* hand the name to the next server sharing it, if any */
+    if (store->name_dups > 0) {
+	for (ServerId o = 0; o < store->count; o++) {
+	    if (o != id && name_key_match(store, o, &k)) {
+		store->name_dups--;
+		name_index_insert(store, o);
+		break;
+	    }
+	}
+    }
+}
+
+static ServerId name_index_find(const ServerStore* store, const NameKey* k) {
+    int found = 0;
+    uint32_t i = name_index_probe(store, k, &found);
+    return found ? store->name_slots[i].id : SERVER_INVALID_ID;
+}
+
+ServerId server_find_by_name(const ServerStore* store, const char* name) {
+    if (!store || !name || !name[0] || !store->name_slots) return SERVER_INVALID_ID;
+    NameKey k = name_key_stored(name);
+    ServerId id = name_index_find(store, &k);
+    ServerCoord c;
+    uint64_t packed;
+    if (server_coord_parse(name, &c) && (packed = coord_pack(&c)) != 0) {
+	k = name_key_coord(packed);
+	ServerId implicit = name_index_find(store, &k);
+	if (implicit != SERVER_INVALID_ID && (id == SERVER_INVALID_ID || implicit < id)) id = implicit;
+    }
+    return id;
+}
+
+int server_name_duplicates(const ServerStore* store) {
+    return store ? store->name_dups : 0;
+}
+
+ServerId server_store_add(ServerStore* store, const char* name) {
+    if (!store || store->count == INT_MAX) return SERVER_INVALID_ID;
+    ServerId id = store->count;
+    uint32_t off = 0;
+    if (!server_store_reserve(store, id + 1)) return SERVER_INVALID_ID;
+    if (!name_pool_intern(store, name, &off)) return SERVER_INVALID_ID;
+
+    store->type[id] = SERVER_TYPE_UNKNOWN;
+    store->security[id] = 1;
+    store->money[id] = 0;
+    store->subnet_id[id] = -1;
+    store->name_off[id] = off;
+    store->coord[id] = 0;
+    store->svc_first[id] = 0;
+    store->svc_count[id] = 0;
+    store->count++;
+    if (!name_index_insert(store, id)) {
+	store->count--;
+	return SERVER_INVALID_ID;
+    }
+    return id;
+}
+
+ServerId server_store_add_coord(ServerStore* store, const ServerCoord* coord) {
+    if (!store || !coord) return SERVER_INVALID_ID;
+    uint64_t packed = coord_pack(coord);
+    if (!packed) {
+	char buf[80];
+	if (server_coord_format(coord, buf, sizeof(buf)) < 0) buf[0] = '\0';
+	return server_store_add(store, buf);
+    }
+    ServerId id = server_store_add(store, NULL);
+    if (id == SERVER_INVALID_ID) return SERVER_INVALID_ID;
+    store->coord[id] = packed;
+    if (!name_index_insert(store, id)) {
+	store->count--;
+	return SERVER_INVALID_ID;
+    }
+    return id;
+}
+
+CoreResult server_store_resize(ServerStore* store, int count) {
+    if (!store || count < 0) return CORE_ERR_INVALID_ARG;
+    if (!server_store_reserve(store, count)) return CORE_ERR_UNKNOWN;
+    while (store->count < count) {
+	if (server_store_add(store, NULL) == SERVER_INVALID_ID) return CORE_ERR_UNKNOWN;
+    }
+    return CORE_OK;
+}
+
+CoreResult server_store_append(ServerStore* dst, const ServerStore* src) {
+    if (!dst || !src || dst == src) return CORE_ERR_INVALID_ARG;
+    if (src->count == 0) return CORE_OK;
+    if (src->count > INT_MAX - dst->count) return CORE_ERR_UNKNOWN;
+    ServerId base = dst->count;
+    int n = src->count;
+    if (!server_store_reserve(dst, base + n)) return CORE_ERR_UNKNOWN;
+
+    /* copy the name pool in one piece (src offset 0 is the shared empty
+     * string) and shift every offset past it */
+    size_t name_bytes = src->names_len > 1 ? src->names_len - 1 : 0;
+    uint32_t name_shift = 0;
+    if (name_bytes > 0) {
+	uint32_t empty = 0;
+	/* interning the empty name sets up an empty pool */
+	if (!name_pool_intern(dst, NULL, &empty)) return CORE_ERR_UNKNOWN;
+	if (dst->names_len + name_bytes > UINT32_MAX) return CORE_ERR_UNKNOWN;
+	if (dst->names_len + name_bytes > dst->names_cap) {
+	    if (!store_detach(dst)) return CORE_ERR_UNKNOWN;
+	    size_t cap = dst->names_cap;
+	    while (cap < dst->names_len + name_bytes) cap *= 2;
+	    char* grown = realloc(dst->names, cap);
+	    if (!grown) return CORE_ERR_UNKNOWN;
+	    dst->names = grown;
+	    dst->names_cap = cap;
+	}
+	memcpy(dst->names + dst->names_len, src->names + 1, name_bytes);
+	name_shift = (uint32_t)dst->names_len - 1;
+	dst->names_len += name_bytes;
+    }
+
+    size_t need = dst->services_len + src->services_len;
+    if (need > UINT32_MAX) return CORE_ERR_UNKNOWN;
+    if (need > dst->services_cap) {
+	if (!store_detach(dst)) return CORE_ERR_UNKNOWN;
+	size_t cap = dst->services_cap ? dst->services_cap * 2 : 1024;
+	while (cap < need) cap *= 2;
+	Service* grown = realloc(dst->services, cap * sizeof(*grown));
+	if (!grown) return CORE_ERR_UNKNOWN;
+	dst->services = grown;
+	dst->services_cap = cap;
+    }
+    if (src->services_len > 0) {
+	memcpy(dst->services + dst->services_len, src->services, src->services_len * sizeof(*src->services));
+    }
+    uint32_t svc_shift = (uint32_t)dst->services_len;
+    dst->services_len = need;
+
+    memcpy(dst->type + base, src->type, (size_t)n * sizeof(*src->type));
+    memcpy(dst->security + base, src->security, (size_t)n * sizeof(*src->security));
+    memcpy(dst->money + base, src->money, (size_t)n * sizeof(*src->money));
+    memcpy(dst->subnet_id + base, src->subnet_id, (size_t)n * sizeof(*src->subnet_id));
+    memcpy(dst->coord + base, src->coord, (size_t)n * sizeof(*src->coord));
+    memcpy(dst->svc_count + base, src->svc_count, (size_t)n * sizeof(*src->svc_count));
+    for (int i = 0; i < n; i++) {
+	dst->name_off[base + i] = src->name_off[i] ? src->name_off[i] + name_shift : 0;
+	dst->svc_first[base + i] = src->svc_first[i] + svc_shift;
+    }
+
+    for (int i = 0; i < n; i++) {
+	dst->count++;
+	if (!name_index_insert(dst, base + i)) return CORE_ERR_UNKNOWN;
+    }
+    return CORE_OK;
+}
+
+CoreResult server_store_adopt_mapping(ServerStore* store, const ServerStore* view, void* map, size_t map_len) {
+    if (!store || !view || !map || view->count < 0) return CORE_ERR_INVALID_ARG;
+    size_t n = (size_t)view->count;
+    if (n > 0 && (!view->type || !view->security || !view->money || !view->subnet_id || !view->name_off ||
+                  !view->coord || !view->svc_first || !view->svc_count)) {
+	return CORE_ERR_INVALID_ARG;
+    }
+    /* offset 0 of the pool is the empty name, and the pool ends in a NUL */
+    if (view->names_len == 0 || view->names_len > UINT32_MAX || !view->names || view->names[0] != '\0' ||
+        view->names[view->names_len - 1] != '\0') {
+	return CORE_ERR_INVALID_ARG;
+    }
+    if (view->services_len > UINT32_MAX || (view->services_len > 0 && !view->services)) {
+	return CORE_ERR_INVALID_ARG;
+    }
+    for (size_t i = 0; i < n; i++) {
+	if (view->name_off[i] >= view->names_len) return CORE_ERR_INVALID_ARG;
+	if ((view->coord[i] >> COORD_KIND_SHIFT) > SERVER_NAME_USER) return CORE_ERR_INVALID_ARG;
+	if (view->svc_count[i] > MAX_SERVICES_PER_SERVER ||
+	    (size_t)view->svc_first[i] + view->svc_count[i] > view->services_len) {
+	    return CORE_ERR_INVALID_ARG;
+	}
+    }
+    for (size_t i = 0; i < view->services_len; i++) {
+	if (memchr(view->services[i].name, '\0', SERVICE_NAME_LEN) == NULL) return CORE_ERR_INVALID_ARG;
+    }
+    /* the index needs a free slot to end every probe */
+    if (view->name_slots) {
+	size_t slots = (size_t)view->name_mask + 1;
+	if ((slots & (slots - 1)) != 0 || view->name_used >= slots) return CORE_ERR_INVALID_ARG;
+	uint32_t used = 0;
+	for (size_t i = 0; i < slots; i++) {
+	    ServerId id = view->name_slots[i].id;
+	    if (id == SERVER_INVALID_ID) continue;
+	    if (id < 0 || (size_t)id >= n) return CORE_ERR_INVALID_ARG;
+	    used++;
+	}
+	if (used != view->name_used) return CORE_ERR_INVALID_ARG;
+    } else if (view->name_used != 0) {
+	return CORE_ERR_INVALID_ARG;
+    }
+
+    server_store_free(store);
+    *store = *view;
+    store->cap = view->count;
+    store->names_cap = view->names_len;
+    store->services_cap = view->services_len;
+    store->map = map;
+    store->map_len = map_len;
+    return CORE_OK;
+}
+
+int server_valid(const ServerStore* store, ServerId id) {
+    return store && id >= 0 && id < store->count;
+}
+
+/* ---------------- ACCESSORS ---------------- */
+
+/* Room for the longest implicit name; a handful of buffers lets a few
+ * names be used together, e.g. as arguments of one printf. */
+#define NAME_RING 8
+#define NAME_RING_LEN 64
+
+const char* server_name(const ServerStore* store, ServerId id) {
+    uint64_t packed = store->coord[id];
+    if (!packed) return store->names + store->name_off[id];
+    static _Thread_local char ring[NAME_RING][NAME_RING_LEN];
+    static _Thread_local unsigned next;
+    char* buf = ring[next++ % NAME_RING];
+    ServerCoord c = coord_unpack(packed);
+    server_coord_format(&c, buf, NAME_RING_LEN);
+    return buf;
+}
+
+ServerType server_type(const ServerStore* store, ServerId id) {
+    return (ServerType)store->type[id];
+}
+
+int server_security(const ServerStore* store, ServerId id) {
+    return store->security[id];
+}
+
+int server_money(const ServerStore* store, ServerId id) {
+    return store->money[id];
+}
+
+int server_subnet(const ServerStore* store, ServerId id) {
+    return store->subnet_id[id];
+}
+
+const Service* server_services(const ServerStore* store, ServerId id, int* out_count) {
+    *out_count = store->svc_count[id];
+    if (*out_count == 0) return NULL;
+    return store->services + store->svc_first[id];
+}
+
+CoreResult server_set_name(ServerStore* store, ServerId id, const char* name) {
+    if (!server_valid(store, id)) return CORE_ERR_INVALID_ARG;
+    uint32_t off = 0;
+    /* the old string stays in the pool; renames are rare */
+    if (!name_pool_intern(store, name, &off)) return CORE_ERR_UNKNOWN;
+    name_index_remove(store, id);
+    store->name_off[id] = off;
+    store->coord[id] = 0;
+    if (!name_index_insert(store, id)) return CORE_ERR_UNKNOWN;
+    return CORE_OK;
+}
+
+void server_set_type(ServerStore* store, ServerId id, ServerType type) {
+    store->type[id] = (uint8_t)type;
+}
+
+void server_set_security(ServerStore* store, ServerId id, int security) {
+    store->security[id] = security;
+}
+
+void server_set_money(ServerStore* store, ServerId id, int money) {
+    store->money[id] = money;
+}
+
+void server_set_subnet(ServerStore* store, ServerId id, int subnet_id) {
+    store->subnet_id[id] = subnet_id;
+}
+
+CoreResult server_add_service(ServerStore* store, ServerId id, int port, const char* name,
+                              int vuln_level) {
+    if (!server_valid(store, id)) return CORE_ERR_INVALID_ARG;
+    uint32_t n = store->svc_count[id];
+    if (n >= MAX_SERVICES_PER_SERVER) return CORE_ERR_INVALID_ARG;
+
+    /* A server's services must stay contiguous. Appending is free when they
+     * already sit at the end of the pool; otherwise move them there. */
+    int at_tail = (n == 0) || (store->svc_first[id] + n == store->services_len);
+    size_t need = store->services_len + (at_tail ? 1 : n + 1);
+    if (need > UINT32_MAX) return CORE_ERR_UNKNOWN;
+    if (need > store->services_cap) {
+	if (!store_detach(store)) return CORE_ERR_UNKNOWN;
+	size_t cap = store->services_cap ? store->services_cap * 2 : 1024;
+	while (cap < need) cap *= 2;
+	Service* grown = realloc(store->services, cap * sizeof(*grown));
+	if (!grown) return CORE_ERR_UNKNOWN;
+	store->services = grown;
+	store->services_cap = cap;
+    }
+    if (n == 0) {
+	store->svc_first[id] = (uint32_t)store->services_len;
+    } else if (!at_tail) {
+	memmove(store->services + store->services_len, store->services + store->svc_first[id],
+	        n * sizeof(*store->services));
+	store->svc_first[id] = (uint32_t)store->services_len;
+	store->services_len += n;
+    }
+
+    Service* svc = &store->services[store->svc_first[id] + n];
+    svc->port = port;
+    svc->vuln_level = vuln_level;
+    strncpy(svc->name, name ? name : "", SERVICE_NAME_LEN - 1);
+    svc->name[SERVICE_NAME_LEN - 1] = '\0';
+    store->services_len = store->svc_first[id] + n + 1;
+    store->svc_count[id] = (uint8_t)(n + 1);
+    return CORE_OK;
+}
+
+void server_clear_services(ServerStore* store, ServerId id) {
+    if (!server_valid(store, id)) return;
+    uint32_t n = store->svc_count[id];
+    /* reclaim the pool tail when the server owns it (e.g. just generated) */
+    if (n > 0 && store->svc_first[id] + n == store->services_len) {
+	store->services_len = store->svc_first[id];
+    }
+    store->svc_count[id] = 0;
+}
+
+/* Gives a freshly added server random stats and services */
+static ServerId randomize(ServerStore* store, ServerId id, Rng* rng) {
+    if (id == SERVER_INVALID_ID) return SERVER_INVALID_ID;
 
     // Random stats for testing
-    servers[id].security = 1 + rand() % 10;  // 1-10
-    servers[id].money = 100 + rand() % 900;  // 100-999
+    server_set_security(store, id, rng_range(rng, 1, 10));  // 1-10
+    server_set_money(store, id, rng_range(rng, 100, 999));  // 100-999
 
     /* Default generated servers are generic hosts. */
-    servers[id].type = SERVER_TYPE_HOST;
+    server_set_type(store, id, SERVER_TYPE_HOST);
     /* Specialized roles (web/app/db/etc.) were removed to keep backend types consistent
      * with the simplified topology-focused model.
      */
@@ -114,54 +800,24 @@ ServerId server_generate_random(Server* servers, int* server_count, const char*
     const int pool_n = sizeof(pool) / sizeof(pool[0]);
 
     /* decide number of services (0..2) */
-    int svc_count = rand() % 3;
+    int svc_count = (int)rng_below(rng, 3);
     if (svc_count > MAX_SERVICES_PER_SERVER) svc_count = MAX_SERVICES_PER_SERVER;
     for (int i = 0; i < svc_count; i++) {
-        int pick = rand() % pool_n;
-        servers[id].services[i].port = pool[pick].port;
-        servers[id].services[i].vuln_level = pool[pick].base_vuln + (rand() % 3); /* small variance */
-        strncpy(servers[id].services[i].name, pool[pick].name, SERVICE_NAME_LEN - 1);
-        servers[id].services[i].name[SERVICE_NAME_LEN - 1] = '\0';
+        int pick = (int)rng_below(rng, (uint32_t)pool_n);
+        int vuln = pool[pick].base_vuln + (int)rng_below(rng, 3); /* small variance */
+        server_add_service(store, id, pool[pick].port, pool[pick].name, vuln);
     }
-    servers[id].service_count = svc_count;
 
-    (*server_count)++;
     return id;
 }
 
-/* Links first server to second */
-CoreResult server_add_link(Server* s, ServerId to) {
-    if (!s) return CORE_ERR_INVALID_ARG;
-    if (s->link_count >= SERVER_MAX_LINKS) return CORE_ERR_UNKNOWN;
-
-    // prevent duplicate links
-    for (int i = 0; i < s->link_count; i++) {
-	if (s->links[i].to == to) {
-	    return CORE_OK;  // already linked, treat as success
-	}
-    }
-
-    s->links[s->link_count].to = to;
-    s->link_count++;
-
-    return CORE_OK;
-}
-
-/* Untested bidirectional link */
-CoreResult server_link_bidirectional(Server* a, Server* b) {
-    if (!a || !b) return CORE_ERR_INVALID_ARG;
-    if (a->id == b->id) return CORE_ERR_INVALID_ARG;
-
-    if (server_add_link(a, b->id) != CORE_OK) return CORE_ERR_UNKNOWN;
-    if (server_add_link(b, a->id) != CORE_OK) return CORE_ERR_UNKNOWN;
-
-    return CORE_OK;
+/* Generates a random server and returns its Id */
+ServerId server_generate_random(ServerStore* store, const char* name, Rng* rng) {
+    if (!store || !rng) return SERVER_INVALID_ID;
+    return randomize(store, server_store_add(store, name), rng);
 }
 
-/* Returns an array of asdfasfdasdfa*/
-const Server* server_get_linked(const Server* s, const Server* all, int index) {
-    if (!s || index < 0 || index >= s->link_count) return NULL;
-
-    ServerId id = s->links[index].to;
-    return &all[id];
+ServerId server_generate_random_coord(ServerStore* store, const ServerCoord* coord, Rng* rng) {
+    if (!store || !rng) return SERVER_INVALID_ID;
+    return randomize(store, server_store_add_coord(store, coord), rng);
 }
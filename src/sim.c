@@ -0,0 +1,229 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "sim.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "commands.h"
+#include "spsc.h"
+#include "ui.h"
+
+#define SIM_COMMAND_SLOTS 64
+#define SIM_EVENT_SLOTS 1024
+
+typedef struct {
+    char line[SIM_TEXT_MAX];
+} SimCommand;
+
+struct Sim {
+    GameState* game;
+    uint64_t tick_ns;
+    SpscRing commands; /* UI -> sim */
+    SpscRing events;   /* sim -> UI */
+    int timer_fd;      /* fires every tick */
+    int wake_fd;       /* eventfd: commands queued or stop requested */
+    int notify_fd;     /* eventfd: events queued for the UI */
+    bool posted;       /* events pushed since the UI was last notified */
+    atomic_bool stop;
+    pthread_t thread;
+    int last_tick;
+    ServerId last_server;
+    int last_pending;
+    int last_saving;
+};
+
+static void fd_signal(int fd) {
+    uint64_t one = 1;
+    ssize_t r = write(fd, &one, sizeof(one));
+    (void)r; /* EAGAIN only means the counter is already non-zero */
+}
+
+static void fd_drain(int fd) {
+    uint64_t v;
+    ssize_t r = read(fd, &v, sizeof(v));
+    (void)r;
+}
+
+/* Wakes the UI once for everything pushed since the last call. */
+static void notify_ui(Sim* s) {
+    if (!s->posted) return;
+    s->posted = false;
+    fd_signal(s->notify_fd);
+}
+
+/* Output must not be lost, so a full ring stalls the simulation until the
+ * UI catches up (or the thread is being stopped). */
+static void post_event(Sim* s, const SimEvent* ev) {
+    while (!spsc_push(&s->events, ev)) {
+	if (atomic_load_explicit(&s->stop, memory_order_relaxed)) return;
+	notify_ui(s);
+	sched_yield();
+    }
+    s->posted = true;
+}
+
+/* ui_print() sink installed on the simulation thread. */
+static void sim_print(const char* line, void* ctx) {
+    Sim* s = ctx;
+    SimEvent ev;
+    ev.type = SIM_EVENT_PRINT;
+    ev.tick = s->game->tick;
+    ev.pending = s->game->sched.pending;
+    ev.saving = -1;
+    strncpy(ev.text, line, sizeof(ev.text) - 1);
+    ev.text[sizeof(ev.text) - 1] = '\0';
+    post_event(s, &ev);
+}
+
+/* Sends a snapshot when anything shown in the header changed. */
+static void post_snapshot(Sim* s) {
+    GameState* g = s->game;
+    int saving = game_save_percent(g);
+    if (g->tick == s->last_tick && g->current_server == s->last_server &&
+        g->sched.pending == s->last_pending && saving == s->last_saving) {
+	return;
+    }
+    SimEvent ev;
+    ev.type = SIM_EVENT_SNAPSHOT;
+    ev.tick = g->tick;
+    ev.pending = g->sched.pending;
+    ev.saving = saving;
+    const char* name = game_server_name(g, g->current_server);
+    strncpy(ev.text, name ? name : "?", sizeof(ev.text) - 1);
+    ev.text[sizeof(ev.text) - 1] = '\0';
+    /* snapshots are advisory: drop one rather than stall */
+    if (spsc_push(&s->events, &ev)) {
+	s->posted = true;
+	s->last_tick = g->tick;
+	s->last_server = g->current_server;
+	s->last_pending = g->sched.pending;
+	s->last_saving = saving;
+    }
+}
+
+static void* sim_main(void* arg) {
+    Sim* s = arg;
+    ui_set_print_sink(sim_print, s);
+
+    /* sleep until a tick is due or the UI queues a command */
+    struct pollfd fds[2] = {
+	{ .fd = s->timer_fd, .events = POLLIN },
+	{ .fd = s->wake_fd, .events = POLLIN },
+    };
+    SimCommand cmd;
+    while (!atomic_load_explicit(&s->stop, memory_order_relaxed)) {
+	if (poll(fds, 2, -1) < 0) {
+	    if (errno == EINTR) continue;
+	    break;
+	}
+	if (fds[1].revents & POLLIN) fd_drain(s->wake_fd);
+
+	while (spsc_pop(&s->commands, &cmd)) {
+	    if (commands_run(s->game, cmd.line) == CMD_QUIT) {
+		SimEvent ev;
+		memset(&ev, 0, sizeof(ev));
+		ev.type = SIM_EVENT_QUIT;
+		post_event(s, &ev);
+		goto out;
+	    }
+	}
+
+	/* the expiration count covers every tick that fell due */
+	uint64_t due;
+	if ((fds[0].revents & POLLIN) && read(s->timer_fd, &due, sizeof(due)) == sizeof(due)) {
+	    while (due--) game_tick(s->game);
+	}
+	post_snapshot(s);
+	notify_ui(s);
+    }
+out:
+    notify_ui(s);
+    ui_set_print_sink(NULL, NULL);
+    return NULL;
+}
+
+static void close_fds(Sim* s) {
+    if (s->timer_fd >= 0) close(s->timer_fd);
+    if (s->wake_fd >= 0) close(s->wake_fd);
+    if (s->notify_fd >= 0) close(s->notify_fd);
+}
+
+Sim* sim_start(GameState* g, int tps) {
+    if (!g || tps <= 0) return NULL;
+    Sim* s = calloc(1, sizeof(*s));
+    if (!s) return NULL;
+    s->game = g;
+    s->tick_ns = 1000000000ull / (uint64_t)tps;
+    s->last_tick = -1;
+    s->last_server = SERVER_INVALID_ID;
+    s->last_saving = -1;
+    atomic_init(&s->stop, false);
+
+    s->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    s->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    s->notify_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (s->timer_fd < 0 || s->wake_fd < 0 || s->notify_fd < 0) goto fail;
+
+    struct itimerspec period;
+    period.it_interval.tv_sec = (time_t)(s->tick_ns / 1000000000ull);
+    period.it_interval.tv_nsec = (long)(s->tick_ns % 1000000000ull);
+    period.it_value = period.it_interval;
+    if (timerfd_settime(s->timer_fd, 0, &period, NULL) != 0) goto fail;
+
+    if (spsc_init(&s->commands, sizeof(SimCommand), SIM_COMMAND_SLOTS) != 0) goto fail;
+    if (spsc_init(&s->events, sizeof(SimEvent), SIM_EVENT_SLOTS) != 0) goto fail;
+    if (pthread_create(&s->thread, NULL, sim_main, s) != 0) goto fail;
+    return s;
+
+fail:
+    close_fds(s);
+    spsc_free(&s->commands);
+    spsc_free(&s->events);
+    free(s);
+    return NULL;
+}
+
+void sim_stop(Sim* s) {
+    if (!s) return;
+    atomic_store(&s->stop, true);
+    fd_signal(s->wake_fd);
+    pthread_join(s->thread, NULL);
+    close_fds(s);
+    spsc_free(&s->commands);
+    spsc_free(&s->events);
+    free(s);
+}
+
+bool sim_post_command(Sim* s, const char* line) {
+    if (!s || !line) return false;
+    SimCommand cmd;
+    strncpy(cmd.line, line, sizeof(cmd.line) - 1);
+    cmd.line[sizeof(cmd.line) - 1] = '\0';
+    if (!spsc_push(&s->commands, &cmd)) return false;
+    fd_signal(s->wake_fd);
+    return true;
+}
+
+bool sim_poll_event(Sim* s, SimEvent* out) {
+    if (!s || !out) return false;
+    return spsc_pop(&s->events, out);
+}
+
+int sim_notify_fd(const Sim* s) {
+    return s ? s->notify_fd : -1;
+}
+
+void sim_ack_notify(Sim* s) {
+    if (s) fd_drain(s->notify_fd);
+}
@@ -0,0 +1,41 @@
+#include "spsc.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+int spsc_init(SpscRing* r, size_t elem_size, size_t capacity) {
+    if (!r || elem_size == 0 || capacity == 0) return -1;
+    size_t cap = 1;
+    while (cap < capacity) cap <<= 1;
+    r->slots = malloc(cap * elem_size);
+    if (!r->slots) return -1;
+    r->elem_size = elem_size;
+    r->mask = cap - 1;
+    atomic_init(&r->head, 0);
+    atomic_init(&r->tail, 0);
+    return 0;
+}
+
+void spsc_free(SpscRing* r) {
+    if (!r) return;
+    free(r->slots);
+    r->slots = NULL;
+}
+
+bool spsc_push(SpscRing* r, const void* elem) {
+    size_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+    if (tail - head > r->mask) return false;
+    memcpy(r->slots + (tail & r->mask) * r->elem_size, elem, r->elem_size);
+    atomic_store_explicit(&r->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+bool spsc_pop(SpscRing* r, void* out) {
+    size_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    if (head == tail) return false;
+    memcpy(out, r->slots + (head & r->mask) * r->elem_size, r->elem_size);
+    atomic_store_explicit(&r->head, head + 1, memory_order_release);
+    return true;
+}
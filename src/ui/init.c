@@ -1,6 +1,8 @@
 #include <ncurses.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
 
 #include "ui.h"
 #include "ui_internal.h"
@@ -24,6 +26,17 @@ void ui_init(void) {
     mouseinterval(0);
     mousemask(ALL_MOUSE_EVENTS, NULL);
 
+    /* optional scrollback budget override, in KiB */
+    const char* kb = getenv("HACKTERM_SCROLLBACK_KB");
+    if (kb && atol(kb) > 0) ui_set_scrollback_budget((size_t)atol(kb) * 1024);
+
+    /* bracketed paste: the terminal wraps pasted text in ESC[200~ ...
+     * ESC[201~ so a paste arrives as one block instead of keystrokes */
+    define_key("\033[200~", KEY_PASTE_BEGIN);
+    define_key("\033[201~", KEY_PASTE_END);
+    fputs("\033[?2004h", stdout);
+    fflush(stdout);
+
     /* make stdscr non-blocking for global input polling */
     nodelay(stdscr, TRUE);
 
@@ -32,19 +45,33 @@ void ui_init(void) {
     ui_register_builtin_views();
 }
 
+void ui_set_scrollback_budget(size_t bytes) {
+    scrollback_set_budget(bytes);
+}
+
+void ui_resize(void) {
+    if (ui_headless) return;
+    struct winsize ws;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_row > 0 && ws.ws_col > 0) {
+        resizeterm(ws.ws_row, ws.ws_col);
+    }
+    ui_layout();
+}
+
+void ui_init_headless(void) {
+    ui_headless = 1;
+}
+
 void ui_shutdown(void) {
+    if (ui_headless) return;
     if (header_win) { delwin(header_win); header_win = NULL; }
     if (output_win) { delwin(output_win); output_win = NULL; }
     if (sidebar_win) { delwin(sidebar_win); sidebar_win = NULL; }
     if (input_win) { delwin(input_win); input_win = NULL; }
     endwin();
+    fputs("\033[?2004l", stdout);
+    fflush(stdout);
     /* free output buffer */
-    for (int i = 0; i < out_count; i++) {
-        int idx = (out_start + i) % OUT_HISTORY_MAX;
-        free(out_lines[idx]);
-        out_lines[idx] = NULL;
-    }
-    out_start = 0;
-    out_count = 0;
+    scrollback_clear();
     out_scroll_lines = 0;
 }
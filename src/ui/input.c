@@ -9,13 +9,26 @@
 #include "commands.h"
 #include "ui_view.h"
 
-int ui_readline_nonblocking(char* buf, int max) {
-    /* Read global input from stdscr so views can receive keys even when
-     * the terminal's input window is an overlay. stdscr is set to
-     * non-blocking in ui_init(). */
-    int ch = getch();
-    if (ch == ERR) return 0;
+/* bracketed paste in progress: bytes are collected until the end marker */
+static int paste_active = 0;
+static char paste_buf[PASTE_BUF_MAX];
+static int paste_len = 0;
 
+static void paste_key(int ch) {
+    if (ch == KEY_PASTE_END) {
+        paste_active = 0;
+        ui_view_handle_paste(paste_buf, paste_len);
+        paste_len = 0;
+        return;
+    }
+    /* plain bytes only; anything beyond the buffer is dropped */
+    if (ch >= 0 && ch < 256 && paste_len < PASTE_BUF_MAX) {
+        paste_buf[paste_len++] = (char)ch;
+    }
+}
+
+/* Handles one key; returns the length of a completed line, else 0. */
+static int handle_key(int ch, char* buf, int max) {
     if (ch == KEY_MOUSE) {
         MEVENT me;
         if (getmouse(&me) == OK) {
@@ -31,10 +44,9 @@ int ui_readline_nonblocking(char* buf, int max) {
                         /* map selected menu to view if applicable */
                         if (selected_menu < VIEW_COUNT) current_view = (ui_view_t)selected_menu;
                         ui_set_status("Selected: %s", menu_items[selected_menu]);
-                        /* recreate windows/layout for the selected view */
+                        /* recreate windows/layout for the selected view;
+                         * the next frame redraws everything */
                         ui_layout();
-                        ui_redraw_output();
-                        ui_render();
                         return 0;
                     }
                 }
@@ -46,15 +58,7 @@ int ui_readline_nonblocking(char* buf, int max) {
                 if (output_win && current_view == VIEW_TERMINAL) {
                     out_scroll_lines += 3;
                     /* batch redraw to avoid flicker of the input overlay */
-                    if (input_win) {
-                        ui_redraw_output_no_update();
-                        /* terminal overlay redraw (no update) */
-                        extern void view_terminal_redraw_input_no_update(void);
-                        view_terminal_redraw_input_no_update();
-                        doupdate();
-                    } else {
-                        ui_redraw_output();
-                    }
+                    ui_mark_dirty(UI_DIRTY_VIEW);
                 }
                 return 0;
             } else if (me.bstate & BUTTON5_PRESSED) {
@@ -62,14 +66,7 @@ int ui_readline_nonblocking(char* buf, int max) {
                 if (output_win && current_view == VIEW_TERMINAL) {
                     out_scroll_lines -= 3;
                     if (out_scroll_lines < 0) out_scroll_lines = 0;
-                    if (input_win) {
-                        ui_redraw_output_no_update();
-                        extern void view_terminal_redraw_input_no_update(void);
-                        view_terminal_redraw_input_no_update();
-                        doupdate();
-                    } else {
-                        ui_redraw_output();
-                    }
+                    ui_mark_dirty(UI_DIRTY_VIEW);
                 }
                 return 0;
             }
@@ -101,14 +98,7 @@ int ui_readline_nonblocking(char* buf, int max) {
             (void)w;
             out_scroll_lines += h;
             if (out_scroll_lines < 0) out_scroll_lines = 0;
-            if (input_win) {
-                ui_redraw_output_no_update();
-                extern void view_terminal_redraw_input_no_update(void);
-                view_terminal_redraw_input_no_update();
-                doupdate();
-            } else {
-                ui_redraw_output();
-            }
+            ui_mark_dirty(UI_DIRTY_VIEW);
         }
         return 0;
     } else if (ch == KEY_NPAGE) {
@@ -119,14 +109,7 @@ int ui_readline_nonblocking(char* buf, int max) {
             (void)w;
             out_scroll_lines -= h;
             if (out_scroll_lines < 0) out_scroll_lines = 0;
-            if (input_win) {
-                ui_redraw_output_no_update();
-                extern void view_terminal_redraw_input_no_update(void);
-                view_terminal_redraw_input_no_update();
-                doupdate();
-            } else {
-                ui_redraw_output();
-            }
+            ui_mark_dirty(UI_DIRTY_VIEW);
         }
         return 0;
     }
@@ -134,3 +117,27 @@ int ui_readline_nonblocking(char* buf, int max) {
     /* Nothing handled or produced; return 0. */
     return 0;
 }
+
+int ui_readline_nonblocking(char* buf, int max) {
+    /* Read global input from stdscr so views can receive keys even when
+     * the terminal's input window is an overlay. stdscr is set to
+     * non-blocking in ui_init(). Every key already available is handled
+     * in one call; keys only mark the screen dirty, so a burst costs one
+     * redraw. The call returns early when a line is completed and leaves
+     * the remaining keys for the next call. */
+    int ch;
+    while ((ch = getch()) != ERR) {
+        if (paste_active) {
+            paste_key(ch);
+            continue;
+        }
+        if (ch == KEY_PASTE_BEGIN) {
+            paste_active = 1;
+            paste_len = 0;
+            continue;
+        }
+        int got = handle_key(ch, buf, max);
+        if (got > 0) return got;
+    }
+    return 0;
+}
@@ -1,27 +1,17 @@
 #include <ncurses.h>
 #include <stdarg.h>
+#include <stdio.h>
 #include <string.h>
 
 #include "ui.h"
 #include "ui_internal.h"
 #include "ui_view.h"
 
-void ui_render(void) {
-    /* render should work even when `input_win` is NULL (non-terminal views)
-     * so do not early-return here. */
-
-    int r, c;
-    getmaxyx(stdscr, r, c);
-    if (r != term_rows || c != term_cols) {
-        /* Recompute layout for new terminal size without clearing the screen
-         * to preserve the scrollback buffer and avoid visual jumps. ui_layout
-         * will recreate windows sized for the new terminal and we'll redraw
-         * the output and input below. */
-        ui_layout();
-        ui_redraw_output();
-    }
+void ui_mark_dirty(unsigned what) {
+    ui_dirty |= what;
+}
 
-    /* draw header/status */
+static void draw_header(void) {
     werase(header_win);
     if (has_colors()) {
         wattron(header_win, COLOR_PAIR(1));
@@ -30,80 +20,86 @@ void ui_render(void) {
     if (has_colors()) {
         wattroff(header_win, COLOR_PAIR(1));
     }
-    wrefresh(header_win);
+    wnoutrefresh(header_win);
+}
 
-    /* draw sidebar menu (left) */
-    if (sidebar_win) {
-        werase(sidebar_win);
-        if (has_colors()) wbkgd(sidebar_win, COLOR_PAIR(3));
-        box(sidebar_win, 0, 0);
-        for (int i = 0; i < menu_count; i++) {
-            int y = 1 + i;
-            if (i == selected_menu) {
-                wattron(sidebar_win, A_REVERSE);
-            }
-            mvwprintw(sidebar_win, y, 2, "%s", menu_items[i]);
-            if (i == selected_menu) {
-                wattroff(sidebar_win, A_REVERSE);
-            }
+static void draw_sidebar(void) {
+    werase(sidebar_win);
+    if (has_colors()) wbkgd(sidebar_win, COLOR_PAIR(3));
+    box(sidebar_win, 0, 0);
+    for (int i = 0; i < menu_count; i++) {
+        int y = 1 + i;
+        if (i == selected_menu) {
+            wattron(sidebar_win, A_REVERSE);
         }
-        wrefresh(sidebar_win);
+        mvwprintw(sidebar_win, y, 2, "%s", menu_items[i]);
+        if (i == selected_menu) {
+            wattroff(sidebar_win, A_REVERSE);
+        }
+    }
+    wnoutrefresh(sidebar_win);
+}
+
+void ui_render(void) {
+    /* render should work even when `input_win` is NULL (non-terminal views)
+     * so do not early-return on it. */
+    if (ui_headless) return;
+
+    int r, c;
+    getmaxyx(stdscr, r, c);
+    if (r != term_rows || c != term_cols) {
+        /* Recompute layout for new terminal size without clearing the screen
+         * to preserve the scrollback buffer and avoid visual jumps. ui_layout
+         * recreates the windows and marks everything dirty. */
+        ui_layout();
     }
 
-    /* draw main/output area depending on the active view */
-    if (output_win) {
-        /* delegate rendering to the registered view implementation */
+    /* nothing changed since the last frame: leave the terminal alone */
+    if (!ui_dirty) return;
+    unsigned dirty = ui_dirty;
+    ui_dirty = 0;
+
+    /* Compose every damaged window into curses' virtual screen with
+     * wnoutrefresh and push the result with a single doupdate. */
+    if ((dirty & UI_DIRTY_HEADER) && header_win) draw_header();
+    if ((dirty & UI_DIRTY_SIDEBAR) && sidebar_win) draw_sidebar();
+
+    /* the output window spans the area under the input overlay, so a
+     * redrawn view must be followed by the overlay */
+    if ((dirty & UI_DIRTY_VIEW) && output_win) {
         ui_view_render_active(output_win);
+        dirty |= UI_DIRTY_INPUT;
     }
 
-    /* draw input overlay: delegate to terminal view when active. We
-     * avoid referencing input_buf or input_len here — the Terminal view
-     * owns its input state and knows how to draw itself into the
-     * backing buffer. */
-    if (input_win) {
-        if (current_view == VIEW_TERMINAL) {
+    if (input_win && current_view == VIEW_TERMINAL) {
+        /* The terminal view owns its input state and knows how to draw
+         * itself. Refreshing the overlay last also leaves the hardware
+         * cursor at the prompt, whatever else was redrawn. */
+        if (dirty & UI_DIRTY_INPUT) {
             extern void view_terminal_redraw_input_no_update(void);
-            /* terminal view already rendered the output via
-             * ui_view_render_active; ask it to draw the input overlay into
-             * the backing buffer and flush once. */
             view_terminal_redraw_input_no_update();
-            doupdate();
-            curs_set(1);
         } else {
-            /* Redraw output on top so the area where the input overlay
-             * would be is covered without clearing stdscr (avoids flicker). */
-            if (header_win) wnoutrefresh(header_win);
-            if (sidebar_win) wnoutrefresh(sidebar_win);
-            if (output_win) {
-                touchwin(output_win);
-                wnoutrefresh(output_win);
-            }
-            doupdate();
-            curs_set(0);
+            wnoutrefresh(input_win);
         }
+        doupdate();
+        curs_set(1);
     } else {
-        /* input_win not present: ensure output covers the space */
-        if (header_win) wnoutrefresh(header_win);
-        if (sidebar_win) wnoutrefresh(sidebar_win);
-        if (output_win) {
-            touchwin(output_win);
-            wnoutrefresh(output_win);
-        }
         doupdate();
         curs_set(0);
     }
 }
 
+int ui_render_pending(void) {
+    return !ui_headless && ui_dirty != 0;
+}
+
 void ui_set_status(const char* fmt, ...) {
+    char buf[sizeof(status_buf)];
     va_list ap;
     va_start(ap, fmt);
-    vsnprintf(status_buf, sizeof(status_buf), fmt, ap);
+    vsnprintf(buf, sizeof(buf), fmt, ap);
     va_end(ap);
-    if (header_win) {
-        werase(header_win);
-        if (has_colors()) wattron(header_win, COLOR_PAIR(1));
-        mvwprintw(header_win, 0, 1, "%s", status_buf[0] ? status_buf : "hackterm");
-        if (has_colors()) wattroff(header_win, COLOR_PAIR(1));
-        wrefresh(header_win);
-    }
+    if (strcmp(buf, status_buf) == 0) return;
+    memcpy(status_buf, buf, sizeof(status_buf));
+    ui_mark_dirty(UI_DIRTY_HEADER);
 }
@@ -0,0 +1,160 @@
+/*
+ * scrollback.c
+ *
+ * Output history kept as one contiguous byte ring plus a ring of
+ * (offset, length) entries, one per line. Appending copies the text into
+ * the ring and never allocates except when the ring or the index grows;
+ * both start small and double on demand up to the byte budget, so memory
+ * follows the amount of text actually printed. When the budget is reached
+ * the oldest lines are evicted.
+ *
+ * Byte positions are free-running 32-bit counters and the ring size is a
+ * power of two, so position % size stays correct across wrap-around. A
+ * line never straddles the end of the ring: if it would, the write skips
+ * to the start and the unused tail counts as padding.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ui_internal.h"
+
+#define SB_MIN_BYTES (64u * 1024u)
+#define SB_MIN_LINES 1024u
+/* the index is capped at one entry per this many budget bytes */
+#define SB_BYTES_PER_LINE 16u
+
+typedef struct {
+    uint32_t off; /* free-running byte position of the first byte */
+    uint32_t len;
+} SbLine;
+
+static char* sb_bytes;
+static uint32_t sb_size;      /* bytes allocated (power of two) */
+static uint32_t sb_tail;      /* position of the next write */
+static uint32_t sb_byte_max = SCROLLBACK_DEFAULT_BUDGET;
+
+static SbLine* sb_lines;
+static uint32_t sb_line_size; /* index entries allocated (power of two) */
+static uint32_t sb_first;     /* index slot of the oldest line */
+static uint32_t sb_count;
+static uint32_t sb_line_max = SCROLLBACK_DEFAULT_BUDGET / SB_BYTES_PER_LINE;
+
+static uint32_t floor_pow2(size_t v) {
+    uint32_t p = 1;
+    while ((size_t)p * 2 <= v && p < (1u << 30)) p *= 2;
+    return p;
+}
+
+static SbLine* line_at(uint32_t logical) {
+    return &sb_lines[(sb_first + logical) & (sb_line_size - 1)];
+}
+
+static void drop_oldest(void) {
+    sb_first = (sb_first + 1) & (sb_line_size - 1);
+    sb_count--;
+}
+
+/* Bytes in use from the oldest line up to (but excluding) @p end. */
+static uint32_t span_to(uint32_t end) {
+    return sb_count ? end - line_at(0)->off : 0;
+}
+
+/* Reallocates the byte ring at @p size and packs every line to the front. */
+static int grow_bytes(uint32_t size) {
+    char* grown = malloc(size);
+    if (!grown) return -1;
+    uint32_t pos = 0;
+    for (uint32_t i = 0; i < sb_count; i++) {
+	SbLine* l = line_at(i);
+	memcpy(grown + pos, sb_bytes + (l->off & (sb_size - 1)), l->len);
+	l->off = pos;
+	pos += l->len;
+    }
+    free(sb_bytes);
+    sb_bytes = grown;
+    sb_size = size;
+    sb_tail = pos;
+    return 0;
+}
+
+static int grow_lines(uint32_t size) {
+    SbLine* grown = malloc((size_t)size * sizeof(*grown));
+    if (!grown) return -1;
+    for (uint32_t i = 0; i < sb_count; i++) grown[i] = *line_at(i);
+    free(sb_lines);
+    sb_lines = grown;
+    sb_line_size = size;
+    sb_first = 0;
+    return 0;
+}
+
+void scrollback_set_budget(size_t bytes) {
+    if (bytes < SB_MIN_BYTES) bytes = SB_MIN_BYTES;
+    sb_byte_max = floor_pow2(bytes);
+    sb_line_max = floor_pow2(bytes / SB_BYTES_PER_LINE);
+    if (sb_line_max < SB_MIN_LINES) sb_line_max = SB_MIN_LINES;
+    /* a smaller budget takes effect immediately */
+    if (sb_size > sb_byte_max || sb_line_size > sb_line_max) scrollback_clear();
+}
+
+void scrollback_clear(void) {
+    free(sb_bytes);
+    free(sb_lines);
+    sb_bytes = NULL;
+    sb_lines = NULL;
+    sb_size = sb_tail = 0;
+    sb_line_size = sb_first = sb_count = 0;
+}
+
+void scrollback_append(const char* s) {
+    size_t n = strlen(s);
+    if (n > OUT_LINE_MAX - 1) n = OUT_LINE_MAX - 1;
+    uint32_t len = (uint32_t)n;
+
+    if (sb_count == sb_line_size) {
+	if (sb_line_size < sb_line_max) {
+	    if (grow_lines(sb_line_size ? sb_line_size * 2 : SB_MIN_LINES) != 0) return;
+	} else {
+	    drop_oldest();
+	}
+    }
+    if (!sb_bytes && grow_bytes(SB_MIN_BYTES < sb_byte_max ? SB_MIN_BYTES : sb_byte_max) != 0) return;
+
+    for (;;) {
+	uint32_t pos = sb_tail;
+	uint32_t phys = pos & (sb_size - 1);
+	if (phys + len > sb_size) pos += sb_size - phys; /* pad to the start */
+	uint32_t end = pos + len;
+	if (span_to(end) <= sb_size) {
+	    memcpy(sb_bytes + (pos & (sb_size - 1)), s, len);
+	    SbLine* l = &sb_lines[(sb_first + sb_count) & (sb_line_size - 1)];
+	    l->off = pos;
+	    l->len = len;
+	    sb_count++;
+	    sb_tail = end;
+	    return;
+	}
+	/* out of room: grow while under budget, otherwise evict */
+	if (sb_size < sb_byte_max) {
+	    if (grow_bytes(sb_size * 2) != 0) return;
+	} else {
+	    drop_oldest();
+	}
+    }
+}
+
+int scrollback_count(void) {
+    return (int)sb_count;
+}
+
+const char* scrollback_line(int logical, int* len) {
+    if (logical < 0 || (uint32_t)logical >= sb_count) {
+	*len = 0;
+	return NULL;
+    }
+    const SbLine* l = line_at((uint32_t)logical);
+    *len = (int)l->len;
+    return sb_bytes + (l->off & (sb_size - 1));
+}
@@ -24,9 +24,10 @@ ui_view_t current_view = VIEW_HOME;
 
 char status_buf[256] = "";
 
-char* out_lines[OUT_HISTORY_MAX];
-int out_start = 0;
-int out_count = 0;
+int ui_headless = 0;
+
+unsigned ui_dirty = UI_DIRTY_ALL;
+
 int out_scroll_lines = 0;
 
 void ui_layout(void) {
@@ -69,8 +70,6 @@ void ui_layout(void) {
 
     scrollok(output_win, TRUE);
 
-    // initial refresh
-    wrefresh(sidebar_win);
-    wrefresh(output_win);
-    wrefresh(header_win);
+    /* fresh windows are blank: the next frame composes everything */
+    ui_mark_dirty(UI_DIRTY_ALL);
 }
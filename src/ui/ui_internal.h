@@ -2,11 +2,18 @@
 #define SRC_UI_UI_INTERNAL_H_
 
 #include <ncurses.h>
+#include <stddef.h>
 
 #define INPUT_BUF_SIZE 256
 #define INPUT_HISTORY_MAX 64
-#define OUT_HISTORY_MAX 4096
 #define OUT_LINE_MAX 1024
+#define PASTE_BUF_MAX 4096
+
+/* key codes bound to the bracketed-paste markers ESC[200~ and ESC[201~ */
+#define KEY_PASTE_BEGIN (KEY_MAX + 1)
+#define KEY_PASTE_END (KEY_MAX + 2)
+/* default scrollback text budget in bytes (see ui_set_scrollback_budget) */
+#define SCROLLBACK_DEFAULT_BUDGET (8u * 1024u * 1024u)
 
 /* shared state between ui implementation files */
 extern WINDOW* header_win;
@@ -42,23 +49,49 @@ extern int prompt_y;
 
 extern char status_buf[256];
 
-/* output scrollback */
-extern char* out_lines[OUT_HISTORY_MAX];
-extern int out_start;
-extern int out_count;
+/* non-zero when running without a terminal (batch mode) */
+extern int ui_headless;
+
+/* output scrollback: lines scrolled up from the bottom */
 extern int out_scroll_lines;
 
+/* scrollback store (scrollback.c): byte ring plus per-line index */
+void scrollback_append(const char* s);
+int scrollback_count(void);
+/* Line @p logical (0 = oldest); not NUL-terminated, length in *len. */
+const char* scrollback_line(int logical, int* len);
+void scrollback_set_budget(size_t bytes);
+void scrollback_clear(void);
+
+/* damage tracking: parts of the screen ui_render() must recompose */
+#define UI_DIRTY_HEADER  0x1u
+#define UI_DIRTY_SIDEBAR 0x2u
+#define UI_DIRTY_VIEW    0x4u /* active view, including the scrollback */
+#define UI_DIRTY_INPUT   0x8u /* terminal input overlay */
+#define UI_DIRTY_ALL     0xfu
+
+extern unsigned ui_dirty;
+
 /* internal helpers used across files */
 void ui_layout(void);
 
 /**
  * @internal
- * @brief Redraw the output (scrollback) window.
+ * @brief Flag parts of the screen for the next ui_render().
+ *
+ * State changes only mark what they damage; the frame renderer redraws
+ * the dirty windows into curses' virtual screen and flushes them with a
+ * single doupdate(). Nothing is drawn when no flag is set.
+ *
+ * @param what Bitwise OR of UI_DIRTY_* flags.
+ */
+void ui_mark_dirty(unsigned what);
+
+/**
+ * @internal
+ * @brief Draw the scrollback into the output window without doupdate().
  *
- * This is an internal helper used by input handling and after layout
- * changes (e.g. terminal resize) to refresh the output window contents
- * from the in-memory scrollback buffer. Not part of the public API.
+ * Used by the terminal view's render callback. Not part of the public API.
  */
-void ui_redraw_output(void);
 void ui_redraw_output_no_update(void);
 #endif /* SRC_UI_UI_INTERNAL_H_ */
@@ -25,6 +25,7 @@ int view_home_input(int ch);
 void view_terminal_render(WINDOW* win);
 int view_terminal_input(int ch);
 int view_terminal_fetch_line(char* buf, int max);
+void view_terminal_paste(const char* text, int len);
 
 void view_settings_render(WINDOW* win);
 int view_settings_input(int ch);
@@ -51,6 +52,7 @@ static const UIView terminal_view = {
     .render = view_terminal_render,
     .handle_input = view_terminal_input,
     .fetch_line = view_terminal_fetch_line,
+    .handle_paste = view_terminal_paste,
 };
 
 static const UIView settings_view = {
@@ -128,6 +130,21 @@ int ui_view_fetch_line(char* buf, int max) {
     return v->fetch_line(buf, max);
 }
 
+/**
+ * @brief Deliver a pasted block to the active view.
+ */
+void ui_view_handle_paste(const char* text, int len) {
+    if ((size_t)current_view >= VIEW_COUNT) return;
+    const UIView* v = view_table[current_view];
+    if (!v) return;
+    if (v->handle_paste) {
+        v->handle_paste(text, len);
+        return;
+    }
+    if (!v->handle_input) return;
+    for (int i = 0; i < len; i++) v->handle_input((unsigned char)text[i]);
+}
+
 /* Builtin views are implemented in separate compilation units under
  * src/ui/views/. The registry holds pointers to their descriptors
  * defined earlier in this file. */
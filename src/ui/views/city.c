@@ -12,7 +12,7 @@ void view_city_render(WINDOW* win) {
     box(win, 0, 0);
     mvwprintw(win, 1, 2, "City view - overview:");
     mvwprintw(win, 3, 4, "(placeholder) City center, population: 12345");
-    wrefresh(win);
+    wnoutrefresh(win);
 }
 
 int view_city_input(int ch) {
@@ -12,7 +12,7 @@ void view_home_render(WINDOW* win) {
     box(win, 0, 0);
     mvwprintw(win, 1, 2, "Welcome to hackterm - Home view");
     mvwprintw(win, 3, 2, "Use the sidebar to switch views.");
-    wrefresh(win);
+    wnoutrefresh(win);
 }
 
 int view_home_input(int ch) {
@@ -11,7 +11,7 @@ void view_quit_render(WINDOW* win) {
     if (has_colors()) wbkgd(win, COLOR_PAIR(3));
     box(win, 0, 0);
     mvwprintw(win, 1, 2, "Quit selected - press Enter in input to exit.");
-    wrefresh(win);
+    wnoutrefresh(win);
 }
 
 int view_quit_input(int ch) {
@@ -12,7 +12,7 @@ void view_settings_render(WINDOW* win) {
     box(win, 0, 0);
     mvwprintw(win, 1, 2, "Settings view - configuration options:");
     mvwprintw(win, 3, 4, "(placeholder)");
-    wrefresh(win);
+    wnoutrefresh(win);
 }
 
 int view_settings_input(int ch) {
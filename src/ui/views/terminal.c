@@ -36,10 +36,8 @@ void view_terminal_render(WINDOW* win) {
 }
 
 static void terminal_redraw_input(void) {
-    if (!input_win) return;
-    /* use the immediate refresh path by default */
-    view_terminal_redraw_input_no_update();
-    doupdate();
+    /* redrawn by the next frame together with anything else that changed */
+    ui_mark_dirty(UI_DIRTY_INPUT);
 }
 
 /* Redraw the input overlay into the curses backing buffer but do not
@@ -178,6 +176,21 @@ int view_terminal_input(int ch) {
     return 0;
 }
 
+void view_terminal_paste(const char* text, int len) {
+    /* The prompt holds a single line: line breaks and tabs become spaces,
+     * trailing ones are dropped and other control bytes are skipped. The
+     * whole block costs one redraw. */
+    while (len > 0 && (text[len - 1] == '\n' || text[len - 1] == '\r')) len--;
+    for (int i = 0; i < len && input_len < INPUT_BUF_SIZE - 1; i++) {
+        unsigned char c = (unsigned char)text[i];
+        if (c == '\n' || c == '\r' || c == '\t') c = ' ';
+        if (c < 32 || c > 126) continue;
+        input_buf[input_len++] = (char)c;
+    }
+    input_buf[input_len] = '\0';
+    terminal_redraw_input();
+}
+
 int view_terminal_fetch_line(char* buf, int max) {
     if (pending_len <= 0) return 0;
     int copy = pending_len < max - 1 ? pending_len : max - 1;
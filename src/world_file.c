@@ -0,0 +1,343 @@
+/* world_file.c - binary world saves loaded with mmap() */
+#include "world_file.h"
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "generator.h"
+
+#define WORLD_FILE_MAGIC "HTWORLD"  /* 8 bytes with the NUL */
+#define WORLD_FILE_ENDIAN 0x01020304u
+#define SECTION_ALIGN 8
+
+enum {
+    SEC_TYPE,
+    SEC_SECURITY,
+    SEC_MONEY,
+    SEC_SUBNET,
+    SEC_COORD,
+    SEC_NAME_OFF,
+    SEC_NAMES,
+    SEC_SVC_FIRST,
+    SEC_SVC_COUNT,
+    SEC_SERVICES,
+    SEC_NAME_SLOTS,
+    SEC_LINK_OFFSETS,
+    SEC_LINKS,
+    SEC_LAZY,
+    SEC_LAZY_EXPANDED,
+    SEC_COUNT
+};
+
+/* SEC_LAZY: what a lazily generated world still needs to grow (see
+ * GenLazyState); SEC_LAZY_EXPANDED then lists its expanded neighbourhoods. */
+typedef struct {
+    GeneratorParams params;
+    uint32_t seed;
+    int32_t first_isp;
+} WorldLazy;
+
+typedef struct {
+    uint64_t offset;
+    uint64_t size;
+} WorldSection;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t endian; /* WORLD_FILE_ENDIAN as the writer stored it */
+    int32_t server_count;
+    int32_t home_server;
+    int32_t current_server;
+    uint32_t edge_count;
+    uint32_t name_mask;
+    uint32_t name_used;
+    int32_t name_dups;
+    int32_t lazy_expanded; /* entries of SEC_LAZY_EXPANDED; -1 for a complete world */
+    uint64_t names_len;
+    uint64_t services_len;
+    WorldSection sections[SEC_COUNT];
+} WorldFileHeader;
+
+/* The format is the in-memory layout; only little-endian hosts share it. */
+static int host_is_little_endian(void) {
+    const uint32_t one = 1;
+    return *(const unsigned char*)&one == 1;
+}
+
+static uint64_t align_up(uint64_t v) {
+    return (v + SECTION_ALIGN - 1) & ~(uint64_t)(SECTION_ALIGN - 1);
+}
+
+/* Expected size of every section for the counts in `h`. */
+static void section_sizes(const WorldFileHeader* h, uint64_t* size) {
+    uint64_t n = (uint64_t)h->server_count;
+    const ServerStore* st = NULL;
+    const LinkGraph* lg = NULL;
+    size[SEC_TYPE] = n * sizeof(*st->type);
+    size[SEC_SECURITY] = n * sizeof(*st->security);
+    size[SEC_MONEY] = n * sizeof(*st->money);
+    size[SEC_SUBNET] = n * sizeof(*st->subnet_id);
+    size[SEC_COORD] = n * sizeof(*st->coord);
+    size[SEC_NAME_OFF] = n * sizeof(*st->name_off);
+    size[SEC_NAMES] = h->names_len;
+    size[SEC_SVC_FIRST] = n * sizeof(*st->svc_first);
+    size[SEC_SVC_COUNT] = n * sizeof(*st->svc_count);
+    size[SEC_SERVICES] = h->services_len * sizeof(*st->services);
+    size[SEC_NAME_SLOTS] = h->name_used ? ((uint64_t)h->name_mask + 1) * sizeof(*st->name_slots) : 0;
+    size[SEC_LINK_OFFSETS] = (n + 1) * sizeof(*lg->offsets);
+    size[SEC_LINKS] = (uint64_t)h->edge_count * sizeof(*lg->neighbors);
+    size[SEC_LAZY] = h->lazy_expanded >= 0 ? sizeof(WorldLazy) : 0;
+    size[SEC_LAZY_EXPANDED] = h->lazy_expanded > 0 ? (uint64_t)h->lazy_expanded * sizeof(ServerId) : 0;
+}
+
+static int write_section(FILE* f, uint64_t* pos, const void* data, uint64_t size) {
+    static const char zeros[SECTION_ALIGN] = { 0 };
+    if (size > 0 && fwrite(data, 1, size, f) != size) return 0;
+    uint64_t end = align_up(*pos + size);
+    if (end > *pos + size && fwrite(zeros, 1, end - *pos - size, f) != end - *pos - size) return 0;
+    *pos = end;
+    return 1;
+}
+
+bool world_file_save(const GameState* g, const char* filename) {
+    if (!g || !filename || !host_is_little_endian()) return false;
+    const ServerStore* st = &g->servers;
+    const LinkGraph* lg = &g->links;
+
+    WorldFileHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, WORLD_FILE_MAGIC, sizeof(h.magic));
+    h.version = WORLD_FILE_VERSION;
+    h.endian = WORLD_FILE_ENDIAN;
+    h.server_count = st->count;
+    h.home_server = g->home_server;
+    h.current_server = g->current_server;
+    h.name_mask = st->name_slots ? st->name_mask : 0;
+    h.name_used = st->name_slots ? st->name_used : 0;
+    h.name_dups = st->name_dups;
+    h.names_len = st->names_len;
+    h.services_len = st->services_len;
+
+    GenLazyState lazy;
+    WorldLazy lazy_rec;
+    if (!generator_lazy_save_state(g->lazy, &lazy)) return false;
+    h.lazy_expanded = lazy.expanded_count;
+    memset(&lazy_rec, 0, sizeof(lazy_rec));
+    lazy_rec.params = lazy.params;
+    lazy_rec.seed = lazy.seed;
+    lazy_rec.first_isp = lazy.first_isp;
+
+    /* the links as queries see them: frozen, padded to every server */
+    static const char empty_name = '\0';
+    uint32_t* offsets = calloc((size_t)st->count + 1, sizeof(*offsets));
+    if (!offsets) {
+	generator_lazy_state_free(&lazy);
+	return false;
+    }
+    for (int i = 0; i < st->count; i++) {
+	offsets[i + 1] = offsets[i] + (uint32_t)link_graph_degree(lg, i);
+    }
+    h.edge_count = offsets[st->count];
+    const char* names = st->names_len ? st->names : &empty_name;
+    if (!st->names_len) h.names_len = 1;
+
+    uint64_t size[SEC_COUNT];
+    section_sizes(&h, size);
+    uint64_t pos = align_up(sizeof(h));
+    for (int s = 0; s < SEC_COUNT; s++) {
+	h.sections[s].offset = pos;
+	h.sections[s].size = size[s];
+	pos = align_up(pos + size[s]);
+    }
+
+    char tmpfile[512];
+    snprintf(tmpfile, sizeof(tmpfile), "%s.tmp.%ld", filename, (long)getpid());
+    FILE* f = fopen(tmpfile, "wb");
+    if (!f) {
+	free(offsets);
+	generator_lazy_state_free(&lazy);
+	return false;
+    }
+    setvbuf(f, NULL, _IOFBF, 1 << 20);
+
+    pos = 0;
+    int ok = write_section(f, &pos, &h, sizeof(h)) &&
+             write_section(f, &pos, st->type, size[SEC_TYPE]) &&
+             write_section(f, &pos, st->security, size[SEC_SECURITY]) &&
+             write_section(f, &pos, st->money, size[SEC_MONEY]) &&
+             write_section(f, &pos, st->subnet_id, size[SEC_SUBNET]) &&
+             write_section(f, &pos, st->coord, size[SEC_COORD]) &&
+             write_section(f, &pos, st->name_off, size[SEC_NAME_OFF]) &&
+             write_section(f, &pos, names, size[SEC_NAMES]) &&
+             write_section(f, &pos, st->svc_first, size[SEC_SVC_FIRST]) &&
+             write_section(f, &pos, st->svc_count, size[SEC_SVC_COUNT]) &&
+             write_section(f, &pos, st->services, size[SEC_SERVICES]) &&
+             write_section(f, &pos, st->name_slots, size[SEC_NAME_SLOTS]) &&
+             write_section(f, &pos, offsets, size[SEC_LINK_OFFSETS]);
+    for (int i = 0; i < st->count && ok; i++) {
+	int n = 0;
+	const ServerId* nb = link_graph_neighbors(lg, i, &n);
+	ok = n == 0 || fwrite(nb, sizeof(*nb), (size_t)n, f) == (size_t)n;
+    }
+    pos += size[SEC_LINKS];
+    ok = ok && write_section(f, &pos, NULL, 0) &&
+         write_section(f, &pos, &lazy_rec, size[SEC_LAZY]) &&
+         write_section(f, &pos, lazy.expanded, size[SEC_LAZY_EXPANDED]);
+    free(offsets);
+    generator_lazy_state_free(&lazy);
+    if (fclose(f) != 0) ok = 0;
+
+    if (!ok || rename(tmpfile, filename) != 0) {
+	remove(tmpfile);
+	return false;
+    }
+    return true;
+}
+
+bool world_file_detect(const char* filename) {
+    FILE* f = filename ? fopen(filename, "rb") : NULL;
+    if (!f) return false;
+    char magic[8];
+    bool yes = fread(magic, 1, sizeof(magic), f) == sizeof(magic) &&
+               memcmp(magic, WORLD_FILE_MAGIC, sizeof(magic)) == 0;
+    fclose(f);
+    return yes;
+}
+
+/* Checks the header against the file size; the tables themselves are
+ * checked when they are adopted. */
+static int header_valid(const WorldFileHeader* h, uint64_t file_size) {
+    if (memcmp(h->magic, WORLD_FILE_MAGIC, sizeof(h->magic)) != 0) return 0;
+    if (h->version != WORLD_FILE_VERSION || h->endian != WORLD_FILE_ENDIAN) return 0;
+    if (h->server_count <= 0 || h->home_server < 0 || h->home_server >= h->server_count ||
+        h->current_server < 0 || h->current_server >= h->server_count || h->name_dups < 0 ||
+        h->lazy_expanded < -1) {
+	return 0;
+    }
+    if (h->names_len == 0 || h->names_len > UINT32_MAX || h->services_len > UINT32_MAX) return 0;
+    uint64_t size[SEC_COUNT];
+    section_sizes(h, size);
+    for (int s = 0; s < SEC_COUNT; s++) {
+	const WorldSection* sec = &h->sections[s];
+	if (sec->size != size[s] || sec->offset % SECTION_ALIGN != 0 || sec->offset < sizeof(*h) ||
+	    sec->offset > file_size || sec->size > file_size - sec->offset) {
+	    return 0;
+	}
+    }
+    return 1;
+}
+
+static void* map_file(int fd, size_t len) {
+    void* p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    return p == MAP_FAILED ? NULL : p;
+}
+
+bool world_file_load(GameState* g, const char* filename) {
+    if (!g || !filename || !host_is_little_endian()) return false;
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat sb;
+    if (fstat(fd, &sb) != 0 || sb.st_size < (off_t)sizeof(WorldFileHeader)) {
+	close(fd);
+	return false;
+    }
+    size_t len = (size_t)sb.st_size;
+
+    /* one mapping for the store and one for the links, so each can let go
+     * of its own when it moves to the heap */
+    char* store_map = map_file(fd, len);
+    char* link_map = store_map ? map_file(fd, len) : NULL;
+    close(fd);
+    if (!link_map) {
+	if (store_map) munmap(store_map, len);
+	return false;
+    }
+
+    const WorldFileHeader* h = (const WorldFileHeader*)store_map;
+    if (!header_valid(h, len)) {
+	munmap(store_map, len);
+	munmap(link_map, len);
+	return false;
+    }
+    int count = h->server_count, home = h->home_server, current = h->current_server;
+
+    LinkGraph links;
+    link_graph_init(&links);
+    if (link_graph_adopt_mapping(&links, (uint32_t*)(link_map + h->sections[SEC_LINK_OFFSETS].offset),
+                                 (ServerId*)(link_map + h->sections[SEC_LINKS].offset), count,
+                                 h->edge_count, link_map, len) != CORE_OK) {
+	munmap(store_map, len);
+	munmap(link_map, len);
+	return false;
+    }
+
+#define SECTION(s) ((void*)(store_map + h->sections[s].offset))
+    ServerStore view;
+    memset(&view, 0, sizeof(view));
+    view.count = count;
+    view.type = SECTION(SEC_TYPE);
+    view.security = SECTION(SEC_SECURITY);
+    view.money = SECTION(SEC_MONEY);
+    view.subnet_id = SECTION(SEC_SUBNET);
+    view.coord = SECTION(SEC_COORD);
+    view.name_off = SECTION(SEC_NAME_OFF);
+    view.names = SECTION(SEC_NAMES);
+    view.names_len = (size_t)h->names_len;
+    view.svc_first = SECTION(SEC_SVC_FIRST);
+    view.svc_count = SECTION(SEC_SVC_COUNT);
+    view.services = h->services_len ? SECTION(SEC_SERVICES) : NULL;
+    view.services_len = (size_t)h->services_len;
+    view.name_slots = h->name_used ? SECTION(SEC_NAME_SLOTS) : NULL;
+    view.name_mask = h->name_used ? h->name_mask : 0;
+    view.name_used = h->name_used;
+    view.name_dups = h->name_dups;
+
+    const WorldLazy* rec = h->lazy_expanded >= 0 ? SECTION(SEC_LAZY) : NULL;
+    ServerId* expanded = SECTION(SEC_LAZY_EXPANDED);
+#undef SECTION
+
+    /* adopt into a fresh store, so g is untouched until the world is known
+     * to be whole */
+    ServerStore servers;
+    server_store_init(&servers);
+    if (server_store_adopt_mapping(&servers, &view, store_map, len) != CORE_OK) {
+	munmap(store_map, len);
+	link_graph_free(&links);
+	return false;
+    }
+
+    /* a lazy world picks up its plan again; one that doesn't fit it is
+     * damaged. The params are checked against the validated store the way
+     * save_json_read() checks them. */
+    GenLazy* lazy = NULL;
+    if (rec) {
+	GenLazyState state = { rec->params, rec->seed, rec->first_isp, expanded,
+	                       h->lazy_expanded };
+	if (generator_params_valid(&state.params, servers.count)) lazy = generator_lazy_resume(&state, &servers);
+	if (!lazy) {
+	    server_store_free(&servers);
+	    link_graph_free(&links);
+	    return false;
+	}
+    }
+    server_store_free(&g->servers);
+    g->servers = servers;
+    link_graph_free(&g->links);
+    g->links = links;
+
+    generator_lazy_free(g->lazy);
+    g->lazy = lazy;
+    g->home_server = home;
+    g->current_server = current;
+    g->tick = 0;
+    scheduler_free(&g->sched);
+    scheduler_init(&g->sched, 0);
+    return true;
+}